@@ -29,6 +29,7 @@ AntiMarker::AntiMarker( const std::string& name, boost::shared_ptr< Graph::UTQLS
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
 	, m_push ( "PushInput", *this, boost::bind( &AntiMarker::positionIn, this, _1, 1 ))
+	, m_corners( m_frameInputs )
 	, m_factor( 0.06 )
 {
 	Graph::UTQLSubgraph::NodePtr objectNode = subgraph->getNode( "Object" );
@@ -38,9 +39,17 @@ AntiMarker::AntiMarker( const std::string& name, boost::shared_ptr< Graph::UTQLS
 /** render the object */
 void AntiMarker::draw( Measurement::Timestamp& t, int parity )
 {
+	const Ubitrack::Measurement::PositionList2& corners = m_corners.get();
+	if ( !corners ) return;
+	m_lastUpdateTime = corners.time();
+
 	if (t > m_lastUpdateTime + 350000000L) return;
-	boost::mutex::scoped_lock l( m_posLock );
-	if (m_data.size() != 4) return;
+	if (corners->size() != 4) return;
+
+	// enlarged copy of the corners
+	Math::Vector< double, 2 > data[4];
+	for ( int i = 0; i < 4; i++ )
+		data[i] = (*corners)[i];
 
 	glMatrixMode(GL_MODELVIEW ); glPushMatrix(); glLoadIdentity();
 	glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
@@ -48,31 +57,32 @@ void AntiMarker::draw( Measurement::Timestamp& t, int parity )
 	GLint vport[4]; glGetIntegerv( GL_VIEWPORT, vport );
 	gluOrtho2D( vport[0], vport[0]+vport[2], vport[1], vport[1]+vport[3] );
 
-	glDisable(GL_LIGHTING);
-	glDisable(GL_DEPTH_TEST);
+	GLStateCache& state = m_pModule->glState();
+	state.disable( GL_LIGHTING );
+	state.disable( GL_DEPTH_TEST );
 
-	double d1x = m_factor*(m_data[0][0] - m_data[2][0]); double d2x = m_factor*(m_data[1][0] - m_data[3][0]);
-	double d1y = m_factor*(m_data[0][1] - m_data[2][1]); double d2y = m_factor*(m_data[1][1] - m_data[3][1]);
+	double d1x = m_factor*(data[0][0] - data[2][0]); double d2x = m_factor*(data[1][0] - data[3][0]);
+	double d1y = m_factor*(data[0][1] - data[2][1]); double d2y = m_factor*(data[1][1] - data[3][1]);
 
-	m_data[0][0] += d1x; m_data[0][1] += d1y; m_data[1][0] += d2x; m_data[1][1] += d2y;
-	m_data[2][0] -= d1x; m_data[2][1] -= d1y; m_data[3][0] -= d2x; m_data[3][1] -= d2y;
+	data[0][0] += d1x; data[0][1] += d1y; data[1][0] += d2x; data[1][1] += d2y;
+	data[2][0] -= d1x; data[2][1] -= d1y; data[3][0] -= d2x; data[3][1] -= d2y;
 
 	unsigned char colors[4][3];
 
-	glReadPixels( (GLint)m_data[0][0], (GLint)m_data[0][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[0] );
-	glReadPixels( (GLint)m_data[1][0], (GLint)m_data[1][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[1] );
-	glReadPixels( (GLint)m_data[2][0], (GLint)m_data[2][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[2] );
-	glReadPixels( (GLint)m_data[3][0], (GLint)m_data[3][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[3] );
+	glReadPixels( (GLint)data[0][0], (GLint)data[0][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[0] );
+	glReadPixels( (GLint)data[1][0], (GLint)data[1][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[1] );
+	glReadPixels( (GLint)data[2][0], (GLint)data[2][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[2] );
+	glReadPixels( (GLint)data[3][0], (GLint)data[3][1], 1, 1, GL_RGB, GL_UNSIGNED_BYTE, colors[3] );
 
 	glBegin(GL_QUADS);
-		glColor3ubv( colors[0] ); glVertex2f( (float)m_data[0][0], (float)m_data[0][1] );
-		glColor3ubv( colors[1] ); glVertex2f( (float)m_data[1][0], (float)m_data[1][1] );
-		glColor3ubv( colors[2] ); glVertex2f( (float)m_data[2][0], (float)m_data[2][1] );
-		glColor3ubv( colors[3] ); glVertex2f( (float)m_data[3][0], (float)m_data[3][1] );
+		glColor3ubv( colors[0] ); glVertex2f( (float)data[0][0], (float)data[0][1] );
+		glColor3ubv( colors[1] ); glVertex2f( (float)data[1][0], (float)data[1][1] );
+		glColor3ubv( colors[2] ); glVertex2f( (float)data[2][0], (float)data[2][1] );
+		glColor3ubv( colors[3] ); glVertex2f( (float)data[3][0], (float)data[3][1] );
 	glEnd();
 
-	glEnable(GL_LIGHTING);
-	glEnable(GL_DEPTH_TEST);
+	state.enable( GL_LIGHTING );
+	state.enable( GL_DEPTH_TEST );
 
 	glPopMatrix(); glMatrixMode(GL_MODELVIEW); glPopMatrix();
 }
@@ -83,11 +93,14 @@ bool AntiMarker::hasWaitingEvents()
 	return ( m_push.getQueuedEvents() > 0 );
 }
 
+unsigned long AntiMarker::generation()
+{
+	return m_frameInputs.generation();
+}
+
 void AntiMarker::positionIn( const Ubitrack::Measurement::PositionList2& pos, int parity )
 {
-	m_lastUpdateTime = pos.time();
-	boost::mutex::scoped_lock l( m_posLock );
-	m_data = *pos;
+	m_corners.write( pos );
 	// the camera pose has changed, so redraw the world
 	m_pModule->invalidate();
 }
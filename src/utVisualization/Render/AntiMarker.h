@@ -62,6 +62,8 @@ public:
 
 	virtual bool hasWaitingEvents();
 
+	virtual unsigned long generation();
+
 protected:
 
 	/**
@@ -73,8 +75,8 @@ protected:
 	// positionlist input
 	PushConsumer< Ubitrack::Measurement::PositionList2 > m_push;
 
-	std::vector< Math::Vector< double, 2 > > m_data;
-	boost::mutex m_posLock;
+	// marker corners, frozen for the current frame
+	FrameValue< Ubitrack::Measurement::PositionList2 > m_corners;
 	double m_factor;
 };
 
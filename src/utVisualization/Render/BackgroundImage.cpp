@@ -28,6 +28,8 @@ namespace Ubitrack { namespace Drivers {
 BackgroundImage::BackgroundImage( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_background0( m_frameInputs )
+	, m_background1( m_frameInputs )
 	, m_bUseTexture( true )
 	, m_bTextureInitialized( false )
 	, m_image0( "Image1", *this, boost::bind( &BackgroundImage::imageIn, this, _1, 0 ))
@@ -51,10 +53,11 @@ void BackgroundImage::glCleanup()
 	LOG4CPP_DEBUG( logger, "glCleanup() called" );
 
 	if ( m_bTextureInitialized ) {
- 		glBindTexture( GL_TEXTURE_2D, 0 );
- 		glDisable( GL_TEXTURE_2D );
- 		glDeleteTextures( 1, &m_texture );
- 	}
+		GLStateCache& state = m_pModule->glState();
+		state.bindTexture2D( 0 );
+		state.disable( GL_TEXTURE_2D );
+		state.deleteTextures( 1, &m_texture );
+	}
 }
 
 
@@ -64,14 +67,16 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 	// Disable transparency for background image. The Transparency
 	// module might have enabled global transparency for the virtual
 	// scene.  We have to restore this state below.
-	glDisable( GL_BLEND );
+	GLStateCache& state = m_pModule->glState();
+	state.disable( GL_BLEND );
 
 	// use image in stereo mode only if correct eye
 	if ( ( m_stereoEye == stereoEyeRight && num ) || ( m_stereoEye == stereoEyeLeft && !num ) )
 		return;
 		
 	// check if we have an image to display as background
-	if ( m_background[num].get() == 0 ) return;
+	const Ubitrack::Measurement::ImageMeasurement& background = num ? m_background1.get() : m_background0.get();
+	if ( background.get() == 0 ) return;
 
 	int m_width  = m_pModule->m_width;
 	int m_height = m_pModule->m_height;
@@ -85,22 +90,19 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 	gluOrtho2D( 0.0, m_width, 0.0, m_height );
 
 	// prepare fullscreen bitmap without fancy extras
-	GLboolean bLightingEnabled = glIsEnabled( GL_LIGHTING );
-	glDisable( GL_LIGHTING );
-	glDisable( GL_DEPTH_TEST );
-	
-	// lock it to avoid random crashes
-	boost::mutex::scoped_lock l( m_imageLock[num] );
+	bool bLightingEnabled = state.isEnabled( GL_LIGHTING );
+	state.disable( GL_LIGHTING );
+	state.disable( GL_DEPTH_TEST );
 	
 	// find out texture format
 	GLenum imgFormat = GL_LUMINANCE;
-	switch ( m_background[num]->nChannels ) {
+	switch ( background->nChannels ) {
 		case 1: imgFormat = GL_LUMINANCE; break;
 #ifndef GL_BGR_EXT
 		case 3: imgFormat = GL_RGB; break;
 #else
 		case 3: 
-			if ( m_background[ num ]->channelSeq[ 0 ] == 'B' && m_background[ num ]->channelSeq[ 1 ] == 'G' && m_background[ num ]->channelSeq[ 2 ] == 'R' )
+			if ( background->channelSeq[ 0 ] == 'B' && background->channelSeq[ 1 ] == 'G' && background->channelSeq[ 2 ] == 'R' )
 				imgFormat = GL_BGR_EXT;
 			else
 				imgFormat = GL_RGB;
@@ -111,27 +113,27 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 	if ( !m_bUseTexture )
 	{
 		// glDrawPixels version
-		glDisable( GL_TEXTURE_2D );
+		state.disable( GL_TEXTURE_2D );
 
-		if ( m_background[num]->origin ) {
+		if ( background->origin ) {
 			glRasterPos2i( 0, 0 );
-			glPixelZoom(
-				((float)m_width /(float)m_background[num]->width )*1.0000001f,
-				((float)m_height/(float)m_background[num]->height)*1.0000001f
+			state.pixelZoom(
+				((float)m_width /(float)background->width )*1.0000001f,
+				((float)m_height/(float)background->height)*1.0000001f
 			);
 		} else {
 			glRasterPos2i( 0, m_height-1 );
-			glPixelZoom(
-				 ((float)m_width /(float)m_background[num]->width )*1.0000001f,
-				-((float)m_height/(float)m_background[num]->height)*1.0000001f
+			state.pixelZoom(
+				 ((float)m_width /(float)background->width )*1.0000001f,
+				-((float)m_height/(float)background->height)*1.0000001f
 			);
 		}
-		glDrawPixels( m_background[num]->width, m_background[num]->height, imgFormat, GL_UNSIGNED_BYTE, m_background[num]->imageData );
+		glDrawPixels( background->width, background->height, imgFormat, GL_UNSIGNED_BYTE, background->imageData );
 	}
 	else
 	{
 		// texture version
-		glEnable( GL_TEXTURE_2D );
+		state.enable( GL_TEXTURE_2D );
 
 		if ( !m_bTextureInitialized )
 		{
@@ -139,21 +141,21 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 			
 			// generate power-of-two sizes
 			m_pow2Width = 1;
-			while ( m_pow2Width < (unsigned)m_background[ num ]->width )
+			while ( m_pow2Width < (unsigned)background->width )
 				m_pow2Width <<= 1;
 				
 			m_pow2Height = 1;
-			while ( m_pow2Height < (unsigned)m_background[ num ]->height )
+			while ( m_pow2Height < (unsigned)background->height )
 				m_pow2Height <<= 1;
 			
 			// create new empty texture
 			glGenTextures( 1, &m_texture );
-			glBindTexture( GL_TEXTURE_2D, m_texture );
+			state.bindTexture2D( m_texture );
 			
 			// define texture parameters
 		    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 		    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-		    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL );
+			state.texEnvMode( GL_DECAL );
 			
 			// load empty texture image (defines texture size)
 			glTexImage2D( GL_TEXTURE_2D, 0, 3, m_pow2Width, m_pow2Height, 0, imgFormat, GL_UNSIGNED_BYTE, 0 );
@@ -161,15 +163,15 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 		}
 		
 		// load image into texture
-		glBindTexture( GL_TEXTURE_2D, m_texture );
-		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, m_background[ num ]->width, m_background[ num ]->height, 
-			imgFormat, GL_UNSIGNED_BYTE, m_background[ num ]->imageData );
+		state.bindTexture2D( m_texture );
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, background->width, background->height, 
+			imgFormat, GL_UNSIGNED_BYTE, background->imageData );
 		
 		// display textured rectangle
-		double y0 = m_background[ num ]->origin ? 0 : m_height;
+		double y0 = background->origin ? 0 : m_height;
 		double y1 = m_height - y0;
-		double tx = double( m_background[ num ]->width ) / m_pow2Width;
-		double ty = double( m_background[ num ]->height ) / m_pow2Height;
+		double tx = double( background->width ) / m_pow2Width;
+		double ty = double( background->height ) / m_pow2Height;
 
 		// draw two triangles
 		glBegin( GL_TRIANGLE_STRIP );
@@ -179,17 +181,17 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 		glTexCoord2d( tx,  0 ); glVertex2d( m_width, y0 );
 		glEnd();
 		
-		glDisable( GL_TEXTURE_2D );
+		state.disable( GL_TEXTURE_2D );
 	}
 
 	// change timestamp to image time
-	t = m_background[num].time();
+	t = background.time();
 
 	// restore opengl state
-	glEnable( GL_BLEND );
-	glEnable( GL_DEPTH_TEST );
+	state.enable( GL_BLEND );
+	state.enable( GL_DEPTH_TEST );
 	if ( bLightingEnabled )
-		glEnable( GL_LIGHTING );
+		state.enable( GL_LIGHTING );
 
 	glPopMatrix();
 	glMatrixMode( GL_MODELVIEW );
@@ -203,7 +205,7 @@ void BackgroundImage::draw( Measurement::Timestamp& t, int num )
 void BackgroundImage::imageIn( const Ubitrack::Measurement::ImageMeasurement& img, int num )
 {
 	LOG4CPP_DEBUG( logger, "received background image with timestamp " << img.time() );
-	boost::mutex::scoped_lock l( m_imageLock[num] );		
+	FrameValue< Ubitrack::Measurement::ImageMeasurement >& background = num ? m_background1 : m_background0;
 	if(img->depth == IPL_DEPTH_32F){		
 		boost::shared_ptr<Ubitrack::Vision::Image> p(new Ubitrack::Vision::Image(img->width , img->height , 1, IPL_DEPTH_8U ));
 		float* depthData = (float*) img->imageData;
@@ -214,9 +216,9 @@ void BackgroundImage::imageIn( const Ubitrack::Measurement::ImageMeasurement& im
 			else 
 				up[i] = depthData[i]*255;
 		
-		m_background[num] = Ubitrack::Measurement::ImageMeasurement(img.time(), p);
+		background.write( Ubitrack::Measurement::ImageMeasurement(img.time(), p) );
 	} else 
-		m_background[num] = img;
+		background.write( img );
 	m_pModule->invalidate( this );
 }
 
@@ -226,5 +228,10 @@ bool BackgroundImage::hasWaitingEvents()
 	return ( (m_image0.getQueuedEvents() > 0) || (m_image1.getQueuedEvents() > 0) );
 }
 
+unsigned long BackgroundImage::generation()
+{
+	return m_frameInputs.generation();
+}
+
 } } // namespace Ubitrack::Drivers
 
@@ -68,10 +68,13 @@ public:
 	/** check whether there is an image waiting in the queue */
 	virtual bool hasWaitingEvents();
 
+	virtual unsigned long generation();
+
 protected:
 
-	Ubitrack::Measurement::ImageMeasurement m_background[2];
-	boost::mutex m_imageLock[2];
+	/** images of the two inputs, frozen for the current frame */
+	FrameValue< Ubitrack::Measurement::ImageMeasurement > m_background0;
+	FrameValue< Ubitrack::Measurement::ImageMeasurement > m_background1;
 
 	// variables for textured drawing
 	bool m_bUseTexture;
@@ -51,6 +51,10 @@ public:
 
 	virtual void draw( Measurement::Timestamp& t, int parity );
 
+	/** key presses force a frame anyway */
+	virtual unsigned long generation()
+	{ return 0; }
+
 protected:
 
 	PushSupplier< Measurement::Button > m_port;
@@ -29,20 +29,29 @@ namespace Ubitrack { namespace Drivers {
 CameraPose::CameraPose( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
-	, m_push ( "PushInput", *this, boost::bind( &CameraPose::poseIn, this, _1, 1 ))
+	, m_push ( "PushInput", *this, boost::bind( &CameraPose::poseIn, this, _1 ))
 	, m_pull ( "PullInput", *this )
+	, m_pushedPose( m_frameInputs )
 {
 }
 
 /** render the object */
 void CameraPose::draw( Measurement::Timestamp& t, int parity )
 {
+	Measurement::Pose pose;
 	if ( m_pull.isConnected() ) 
-		poseIn( m_pull.get( t ), 0 );
+		pose = m_pull.get( t );
+	else
+	{
+		pose = m_pushedPose.get();
+		if ( !pose )
+			return;
+	}
+	m_lastUpdateTime = pose.time();
 
-	glMatrixMode( GL_MODELVIEW );
-	boost::mutex::scoped_lock l( m_poseLock );
-	glMultMatrixd( m_pose );
+	Ubitrack::Math::Pose invpose = ~(*pose);
+	Ubitrack::Math::Matrix< double, 4, 4 > m( invpose.rotation(), invpose.translation() );
+	m_pModule->multModelView( m.content() );
 }
 
 bool CameraPose::hasWaitingEvents()
@@ -51,25 +60,23 @@ bool CameraPose::hasWaitingEvents()
 	return ( m_push.getQueuedEvents() > 0 );
 }
 
+unsigned long CameraPose::generation()
+{
+	if ( m_pull.isConnected() ) return generationAlwaysChanged;
+	return m_frameInputs.generation();
+}
+
 /**
- * callback from Pose port
+ * callback from Pose push port
  * @param pose current transformation
  */
-void CameraPose::poseIn( const Ubitrack::Measurement::Pose& pose, int redraw )
+void CameraPose::poseIn( const Ubitrack::Measurement::Pose& pose )
 {
-	m_lastUpdateTime = pose.time();
-	Ubitrack::Math::Pose invpose = ~(*pose);
-	Ubitrack::Math::Matrix< double, 4, 4 > m( invpose.rotation(), invpose.translation() );
-	double* tmp =  m.content();
-
-	boost::mutex::scoped_lock l( m_poseLock );
-	for ( int i = 0; i < 16; i++ ) m_pose[i] = tmp[i];
+	m_pushedPose.write( pose );
 
 	// the camera pose has changed, so redraw the world
-	if (redraw) {
-		LOG4CPP_DEBUG( logger, "CameraPose: calling invalidate()" );
-		m_pModule->invalidate();
-	}
+	LOG4CPP_DEBUG( logger, "CameraPose: calling invalidate()" );
+	m_pModule->invalidate();
 }
 
 
@@ -25,6 +25,7 @@
 #define __CAMERAPOSE_H__
 
 #include "RenderModule.h"
+#include "FrameValue.h"
 
 namespace Ubitrack { namespace Drivers {
 
@@ -54,16 +55,18 @@ public:
 
 	virtual bool hasWaitingEvents();
 
+	virtual unsigned long generation();
+
 protected:
 
-	void poseIn( const Ubitrack::Measurement::Pose& pose, int redraw );
+	void poseIn( const Ubitrack::Measurement::Pose& pose );
 
 	// pose input
 	PushConsumer< Ubitrack::Measurement::Pose > m_push;
 	PullConsumer< Ubitrack::Measurement::Pose > m_pull;
 
-	double m_pose[16];
-	boost::mutex m_poseLock;
+	// pose from the push input, frozen for the current frame
+	FrameValue< Ubitrack::Measurement::Pose > m_pushedPose;
 };
 
 
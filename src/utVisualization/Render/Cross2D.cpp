@@ -28,6 +28,8 @@ namespace Ubitrack { namespace Drivers {
 Cross2D::Cross2D( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_pushedPosition( m_frameInputs )
+	, m_cross( GL_LINES )
 {
 	if ( subgraph->hasEdge( "Input" ) )
 	{
@@ -46,26 +48,38 @@ Cross2D::Cross2D( const std::string& name, boost::shared_ptr< Graph::UTQLSubgrap
 	}
 }
 
+void Cross2D::glInit()
+{
+	m_cross.clear();
+	m_cross.vertex( -10,  0, 0 );
+	m_cross.vertex(  -2,  0, 0 );
+	m_cross.vertex(   2,  0, 0 );
+	m_cross.vertex(  10,  0, 0 );
+	m_cross.vertex(   0, -10, 0 );
+	m_cross.vertex(   0,  -2, 0 );
+	m_cross.vertex(   0,   2, 0 );
+	m_cross.vertex(   0,  10, 0 );
+}
+
+
 /** render the object */
 void Cross2D::draw( Measurement::Timestamp& t, int num )
 {
 	LOG4CPP_DEBUG( logger, "Cross2D::draw" );
 
+	Ubitrack::Measurement::Position2D pulled;
 	if ( m_pInPositionPull && m_pInPositionPull->isConnected() )
 	{
 		LOG4CPP_DEBUG( logger, "pulling for cross position" );
-		m_crossPosition = m_pInPositionPull->get( t );
+		pulled = m_pInPositionPull->get( t );
 	}
 
-	if ( !m_crossPosition )
+	const Ubitrack::Measurement::Position2D& crossPosition = pulled ? pulled : m_pushedPosition.get();
+	if ( !crossPosition )
 		return;
 		
-	GLfloat x, y;
-	{
-	boost::mutex::scoped_lock l( m_positionLock );
-	x = static_cast< float >( (*m_crossPosition)( 0 ) );
-	y = static_cast< float >( (*m_crossPosition)( 1 ) );
-	}
+	GLfloat x = static_cast< float >( (*crossPosition)( 0 ) );
+	GLfloat y = static_cast< float >( (*crossPosition)( 1 ) );
 	
 	int m_width  = m_pModule->m_width;
 	int m_height = m_pModule->m_height;
@@ -80,34 +94,26 @@ void Cross2D::draw( Measurement::Timestamp& t, int num )
 	glLoadIdentity();
 	gluOrtho2D( 0.0, m_width, 0.0, m_height );
 
-	// prepare fullscreen bitmap without fancy extras
-	glDisable( GL_DEPTH_TEST );
-
-	// save line width
-	GLfloat fOldLineWidth = 1.0;
-	glGetFloatv( GL_LINE_WIDTH, &fOldLineWidth );
+	// prepare fullscreen bitmap without fancy extras, the line width is restored afterwards
+	GLStateCache& state = m_pModule->glState();
+	state.push();
+	state.disable( GL_DEPTH_TEST );
 
 	// draw the cross
 	glColor3f( 1.0, 1.0, 0.0 );
-	glLineWidth( 3.0 );
+	state.lineWidth( 3.0 );
 	glFlush();
 
-	glBegin(GL_LINES);
-
-	glVertex2f( x - 10, y );
-	glVertex2f( x - 2,  y );
-	glVertex2f( x + 2,  y );
-	glVertex2f( x + 10, y );
-	glVertex2f( x, y - 10 );
-	glVertex2f( x, y - 2 );
-	glVertex2f( x, y + 2 );
-	glVertex2f( x, y + 10 );
-	
-	glEnd();
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glTranslatef( x, y, 0 );
+	drawGeometry( m_cross );
+	glPopMatrix();
 
 	// restore the GL state
-	glLineWidth( fOldLineWidth );
-	glEnable( GL_DEPTH_TEST );
+	state.pop();
+	state.enable( GL_DEPTH_TEST );
+	glMatrixMode( GL_PROJECTION );
 	glPopMatrix();
 	glMatrixMode( GL_MODELVIEW );
 }
@@ -115,8 +121,7 @@ void Cross2D::draw( Measurement::Timestamp& t, int num )
 void Cross2D::crossPositionIn( const Ubitrack::Measurement::Position2D& pos )
 {
 	LOG4CPP_DEBUG( logger, "received cross position " << pos );
-	boost::mutex::scoped_lock l( m_positionLock );
-	m_crossPosition = pos;
+	m_pushedPosition.write( pos );
 	m_pModule->invalidate( this );
 }
 
@@ -125,4 +130,11 @@ bool Cross2D::hasWaitingEvents()
 	return m_pInPositionPush && m_pInPositionPush->getQueuedEvents() > 0;
 }
 
+unsigned long Cross2D::generation()
+{
+	if ( m_pInPositionPull && m_pInPositionPull->isConnected() )
+		return generationAlwaysChanged;
+	return m_frameInputs.generation();
+}
+
 } } // namespace Ubitrack::Drivers
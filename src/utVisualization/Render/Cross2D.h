@@ -49,6 +49,9 @@ public:
 	Cross2D( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
+	/** builds the mesh of the cross */
+	virtual void glInit();
+
 	/** render the object */
 	virtual void draw( Measurement::Timestamp& t, int num );
 
@@ -61,12 +64,17 @@ public:
 	/** check whether there are events waiting in the queue */
 	virtual bool hasWaitingEvents();
 
+	virtual unsigned long generation();
+
 protected:
-	boost::mutex m_positionLock;
-	Ubitrack::Measurement::Position2D m_crossPosition;
+	/** position from the push input, frozen for the current frame */
+	FrameValue< Ubitrack::Measurement::Position2D > m_pushedPosition;
 	boost::scoped_ptr< Ubitrack::Dataflow::PushConsumer< Ubitrack::Measurement::Position2D > > m_pInPositionPush;
 	boost::scoped_ptr< Ubitrack::Dataflow::PullConsumer< Ubitrack::Measurement::Position2D > > m_pInPositionPull;
 
+	/** lines of the cross around the origin, moved to the position when drawn */
+	GLGeometry m_cross;
+
 };
 
 } } // namespace Ubitrack::Drivers
@@ -35,7 +35,10 @@ DirectionLine::DirectionLine( const std::string& name, boost::shared_ptr< Graph:
 	: VirtualObject( name, subgraph, componentKey, pModule )
 	, m_target_port( "TargetPosition", *this, boost::bind( &DirectionLine::dataIn, this, _1, 1 ))
 	, m_source_port( "SourcePosition", *this )
+	, m_line( m_frameInputs )
 	, m_thickness ( 0.5 )
+	, m_mesh( GL_LINES, 0, GL_DYNAMIC_DRAW )
+	, m_meshGeneration( 0 )
 {
 	// read parameters
 	subgraph->m_DataflowAttributes.getAttributeData( "thickness", m_thickness );
@@ -66,24 +69,28 @@ DirectionLine::DirectionLine( const std::string& name, boost::shared_ptr< Graph:
 /** render the object */
 void DirectionLine::draw( Measurement::Timestamp& t, int parity )
 {
-	boost::mutex::scoped_lock l( m_lock );
+	if ( m_mesh.empty() || m_meshGeneration != m_frameInputs.generation() )
+	{
+		const Line& line = m_line.get();
+		m_mesh.clear();
+		m_mesh.vertex( (float)line.source[0], (float)line.source[1], (float)line.source[2] );
+		m_mesh.vertex( (float)line.target[0], (float)line.target[1], (float)line.target[2] );
+		m_meshGeneration = m_frameInputs.generation();
+	}
 
-	glEnable ( GL_LINE_STIPPLE );
-	glEnable ( GL_LINE_SMOOTH );
+	// the line has no normals, with lighting its color would depend on the last normal set by another object
+	GLStateCache& state = m_pModule->glState();
+	state.push();
+	state.disable( GL_LIGHTING );
+	state.enable( GL_LINE_STIPPLE );
+	state.enable( GL_LINE_SMOOTH );
 	
-	glLineWidth( (float)m_thickness );
-
-	// TODO Dummy cone, if not rendered, the color of the line below will be wrong!
-	glutWireCone( 1.0, 1.0, 1, 1 );
+	state.lineWidth( (float)m_thickness );
 
 	glColor4f( (float)m_rgba[0], (float)m_rgba[1], (float)m_rgba[2], (float)m_rgba[3] );
 	glLineStipple ( 1, 0x0F0F );
-	glBegin(GL_LINES);
-	glVertex3f( (float)m_source_position[0], (float)m_source_position[1], (float)m_source_position[2] );
-	glVertex3f( (float)m_target_position[0], (float)m_target_position[1], (float)m_target_position[2] );
-	glEnd();
-	glDisable( GL_LINE_STIPPLE );
-	glDisable ( GL_LINE_SMOOTH );
+	drawGeometry( m_mesh );
+	state.pop();
 }
 
 
@@ -95,10 +102,10 @@ bool DirectionLine::hasWaitingEvents()
 
 void DirectionLine::dataIn( const Ubitrack::Measurement::Position& pos, int redraw )
 {
-	boost::mutex::scoped_lock l( m_lock );
-
-	m_target_position = *pos;
-	m_source_position = *(m_source_port.get( pos.time() ));
+	Line line;
+	line.target = *pos;
+	line.source = *(m_source_port.get( pos.time() ));
+	m_line.write( line );
 	
 	// redraw the world
 	m_pModule->invalidate();
@@ -68,19 +68,29 @@ protected:
 	 */
 	void dataIn( const Ubitrack::Measurement::Position& pos, int redraw );
 
-	/// target position pushed measurement
-	Math::Vector< double, 3 > m_target_position;
+	struct Line
+	{
+		/// target position pushed measurement
+		Math::Vector< double, 3 > target;
 
-	/// source position pulled measurement
-	Math::Vector< double, 3 > m_source_position;
+		/// source position pulled measurement
+		Math::Vector< double, 3 > source;
+	};
 
-	boost::mutex m_lock;
+	/// the line of the last measurement, frozen for the current frame
+	FrameValue< Line > m_line;
 
 	/// Thickness of line
 	double m_thickness;
 
 	/// Color RGBA value of line
 	double m_rgba[4];
+
+	/// mesh of the line, updated when a new line is latched
+	GLGeometry m_mesh;
+
+	/// input generation of the line in m_mesh
+	unsigned long m_meshGeneration;
 };
 
 
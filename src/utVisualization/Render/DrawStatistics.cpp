@@ -0,0 +1,128 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Lock-free duration statistics of the renderer.
+ */
+
+#include "DrawStatistics.h"
+
+#include <sstream>
+#include <iomanip>
+
+namespace Ubitrack { namespace Drivers {
+
+
+DrawStatistics::Snapshot::Snapshot()
+	: count( 0 )
+	, total( 0 )
+	, max( 0 )
+	, intervalMax( 0 )
+{
+	for ( int i = 0; i < nBuckets; i++ )
+		histogram[ i ] = 0;
+}
+
+
+DrawStatistics::Snapshot DrawStatistics::Snapshot::operator-( const Snapshot& earlier ) const
+{
+	Snapshot result( *this );
+	result.count -= earlier.count;
+	result.total -= earlier.total;
+	result.max = intervalMax;
+	for ( int i = 0; i < nBuckets; i++ )
+		result.histogram[ i ] -= earlier.histogram[ i ];
+	return result;
+}
+
+
+double DrawStatistics::Snapshot::quantileMs( double q ) const
+{
+	boost::uint64_t target = boost::uint64_t( q * count );
+	boost::uint64_t sum = 0;
+	for ( int i = 0; i < nBuckets; i++ )
+	{
+		sum += histogram[ i ];
+		if ( sum > target )
+			return 1e-3 * double( boost::uint64_t( 1 ) << i );
+	}
+	return maxMs();
+}
+
+
+std::string DrawStatistics::Snapshot::toString() const
+{
+	std::ostringstream s;
+	s << std::fixed << std::setprecision( 3 ) << count << " samples, " << 1e-6 * double( total ) << " ms total, " 
+		<< meanMs() << " ms mean, <" << quantileMs( 0.5 ) << " ms median, <" << quantileMs( 0.99 ) << " ms 99%, "
+		<< maxMs() << " ms max";
+	return s.str();
+}
+
+
+DrawStatistics::DrawStatistics()
+	: m_count( 0 )
+	, m_total( 0 )
+	, m_max( 0 )
+	, m_intervalMax( 0 )
+{
+	for ( int i = 0; i < nBuckets; i++ )
+		m_histogram[ i ] = 0;
+}
+
+
+void DrawStatistics::add( Measurement::Timestamp duration )
+{
+	int bucket = 0;
+	for ( Measurement::Timestamp us = duration / 1000; us && bucket < nBuckets - 1; us >>= 1 )
+		bucket++;
+
+	m_histogram[ bucket ].fetch_add( 1, boost::memory_order_relaxed );
+	m_total.fetch_add( duration, boost::memory_order_relaxed );
+	m_count.fetch_add( 1, boost::memory_order_release );
+
+	// only the render thread writes, so a plain compare is sufficient
+	if ( duration > m_max.load( boost::memory_order_relaxed ) )
+		m_max.store( duration, boost::memory_order_relaxed );
+	if ( duration > m_intervalMax.load( boost::memory_order_relaxed ) )
+		m_intervalMax.store( duration, boost::memory_order_relaxed );
+}
+
+
+DrawStatistics::Snapshot DrawStatistics::snapshot( bool bResetInterval )
+{
+	Snapshot s;
+	s.count = m_count.load( boost::memory_order_acquire );
+	s.total = m_total.load( boost::memory_order_relaxed );
+	s.max = m_max.load( boost::memory_order_relaxed );
+	s.intervalMax = bResetInterval ? m_intervalMax.exchange( 0, boost::memory_order_relaxed ) : 
+		m_intervalMax.load( boost::memory_order_relaxed );
+	for ( int i = 0; i < nBuckets; i++ )
+		s.histogram[ i ] = m_histogram[ i ].load( boost::memory_order_relaxed );
+	return s;
+}
+
+
+} } // namespace Ubitrack::Drivers
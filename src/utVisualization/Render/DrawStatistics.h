@@ -0,0 +1,111 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Lock-free duration statistics of the renderer.
+ */
+
+#ifndef __DrawStatistics_h_INCLUDED__
+#define __DrawStatistics_h_INCLUDED__
+
+#include <string>
+
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+
+#include <utMeasurement/Measurement.h>
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Count, total, maximum and a log2 histogram of durations, e.g. the wall time
+ * of a component's draw() or the age of a pose when it reaches the screen.
+ *
+ * add() is called by the render thread, snapshot() may be called from any thread
+ * at any time without blocking the renderer. The maximum of an interval is only reset
+ * by snapshots of the render thread, see snapshot().
+ */
+class DrawStatistics
+{
+public:
+
+	/** number of histogram buckets. Bucket 0 holds times below 1 us, bucket b times in [2^(b-1), 2^b) us. */
+	enum { nBuckets = 24 };
+
+	/** copy of the counters at one point in time */
+	struct Snapshot
+	{
+		Snapshot();
+
+		/** 
+		 * the counts between an earlier snapshot and this one. The maximum is the one of the interval, 
+		 * which is only correct if the earlier snapshot was the last one that reset the interval.
+		 */
+		Snapshot operator-( const Snapshot& earlier ) const;
+
+		/** upper bound of the given quantile (0..1) in milliseconds, derived from the histogram */
+		double quantileMs( double q ) const;
+
+		double meanMs() const
+		{ return count ? 1e-6 * double( total ) / count : 0.0; }
+
+		double maxMs() const
+		{ return 1e-6 * double( max ); }
+
+		/** one line summary for the log */
+		std::string toString() const;
+
+		boost::uint64_t count;
+		boost::uint64_t total;
+		boost::uint64_t max;
+		boost::uint64_t histogram[ nBuckets ];
+
+		/** maximum since the last snapshot that reset the interval */
+		boost::uint64_t intervalMax;
+	};
+
+	DrawStatistics();
+
+	/** adds a duration in nanoseconds */
+	void add( Measurement::Timestamp duration );
+
+	/** @param bResetInterval start a new interval for its maximum, only allowed on the thread that calls add() */
+	Snapshot snapshot( bool bResetInterval = false );
+
+protected:
+
+	boost::atomic< boost::uint64_t > m_count;
+	boost::atomic< boost::uint64_t > m_total;
+	boost::atomic< boost::uint64_t > m_max;
+	boost::atomic< boost::uint64_t > m_intervalMax;
+	boost::atomic< boost::uint64_t > m_histogram[ nBuckets ];
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
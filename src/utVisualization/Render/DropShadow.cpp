@@ -39,6 +39,7 @@ DropShadow::DropShadow( const std::string& name, boost::shared_ptr< Graph::UTQLS
 	, m_width( 1 )
 	, m_height( 1 )
 	, m_bInitialized( false )
+	, m_quad( GL_TRIANGLE_STRIP, GLGeometry::normals | GLGeometry::texCoords )
 {
 	// read parameters
 	Graph::UTQLSubgraph::NodePtr objectNode = subgraph->getNode( "Object" );
@@ -56,14 +57,33 @@ DropShadow::~DropShadow()
 }
 
 
+void DropShadow::glInit()
+{
+	float w = float( m_width / 2 );
+	float h = float( m_height / 2 );
+
+	m_quad.clear();
+	m_quad.normal( 0, 0, 1 );
+	m_quad.texCoord( 0, 0 );
+	m_quad.vertex( -w, -h, 0 );
+	m_quad.texCoord( 1, 0 );
+	m_quad.vertex(  w, -h, 0 );
+	m_quad.texCoord( 0, 1 );
+	m_quad.vertex( -w,  h, 0 );
+	m_quad.texCoord( 1, 1 );
+	m_quad.vertex(  w,  h, 0 );
+}
+
+
 void DropShadow::draw3DContent( Measurement::Timestamp& t, int )
 {
+	GLStateCache& state = m_pModule->glState();
 	if ( !m_bInitialized )
 	{
 		// init opengl
-		glEnable( GL_TEXTURE_2D );
+		state.enable( GL_TEXTURE_2D );
 		glGenTextures( 1, &m_texture );
-		glBindTexture( GL_TEXTURE_2D, m_texture );
+		state.bindTexture2D( m_texture );
 
 		// create the shadow texture
 		const double b = 0.5; // arbitrary value >= 0
@@ -82,64 +102,27 @@ void DropShadow::draw3DContent( Measurement::Timestamp& t, int )
 
 		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData );
 
-		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		state.blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 		
 		m_bInitialized = true;
 	}
 	
-	// save old state
-	GLboolean oldCullMode;
-	glGetBooleanv( GL_CULL_FACE, &oldCullMode );
-	
-	GLboolean oldBlendMode;
-	glGetBooleanv( GL_BLEND, &oldBlendMode );
-	
-	GLboolean oldLightingMode;
-	glGetBooleanv( GL_LIGHTING, &oldLightingMode );
-
-	GLint oldTexEnvMode;
-	glGetTexEnviv( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &oldTexEnvMode );
-	
-	// set new state
-	glEnable( GL_TEXTURE_2D );
-	glEnable( GL_CULL_FACE );
-	glEnable( GL_BLEND );
-	glDisable( GL_LIGHTING );
-	glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+	// set new state, the old one is restored afterwards
+	state.push();
+	state.enable( GL_TEXTURE_2D );
+	state.enable( GL_CULL_FACE );
+	state.enable( GL_BLEND );
+	state.disable( GL_LIGHTING );
+	state.texEnvMode( GL_MODULATE );
 
 	// draw shadow
-	glBindTexture( GL_TEXTURE_2D, m_texture );
-	glBegin( GL_TRIANGLE_STRIP );
-		glNormal3d( 0, 0, 1 );
-		glTexCoord2d( 0, 0 );
-		glVertex3d( -m_width / 2, -m_height / 2, 0 );
-		
-		glNormal3d( 0, 0, 1 );
-		glTexCoord2d( 1, 0 );
-		glVertex3d(  m_width / 2, -m_height / 2, 0 );
-		
-		glNormal3d( 0, 0, 1 );
-		glTexCoord2d( 0, 1 );
-		glVertex3d( -m_width / 2,  m_height / 2, 0 );
-		
-		glNormal3d( 0, 0, 1 );
-		glTexCoord2d( 1, 1 );
-		glVertex3d(  m_width / 2,  m_height / 2, 0 );
-	glEnd();
+	state.bindTexture2D( m_texture );
+	drawGeometry( m_quad );
 
 	// restore old state
-	glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, oldTexEnvMode );
-	
-	if ( !oldBlendMode )
-		glDisable( GL_BLEND );
-		
-	if ( !oldCullMode )
-		glDisable( GL_CULL_FACE );
-		
-	if ( oldLightingMode )
-		glEnable( GL_LIGHTING );
+	state.pop();
 
 	glPopMatrix();
 }
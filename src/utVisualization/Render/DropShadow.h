@@ -57,6 +57,9 @@ public:
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
 	~DropShadow();
+
+	/** builds the mesh of the shadow */
+	virtual void glInit();
 		
 	/** render the object */
 	virtual void draw3DContent( Measurement::Timestamp&, int );
@@ -66,6 +69,9 @@ protected:
 	double m_width;
 	double m_height;
 	bool m_bInitialized;
+
+	/** textured quad of the shadow */
+	GLGeometry m_quad;
 };
 
 
@@ -66,9 +66,7 @@ void ErrorEllipsoid::draw()
 	// set transformation
 	//glMatrixMode( GL_MODELVIEW );
 	glPushMatrix();
-	glTranslated( m_position( 0 ), m_position( 1 ), m_position( 2 ) );
-	glMultMatrixd( m_rotation.content() );
-	glScaled( m_sizes( 0 ), m_sizes( 1 ), m_sizes( 2 ) );
+	transform();
 
 	// draw sphere
 	gluSphere( m_pQuadric, 1.0, 20, 10 );
@@ -77,6 +75,14 @@ void ErrorEllipsoid::draw()
 }
 
 
+void ErrorEllipsoid::transform()
+{
+	glTranslated( m_position( 0 ), m_position( 1 ), m_position( 2 ) );
+	glMultMatrixd( m_rotation.content() );
+	glScaled( m_sizes( 0 ), m_sizes( 1 ), m_sizes( 2 ) );
+}
+
+
 void ErrorEllipsoid::setCovariance( const Math::Matrix< double, 3, 3 >& covariance )
 {
 	ublas::subrange( m_rotation, 0, 3, 0, 3 ) = covariance;
@@ -63,6 +63,9 @@ public:
 	/** renders the ellipsoid */
 	void draw();
 
+	/** multiplies the current matrix with the transformation of a unit sphere into the ellipsoid */
+	void transform();
+
 	/** returns the position */
 	const Math::Vector< double, 3 >& position() const
 	{ return m_position; }
@@ -0,0 +1,113 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Wake-up handling for render threads.
+ */
+
+#include "FrameScheduler.h"
+
+#include <iomanip>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& loggerStats( log4cpp::Category::getInstance( "Drivers.Render.Stats" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+// interval between two statistics outputs
+static const Measurement::Timestamp g_reportInterval = 10000000000LL;
+
+
+FrameScheduler::FrameScheduler( const std::string& sName )
+	: m_sName( sName )
+	, m_bPending( false )
+	, m_requestTime( 0 )
+	, m_lastReport( 0 )
+{
+}
+
+
+void FrameScheduler::wakeup()
+{
+	boost::mutex::scoped_lock l( m_mutex );
+
+	if ( !m_bPending )
+	{
+		m_bPending = true;
+		m_requestTime = Measurement::now();
+		m_wakeup.notify_one();
+	}
+}
+
+
+bool FrameScheduler::waitUntil( Measurement::Timestamp deadline )
+{
+	boost::mutex::scoped_lock l( m_mutex );
+
+	Measurement::Timestamp now = Measurement::now();
+	while ( !m_bPending && ( deadline == 0 || now < deadline ) )
+	{
+		if ( deadline == 0 )
+			m_wakeup.wait( l );
+		else
+			m_wakeup.timed_wait( l, boost::posix_time::microseconds( ( deadline - now ) / 1000 + 1 ) );
+		now = Measurement::now();
+	}
+
+	bool bWoken = m_bPending;
+	if ( bWoken )
+	{
+		if ( now > m_requestTime )
+			m_wakeupLatency.add( now - m_requestTime );
+		m_bPending = false;
+	}
+	else
+		m_deadlineLatency.add( now - deadline );
+
+	report( now );
+	return bWoken;
+}
+
+
+void FrameScheduler::report( Measurement::Timestamp now )
+{
+	if ( m_lastReport == 0 )
+		m_lastReport = now;
+	if ( now < m_lastReport + g_reportInterval )
+		return;
+
+	LOG4CPP_INFO( loggerStats, std::fixed << std::setprecision( 3 ) << m_sName
+		<< ": wake-up latency " << m_wakeupLatency.meanMs() << " ms mean, " << m_wakeupLatency.maxMs() << " ms max ("
+		<< m_wakeupLatency.count() << " requests), deadline latency " << m_deadlineLatency.meanMs() << " ms mean, "
+		<< m_deadlineLatency.maxMs() << " ms max (" << m_deadlineLatency.count() << " deadlines)" );
+
+	m_wakeupLatency.reset();
+	m_deadlineLatency.reset();
+	m_lastReport = now;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,142 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Wake-up handling for render threads.
+ *
+ * The render thread sleeps until either the earliest frame deadline
+ * of its windows has passed or another thread requests a wake-up.
+ * Requests are remembered, so a wakeup() that races with the render
+ * thread going to sleep is never lost.
+ */
+
+#ifndef __FrameScheduler_h_INCLUDED__
+#define __FrameScheduler_h_INCLUDED__
+
+#include <string>
+
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+
+#include <utMeasurement/Measurement.h>
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * Collects count, mean and maximum of a latency.
+ * Not thread-safe, each instance is only used by a single thread.
+ */
+class LatencyStatistics
+{
+public:
+	LatencyStatistics()
+	{ reset(); }
+
+	/** adds a latency sample in nanoseconds */
+	void add( Measurement::Timestamp latency )
+	{
+		m_count++;
+		m_sum += latency;
+		if ( latency > m_max )
+			m_max = latency;
+	}
+
+	/** number of samples since the last reset */
+	unsigned long count() const
+	{ return m_count; }
+
+	/** mean latency in milliseconds */
+	double meanMs() const
+	{ return m_count ? 1e-6 * double( m_sum ) / m_count : 0.0; }
+
+	/** maximum latency in milliseconds */
+	double maxMs() const
+	{ return 1e-6 * double( m_max ); }
+
+	void reset()
+	{ m_count = 0; m_sum = 0; m_max = 0; }
+
+protected:
+	unsigned long m_count;
+	Measurement::Timestamp m_sum;
+	Measurement::Timestamp m_max;
+};
+
+
+/**
+ * @ingroup driver_components
+ * Sleeps a render thread until its next frame deadline or an explicit wake-up request.
+ */
+class FrameScheduler
+{
+public:
+
+	/**
+	 * Constructor
+	 * @param sName name used for the periodic statistics output
+	 */
+	FrameScheduler( const std::string& sName );
+
+	/** request the render thread to wake up. May be called from any thread. */
+	void wakeup();
+
+	/**
+	 * Block the calling (render) thread until the deadline has passed or wakeup() was called.
+	 * Returns immediately if a wake-up request is already pending.
+	 * @param deadline absolute wake-up time, 0 to wait for a wakeup() only
+	 * @return true if the thread was woken by a request, false if the deadline has passed
+	 */
+	bool waitUntil( Measurement::Timestamp deadline );
+
+protected:
+
+	/** writes the statistics to the log every few seconds */
+	void report( Measurement::Timestamp now );
+
+	std::string m_sName;
+
+	boost::mutex m_mutex;
+	boost::condition m_wakeup;
+
+	/** a wake-up has been requested but not yet consumed */
+	bool m_bPending;
+
+	/** time of the first unconsumed wake-up request */
+	Measurement::Timestamp m_requestTime;
+
+	/** time from a wakeup() request until the render thread runs again */
+	LatencyStatistics m_wakeupLatency;
+
+	/** time from a passed deadline until the render thread runs again */
+	LatencyStatistics m_deadlineLatency;
+
+	Measurement::Timestamp m_lastReport;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Inputs of render components that are frozen for the duration of a frame.
+ */
+
+#ifndef __FrameValue_h_INCLUDED__
+#define __FrameValue_h_INCLUDED__
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "TripleBuffer.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Interface of a frame value, used by FrameInputs.
+ */
+class FrameValueBase
+{
+public:
+	virtual ~FrameValueBase()
+	{}
+
+	/**
+	 * takes the latest written value as the value of the next frame
+	 * @return true if the value has changed
+	 */
+	virtual bool latch() = 0;
+};
+
+
+/**
+ * @ingroup driver_components
+ * The frame values of a component. 
+ * VirtualCamera::display() latches the inputs of all components before the first draw(),
+ * so all components see their inputs as of the same instant.
+ */
+class FrameInputs
+{
+public:
+
+	FrameInputs()
+		: m_generation( 0 )
+	{}
+
+	/** registers a value, called by the FrameValue constructor */
+	void add( FrameValueBase* value )
+	{ m_values.push_back( value ); }
+
+	/** latches all values, called by the render thread at the start of a frame */
+	void latch()
+	{
+		bool bChanged = false;
+		for ( std::vector< FrameValueBase* >::iterator it = m_values.begin(); it != m_values.end(); it++ )
+			bChanged = (*it)->latch() || bChanged;
+		if ( bChanged )
+			m_generation++;
+	}
+
+	/** number of frames in which any of the values has changed, used by the render thread */
+	unsigned long generation() const
+	{ return m_generation; }
+
+protected:
+	std::vector< FrameValueBase* > m_values;
+	unsigned long m_generation;
+};
+
+
+/**
+ * @ingroup driver_components
+ * An input of a render component, written by a dataflow thread and read by draw().
+ *
+ * Writes go to a TripleBuffer, the render thread picks up the latest one when the frame
+ * starts. get() returns the same value during the whole frame and never blocks.
+ * The value must be a member of the component that owns \p inputs.
+ */
+template< class T >
+class FrameValue
+	: public FrameValueBase
+{
+public:
+
+	FrameValue( FrameInputs& inputs )
+	{ inputs.add( this ); }
+
+	FrameValue( FrameInputs& inputs, const T& initial )
+		: m_buffer( initial )
+	{ inputs.add( this ); }
+
+	/** publishes a new value, called by the (single) writer thread */
+	void write( const T& value )
+	{ m_buffer.write( value ); }
+
+	virtual bool latch()
+	{ return m_buffer.update(); }
+
+	/** value of the current frame, the initial value before the first write */
+	const T& get() const
+	{ return m_buffer.read(); }
+protected:
+	TripleBuffer< T > m_buffer;
+};
+
+
+/**
+ * @ingroup driver_components
+ * An input of a render component that keeps all values written between two frames.
+ *
+ * The mutex is only held to append a value and to swap the lists when the frame
+ * starts, draw() reads the values of the current frame without locking.
+ * The value must be a member of the component that owns \p inputs.
+ */
+template< class T >
+class FrameQueue
+	: public FrameValueBase
+{
+public:
+
+	FrameQueue( FrameInputs& inputs )
+	{ inputs.add( this ); }
+
+	/** appends a value, may be called from any thread */
+	void push( const T& value )
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		m_pending.push_back( value );
+	}
+
+	virtual bool latch()
+	{
+		m_frame.clear();
+		boost::mutex::scoped_lock l( m_mutex );
+		m_frame.swap( m_pending );
+		return !m_frame.empty();
+	}
+
+	/** the values written since the previous frame */
+	const std::vector< T >& get() const
+	{ return m_frame; }
+
+protected:
+	boost::mutex m_mutex;
+	std::vector< T > m_pending;
+	std::vector< T > m_frame;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
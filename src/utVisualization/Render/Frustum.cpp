@@ -0,0 +1,271 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Bounding boxes and view-frustum culling of tracked objects.
+ */
+
+#include "Frustum.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <utMath/Matrix.h>
+
+namespace Ubitrack { namespace Drivers {
+
+
+void BoundingBox::clear()
+{
+	for ( unsigned i = 0; i < 3; i++ )
+	{
+		m_min[ i ] = 1e300;
+		m_max[ i ] = -1e300;
+	}
+}
+
+
+void BoundingBox::extend( double x, double y, double z )
+{
+	double p[ 3 ] = { x, y, z };
+	for ( unsigned i = 0; i < 3; i++ )
+	{
+		if ( p[ i ] < m_min[ i ] )
+			m_min[ i ] = p[ i ];
+		if ( p[ i ] > m_max[ i ] )
+			m_max[ i ] = p[ i ];
+	}
+}
+
+
+void BoundingBox::extend( const BoundingBox& box, const double* m )
+{
+	if ( box.empty() )
+		return;
+
+	for ( unsigned corner = 0; corner < 8; corner++ )
+	{
+		double x = corner & 1 ? box.m_max[ 0 ] : box.m_min[ 0 ];
+		double y = corner & 2 ? box.m_max[ 1 ] : box.m_min[ 1 ];
+		double z = corner & 4 ? box.m_max[ 2 ] : box.m_min[ 2 ];
+		extend( m[ 0 ] * x + m[ 4 ] * y + m[ 8 ] * z + m[ 12 ],
+			m[ 1 ] * x + m[ 5 ] * y + m[ 9 ] * z + m[ 13 ],
+			m[ 2 ] * x + m[ 6 ] * y + m[ 10 ] * z + m[ 14 ] );
+	}
+}
+
+
+void BoundingBox::center( double c[ 3 ] ) const
+{
+	for ( unsigned i = 0; i < 3; i++ )
+		c[ i ] = 0.5 * ( m_min[ i ] + m_max[ i ] );
+}
+
+
+double BoundingBox::radius() const
+{
+	double sum = 0.0;
+	for ( unsigned i = 0; i < 3; i++ )
+		sum += ( m_max[ i ] - m_min[ i ] ) * ( m_max[ i ] - m_min[ i ] );
+	return 0.5 * sqrt( sum );
+}
+
+
+Frustum::Frustum()
+	: m_bValid( false )
+	, m_viewportHeight( 0 )
+	, m_bEnabled( true )
+	, m_culledFrame( 0 )
+	, m_culledLastFrame( 0 )
+	, m_tested( 0 )
+	, m_culled( 0 )
+{
+	// GL starts with identity matrices, the plane matrices differ so the first update() extracts the planes
+	for ( unsigned i = 0; i < 16; i++ )
+	{
+		m_projection[ i ] = m_modelView[ i ] = i % 5 ? 0.0 : 1.0;
+		m_planeProjection[ i ] = m_planeModelView[ i ] = 0.0;
+	}
+}
+
+
+void Frustum::setProjection( const double* m )
+{
+	memcpy( m_projection, m, sizeof( m_projection ) );
+	m_bValid = false;
+}
+
+
+void Frustum::setModelView( const double* m )
+{
+	memcpy( m_modelView, m, sizeof( m_modelView ) );
+	m_bValid = false;
+}
+
+
+void Frustum::update()
+{
+	m_bValid = true;
+	if ( memcmp( m_projection, m_planeProjection, sizeof( m_projection ) ) == 0 && 
+		memcmp( m_modelView, m_planeModelView, sizeof( m_modelView ) ) == 0 )
+		return;
+
+	memcpy( m_planeProjection, m_projection, sizeof( m_projection ) );
+	memcpy( m_planeModelView, m_modelView, sizeof( m_modelView ) );
+	const double* projection = m_projection;
+	const double* modelView = m_modelView;
+
+	// rows of clip = projection * modelView, both column-major
+	double rows[ 4 ][ 4 ];
+	for ( unsigned r = 0; r < 4; r++ )
+		for ( unsigned c = 0; c < 4; c++ )
+		{
+			double sum = 0.0;
+			for ( unsigned k = 0; k < 4; k++ )
+				sum += projection[ k * 4 + r ] * modelView[ c * 4 + k ];
+			rows[ r ][ c ] = sum;
+		}
+
+	// -w <= x, y, z <= w
+	for ( unsigned p = 0; p < 6; p++ )
+	{
+		double sign = p % 2 ? -1.0 : 1.0;
+		double length = 0.0;
+		for ( unsigned c = 0; c < 4; c++ )
+		{
+			m_planes[ p ][ c ] = rows[ 3 ][ c ] + sign * rows[ p / 2 ][ c ];
+			if ( c < 3 )
+				length += m_planes[ p ][ c ] * m_planes[ p ][ c ];
+		}
+
+		length = sqrt( length );
+		if ( length > 0.0 )
+			for ( unsigned c = 0; c < 4; c++ )
+				m_planes[ p ][ c ] /= length;
+	}
+}
+
+
+bool Frustum::isVisible( const Math::Pose& pose, const BoundingBox& box )
+{
+	if ( !m_bEnabled )
+		return true;
+	if ( !m_bValid )
+		update();
+	m_tested++;
+
+	Math::Matrix< double, 4, 4 > matrix( pose.rotation(), pose.translation() );
+	const double* m = matrix.content();
+
+	// the pose is rigid, so the radius of the sphere stays the same
+	double local[ 3 ];
+	box.center( local );
+	double center[ 3 ];
+	for ( unsigned i = 0; i < 3; i++ )
+		center[ i ] = m[ i ] * local[ 0 ] + m[ 4 + i ] * local[ 1 ] + m[ 8 + i ] * local[ 2 ] + m[ 12 + i ];
+	double radius = box.radius();
+
+	bool bIntersects = false;
+	for ( unsigned p = 0; p < 6; p++ )
+	{
+		const double* plane = m_planes[ p ];
+		double distance = plane[ 0 ] * center[ 0 ] + plane[ 1 ] * center[ 1 ] + plane[ 2 ] * center[ 2 ] + plane[ 3 ];
+		if ( distance < -radius )
+		{
+			m_culled++;
+			m_culledFrame++;
+			return false;
+		}
+		if ( distance < radius )
+			bIntersects = true;
+	}
+
+	if ( !bIntersects )
+		return true;
+
+	// the sphere is partly outside, try the box with the planes in object coordinates
+	for ( unsigned p = 0; p < 6; p++ )
+	{
+		const double* plane = m_planes[ p ];
+		double objectPlane[ 4 ];
+		for ( unsigned c = 0; c < 4; c++ )
+			objectPlane[ c ] = plane[ 0 ] * m[ c * 4 ] + plane[ 1 ] * m[ c * 4 + 1 ] + plane[ 2 ] * m[ c * 4 + 2 ] + plane[ 3 ] * m[ c * 4 + 3 ];
+
+		// the corner furthest inside
+		double distance = objectPlane[ 3 ];
+		for ( unsigned i = 0; i < 3; i++ )
+			distance += objectPlane[ i ] * ( objectPlane[ i ] > 0.0 ? box.max()[ i ] : box.min()[ i ] );
+		if ( distance < 0.0 )
+		{
+			m_culled++;
+			m_culledFrame++;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+double Frustum::pixelsPerUnit( const Math::Pose& pose, const BoundingBox& box )
+{
+	Math::Matrix< double, 4, 4 > matrix( pose.rotation(), pose.translation() );
+	const double* m = matrix.content();
+	double local[ 3 ];
+	box.center( local );
+	double world[ 3 ];
+	for ( unsigned i = 0; i < 3; i++ )
+		world[ i ] = m[ i ] * local[ 0 ] + m[ 4 + i ] * local[ 1 ] + m[ 8 + i ] * local[ 2 ] + m[ 12 + i ];
+
+	// the projection maps y / -z_eye into [-1, 1], which covers the viewport height
+	double scale = 0.5 * m_viewportHeight * fabs( m_projection[ 5 ] );
+	if ( m_projection[ 11 ] == 0.0 )
+		return scale;
+
+	double depth = -( m_modelView[ 2 ] * world[ 0 ] + m_modelView[ 6 ] * world[ 1 ] + m_modelView[ 10 ] * world[ 2 ] + m_modelView[ 14 ] );
+	if ( depth <= box.radius() )
+		return 1e30;
+	return scale / depth;
+}
+
+
+void Frustum::frameDone()
+{
+	m_culledLastFrame = m_culledFrame;
+	m_culledFrame = 0;
+}
+
+
+void Frustum::counters( unsigned long& tested, unsigned long& culled )
+{
+	tested = m_tested;
+	culled = m_culled;
+	m_tested = 0;
+	m_culled = 0;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,172 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Bounding boxes and view-frustum culling of tracked objects.
+ */
+
+#ifndef __Frustum_h_INCLUDED__
+#define __Frustum_h_INCLUDED__
+
+#include <utMath/Pose.h>
+
+#include "GL/freeglut.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Axis-aligned bounding box with the sphere around it.
+ */
+class BoundingBox
+{
+public:
+	/** creates an empty box */
+	BoundingBox()
+	{ clear(); }
+
+	void clear();
+
+	bool empty() const
+	{ return m_min[ 0 ] > m_max[ 0 ]; }
+
+	/** adds a point */
+	void extend( double x, double y, double z );
+
+	/** adds the corners of another box transformed by a column-major matrix */
+	void extend( const BoundingBox& box, const double* transform );
+
+	const double* min() const
+	{ return m_min; }
+
+	const double* max() const
+	{ return m_max; }
+
+	/** center of the box and of its bounding sphere */
+	void center( double c[ 3 ] ) const;
+
+	/** radius of the bounding sphere, half the diagonal */
+	double radius() const;
+
+protected:
+	double m_min[ 3 ];
+	double m_max[ 3 ];
+};
+
+
+/**
+ * @ingroup driver_components
+ * Tests bounding boxes of tracked objects against the view frustum of a window.
+ *
+ * The window records the projection and view matrices it and its camera components set, see
+ * VirtualCamera::loadProjection(). The six planes are extracted from their product the first 
+ * time an object is tested after a change, and only if the matrices differ from the ones the 
+ * planes were taken from, so GL is never queried. An object is tested with its bounding sphere 
+ * first and, if the sphere intersects the frustum, with its box.
+ *
+ * One instance exists per VirtualCamera, all methods must be called on its render thread.
+ */
+class Frustum
+{
+public:
+	Frustum();
+
+	/** without culling, isVisible() accepts every object */
+	void setEnabled( bool bEnabled )
+	{ m_bEnabled = bEnabled; }
+
+	/** records the projection matrix (column-major) the following objects are drawn with */
+	void setProjection( const double* m );
+
+	/** records the model-view matrix (column-major) of the view, before any object pose */
+	void setModelView( const double* m );
+
+	/** records the height of the viewport in pixels */
+	void setViewportHeight( int height )
+	{ m_viewportHeight = height; }
+
+	const double* projection() const
+	{ return m_projection; }
+
+	const double* modelView() const
+	{ return m_modelView; }
+
+	/**
+	 * tests an object relative to the current model-view matrix
+	 * @param pose pose of the object, applied to the box before the test
+	 * @param box bounding box of the object in its own coordinates
+	 * @return false if the object is completely outside and can be skipped
+	 */
+	bool isVisible( const Math::Pose& pose, const BoundingBox& box );
+
+	/**
+	 * size on the screen of one unit at the center of the bounding sphere of an object, used to choose detail levels
+	 * @return pixels per unit, very large if the camera is inside the sphere
+	 */
+	double pixelsPerUnit( const Math::Pose& pose, const BoundingBox& box );
+
+	/** ends a frame for the per-frame count */
+	void frameDone();
+
+	/** number of objects culled in the last completed frame */
+	unsigned long culledLastFrame() const
+	{ return m_culledLastFrame; }
+
+	/** returns the number of tested and culled objects since the last call and resets them */
+	void counters( unsigned long& tested, unsigned long& culled );
+
+protected:
+
+	/** extracts the planes, unless the matrices are the ones they were taken from */
+	void update();
+
+	/** planes a*x + b*y + c*z + d >= 0 inside, with unit normals: left, right, bottom, top, near, far */
+	double m_planes[ 6 ][ 4 ];
+
+	/** false if a matrix has been set since the last update() */
+	bool m_bValid;
+
+	/** current matrices and viewport height */
+	double m_projection[ 16 ];
+	double m_modelView[ 16 ];
+	double m_viewportHeight;
+
+	/** matrices the planes were taken from */
+	double m_planeProjection[ 16 ];
+	double m_planeModelView[ 16 ];
+	bool m_bEnabled;
+
+	unsigned long m_culledFrame;
+	unsigned long m_culledLastFrame;
+	unsigned long m_tested;
+	unsigned long m_culled;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
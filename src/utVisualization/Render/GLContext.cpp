@@ -0,0 +1,330 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Native OpenGL contexts that can be used from threads other than the GLUT thread.
+ */
+
+#include "GLContext.h"
+
+#include <cstring>
+
+namespace Ubitrack { namespace Drivers {
+
+#ifdef _WIN32
+
+	WindowGLContext::WindowGLContext()
+		: m_hDC( wglGetCurrentDC() )
+		, m_hGLRC( 0 )
+	{
+		if ( m_hDC )
+			m_hGLRC = wglCreateContext( m_hDC );
+	}
+
+	WindowGLContext::~WindowGLContext()
+	{
+		if ( m_hGLRC )
+			wglDeleteContext( m_hGLRC );
+	}
+
+	bool WindowGLContext::isValid() const
+	{ return m_hGLRC != 0; }
+
+	bool WindowGLContext::makeCurrent()
+	{ return wglMakeCurrent( m_hDC, m_hGLRC ) == TRUE; }
+
+	void WindowGLContext::release()
+	{ wglMakeCurrent( NULL, NULL ); }
+
+	void WindowGLContext::swapBuffers()
+	{ SwapBuffers( m_hDC ); }
+
+#elif __APPLE__
+
+	// GLUT on Apple keeps its drawables private, so there is no second context
+	WindowGLContext::WindowGLContext()
+	{}
+
+	WindowGLContext::~WindowGLContext()
+	{}
+
+	bool WindowGLContext::isValid() const
+	{ return false; }
+
+	bool WindowGLContext::makeCurrent()
+	{ return false; }
+
+	void WindowGLContext::release()
+	{}
+
+	void WindowGLContext::swapBuffers()
+	{}
+
+#else
+
+	WindowGLContext::WindowGLContext()
+		: m_display( glXGetCurrentDisplay() )
+		, m_drawable( glXGetCurrentDrawable() )
+		, m_context( 0 )
+	{
+		GLXContext current = glXGetCurrentContext();
+		if ( !m_display || !current )
+			return;
+
+		// look up the frame buffer configuration of the GLUT context
+		int fbConfigId = 0;
+		int screen = 0;
+		glXQueryContext( m_display, current, GLX_FBCONFIG_ID, &fbConfigId );
+		glXQueryContext( m_display, current, GLX_SCREEN, &screen );
+
+		int attribs[] = { GLX_FBCONFIG_ID, fbConfigId, None };
+		int nConfigs = 0;
+		GLXFBConfig* configs = glXChooseFBConfig( m_display, screen, attribs, &nConfigs );
+		if ( configs && nConfigs > 0 )
+			m_context = glXCreateNewContext( m_display, configs[ 0 ], GLX_RGBA_TYPE, 0, True );
+		if ( configs )
+			XFree( configs );
+	}
+
+	WindowGLContext::~WindowGLContext()
+	{
+		if ( m_context )
+			glXDestroyContext( m_display, m_context );
+	}
+
+	bool WindowGLContext::isValid() const
+	{ return m_context != 0; }
+
+	bool WindowGLContext::makeCurrent()
+	{ return glXMakeCurrent( m_display, m_drawable, m_context ) == True; }
+
+	void WindowGLContext::release()
+	{ glXMakeCurrent( m_display, None, 0 ); }
+
+	void WindowGLContext::swapBuffers()
+	{ glXSwapBuffers( m_display, m_drawable ); }
+
+#endif
+
+
+#ifdef HAVE_EGL
+
+	static GLProc eglLoader( const char* name )
+	{ return (GLProc)eglGetProcAddress( name ); }
+
+	HeadlessGLContext::HeadlessGLContext( int width, int height )
+		: m_width( width )
+		, m_height( height )
+		, m_framebuffer( 0 )
+		, m_colorBuffer( 0 )
+		, m_depthBuffer( 0 )
+		, m_display( eglGetDisplay( EGL_DEFAULT_DISPLAY ) )
+		, m_context( EGL_NO_CONTEXT )
+		, m_surface( EGL_NO_SURFACE )
+	{
+		EGLint major, minor;
+		if ( m_display == EGL_NO_DISPLAY || !eglInitialize( m_display, &major, &minor ) )
+		{
+			m_display = EGL_NO_DISPLAY;
+			return;
+		}
+
+		static const EGLint configAttribs[] = { 
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, 
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_DEPTH_SIZE, 24,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, 
+			EGL_NONE };
+		EGLConfig config;
+		EGLint nConfigs = 0;
+		if ( !eglChooseConfig( m_display, configAttribs, &config, 1, &nConfigs ) || nConfigs < 1 )
+			return;
+
+		eglBindAPI( EGL_OPENGL_API );
+		m_context = eglCreateContext( m_display, config, EGL_NO_CONTEXT, 0 );
+
+		// without surfaceless contexts, a tiny pbuffer is needed to make the context current
+		const char* extensions = eglQueryString( m_display, EGL_EXTENSIONS );
+		if ( !extensions || !strstr( extensions, "EGL_KHR_surfaceless_context" ) )
+		{
+			static const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			m_surface = eglCreatePbufferSurface( m_display, config, pbufferAttribs );
+		}
+	}
+
+	HeadlessGLContext::~HeadlessGLContext()
+	{
+		// the display is not terminated, other contexts may still use it
+		if ( m_surface != EGL_NO_SURFACE )
+			eglDestroySurface( m_display, m_surface );
+		if ( m_context != EGL_NO_CONTEXT )
+			eglDestroyContext( m_display, m_context );
+	}
+
+	bool HeadlessGLContext::isValid() const
+	{ return m_context != EGL_NO_CONTEXT; }
+
+	bool HeadlessGLContext::makeCurrent()
+	{
+		// the client API is thread-local state
+		eglBindAPI( EGL_OPENGL_API );
+		if ( !eglMakeCurrent( m_display, m_surface, m_surface, m_context ) )
+			return false;
+		return createFramebuffer();
+	}
+
+	void HeadlessGLContext::release()
+	{
+		if ( m_framebuffer )
+		{
+			m_extensions.deleteFramebuffers( 1, &m_framebuffer );
+			m_extensions.deleteRenderbuffers( 1, &m_colorBuffer );
+			m_extensions.deleteRenderbuffers( 1, &m_depthBuffer );
+			m_framebuffer = 0;
+		}
+		eglMakeCurrent( m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+	}
+
+	GLProcLoader HeadlessGLContext::procLoader() const
+	{ return eglLoader; }
+
+#elif defined( HAVE_OSMESA )
+
+	static GLProc osMesaLoader( const char* name )
+	{ return (GLProc)OSMesaGetProcAddress( name ); }
+
+	HeadlessGLContext::HeadlessGLContext( int width, int height )
+		: m_width( width )
+		, m_height( height )
+		, m_framebuffer( 0 )
+		, m_colorBuffer( 0 )
+		, m_depthBuffer( 0 )
+		, m_context( OSMesaCreateContextExt( OSMESA_RGBA, 24, 8, 0, 0 ) )
+		, m_buffer( 4 )
+	{}
+
+	HeadlessGLContext::~HeadlessGLContext()
+	{
+		if ( m_context )
+			OSMesaDestroyContext( m_context );
+	}
+
+	bool HeadlessGLContext::isValid() const
+	{ return m_context != 0; }
+
+	bool HeadlessGLContext::makeCurrent()
+	{
+		if ( !OSMesaMakeCurrent( m_context, &m_buffer[ 0 ], GL_UNSIGNED_BYTE, 1, 1 ) )
+			return false;
+		return createFramebuffer();
+	}
+
+	void HeadlessGLContext::release()
+	{
+		if ( m_framebuffer )
+		{
+			m_extensions.deleteFramebuffers( 1, &m_framebuffer );
+			m_extensions.deleteRenderbuffers( 1, &m_colorBuffer );
+			m_extensions.deleteRenderbuffers( 1, &m_depthBuffer );
+			m_framebuffer = 0;
+		}
+		OSMesaMakeCurrent( 0, 0, GL_UNSIGNED_BYTE, 0, 0 );
+	}
+
+	GLProcLoader HeadlessGLContext::procLoader() const
+	{ return osMesaLoader; }
+
+#else
+
+	HeadlessGLContext::HeadlessGLContext( int width, int height )
+		: m_width( width )
+		, m_height( height )
+		, m_framebuffer( 0 )
+		, m_colorBuffer( 0 )
+		, m_depthBuffer( 0 )
+	{}
+
+	HeadlessGLContext::~HeadlessGLContext()
+	{}
+
+	bool HeadlessGLContext::isValid() const
+	{ return false; }
+
+	bool HeadlessGLContext::makeCurrent()
+	{ return false; }
+
+	void HeadlessGLContext::release()
+	{}
+
+	GLProcLoader HeadlessGLContext::procLoader() const
+	{ return GLExtensions::defaultLoader; }
+
+#endif
+
+
+void HeadlessGLContext::swapBuffers()
+{
+	glFlush();
+}
+
+
+bool HeadlessGLContext::createFramebuffer()
+{
+	if ( m_framebuffer )
+		return true;
+
+	m_extensions.load( procLoader() );
+	if ( !m_extensions.hasFramebufferObject() )
+		return false;
+
+	m_extensions.genRenderbuffers( 1, &m_colorBuffer );
+	m_extensions.bindRenderbuffer( GL_RENDERBUFFER, m_colorBuffer );
+	m_extensions.renderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, m_width, m_height );
+
+	m_extensions.genRenderbuffers( 1, &m_depthBuffer );
+	m_extensions.bindRenderbuffer( GL_RENDERBUFFER, m_depthBuffer );
+	m_extensions.renderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height );
+
+	m_extensions.genFramebuffers( 1, &m_framebuffer );
+	m_extensions.bindFramebuffer( GL_FRAMEBUFFER, m_framebuffer );
+	m_extensions.framebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer );
+	m_extensions.framebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer );
+	m_extensions.framebufferRenderbuffer( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer );
+
+	if ( m_extensions.checkFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+	{
+		m_extensions.deleteFramebuffers( 1, &m_framebuffer );
+		m_extensions.deleteRenderbuffers( 1, &m_colorBuffer );
+		m_extensions.deleteRenderbuffers( 1, &m_depthBuffer );
+		m_framebuffer = 0;
+		return false;
+	}
+
+	// the framebuffer stays bound, so all drawing and reading uses it
+	glDrawBuffer( GL_COLOR_ATTACHMENT0 );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+	return true;
+}
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,188 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Native OpenGL contexts that can be used from threads other than the GLUT thread.
+ */
+
+#ifndef __GLContext_h_INCLUDED__
+#define __GLContext_h_INCLUDED__
+
+#include <vector>
+
+#include "GL/freeglut.h"
+#include "GLExtensions.h"
+
+#ifdef _WIN32
+	#include <utUtil/CleanWindows.h>
+#elif __APPLE__
+	#include <OpenGL/OpenGL.h>
+#else
+	#include <GL/glx.h>
+#endif
+
+#ifdef HAVE_EGL
+	#include <EGL/egl.h>
+#elif defined( HAVE_OSMESA )
+	#include <GL/osmesa.h>
+#endif
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Abstract OpenGL context that a render thread makes current and presents from.
+ */
+class GLContext
+{
+public:
+	virtual ~GLContext()
+	{}
+
+	/** false if the context could not be created */
+	virtual bool isValid() const = 0;
+
+	/** binds the context to the calling thread */
+	virtual bool makeCurrent() = 0;
+
+	/** unbinds the context from the calling thread */
+	virtual void release() = 0;
+
+	/** presents the rendered frame */
+	virtual void swapBuffers() = 0;
+
+	/** loader for extension entry points of this context */
+	virtual GLProcLoader procLoader() const
+	{ return GLExtensions::defaultLoader; }
+
+	/** framebuffer object that is drawn into, 0 for the default framebuffer */
+	virtual GLuint framebuffer() const
+	{ return 0; }
+};
+
+
+/**
+ * @ingroup driver_components
+ * Second context on the drawable of a GLUT window.
+ *
+ * GLUT makes the context of a window current whenever it dispatches an event
+ * for it, so the window's own context cannot be handed to another thread.
+ * Instead, this class creates a new context with the same pixel format on the
+ * same drawable. It must be constructed on the GLUT thread while the window is
+ * current. Not supported on Apple, where isValid() always returns false.
+ */
+class WindowGLContext
+	: public GLContext
+{
+public:
+	WindowGLContext();
+
+	~WindowGLContext();
+
+	bool isValid() const;
+
+	bool makeCurrent();
+
+	void release();
+
+	void swapBuffers();
+
+protected:
+
+#ifdef _WIN32
+	HDC m_hDC;
+	HGLRC m_hGLRC;
+#elif __APPLE__
+#else
+	Display* m_display;
+	GLXDrawable m_drawable;
+	GLXContext m_context;
+#endif
+};
+
+
+/**
+ * @ingroup driver_components
+ * Offscreen context without any window system.
+ *
+ * Uses a surfaceless EGL context (HAVE_EGL) or OSMesa (HAVE_OSMESA) and renders
+ * into a framebuffer object of the given size, which stays bound while the
+ * context is current. isValid() returns false if neither is available.
+ */
+class HeadlessGLContext
+	: public GLContext
+{
+public:
+	HeadlessGLContext( int width, int height );
+
+	~HeadlessGLContext();
+
+	bool isValid() const;
+
+	/** also creates and binds the framebuffer object */
+	bool makeCurrent();
+
+	/** also deletes the framebuffer object */
+	void release();
+
+	/** only flushes, there is nothing to present */
+	void swapBuffers();
+
+	GLProcLoader procLoader() const;
+
+	GLuint framebuffer() const
+	{ return m_framebuffer; }
+
+protected:
+
+	/** creates the framebuffer object, the context must be current */
+	bool createFramebuffer();
+
+	int m_width, m_height;
+
+	GLExtensions m_extensions;
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+#ifdef HAVE_EGL
+	EGLDisplay m_display;
+	EGLContext m_context;
+
+	/** 1x1 pbuffer if the implementation does not support surfaceless contexts */
+	EGLSurface m_surface;
+#elif defined( HAVE_OSMESA )
+	OSMesaContext m_context;
+
+	/** OSMesa always needs a color buffer, but it is never rendered to */
+	std::vector< unsigned char > m_buffer;
+#endif
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
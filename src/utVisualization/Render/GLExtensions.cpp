@@ -0,0 +1,362 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * OpenGL extension entry points, loaded per context.
+ */
+
+#include "GLExtensions.h"
+
+#include <string>
+#include <cstdio>
+
+#ifdef _WIN32
+	#include <utUtil/CleanWindows.h>
+#elif __APPLE__
+	#include <dlfcn.h>
+#else
+	#include <GL/glx.h>
+#endif
+
+namespace Ubitrack { namespace Drivers {
+
+
+GLExtensions::GLExtensions()
+	: genFramebuffers( 0 )
+	, deleteFramebuffers( 0 )
+	, bindFramebuffer( 0 )
+	, checkFramebufferStatus( 0 )
+	, framebufferRenderbuffer( 0 )
+	, genRenderbuffers( 0 )
+	, deleteRenderbuffers( 0 )
+	, bindRenderbuffer( 0 )
+	, renderbufferStorage( 0 )
+	, framebufferTexture2D( 0 )
+	, generateMipmap( 0 )
+	, compressedTexImage2D( 0 )
+	, compressedTexSubImage2D( 0 )
+	, genBuffers( 0 )
+	, deleteBuffers( 0 )
+	, bindBuffer( 0 )
+	, bufferData( 0 )
+	, bufferSubData( 0 )
+	, mapBuffer( 0 )
+	, unmapBuffer( 0 )
+	, createShader( 0 )
+	, shaderSource( 0 )
+	, compileShader( 0 )
+	, getShaderiv( 0 )
+	, getShaderInfoLog( 0 )
+	, deleteShader( 0 )
+	, createProgram( 0 )
+	, attachShader( 0 )
+	, linkProgram( 0 )
+	, getProgramiv( 0 )
+	, getProgramInfoLog( 0 )
+	, deleteProgram( 0 )
+	, useProgram( 0 )
+	, getUniformLocation( 0 )
+	, getAttribLocation( 0 )
+	, uniform1i( 0 )
+	, uniform1f( 0 )
+	, uniform4f( 0 )
+	, uniformMatrix3fv( 0 )
+	, uniformMatrix4fv( 0 )
+	, vertexAttribPointer( 0 )
+	, enableVertexAttribArray( 0 )
+	, disableVertexAttribArray( 0 )
+	, drawElementsInstanced( 0 )
+	, vertexAttribDivisor( 0 )
+	, genQueries( 0 )
+	, deleteQueries( 0 )
+	, beginQuery( 0 )
+	, endQuery( 0 )
+	, getQueryObjectiv( 0 )
+	, getQueryObjectui64v( 0 )
+	, m_bPixelBufferObject( false )
+	, m_bTextureFloat( false )
+	, m_bTextureRG( false )
+	, m_bTextureNonPowerOfTwo( false )
+	, m_bTextureCompressionS3TC( false )
+{
+}
+
+
+GLProc GLExtensions::defaultLoader( const char* name )
+{
+#ifdef _WIN32
+	return (GLProc)wglGetProcAddress( name );
+#elif __APPLE__
+	return (GLProc)dlsym( RTLD_DEFAULT, name );
+#else
+	return (GLProc)glXGetProcAddress( (const GLubyte*)name );
+#endif
+}
+
+
+void GLExtensions::load( GLProcLoader loader )
+{
+	if ( !loader )
+		loader = defaultLoader;
+
+	// a window system may return pointers for functions the driver does not support
+	std::string extensions( (const char*)glGetString( GL_EXTENSIONS ) ? (const char*)glGetString( GL_EXTENSIONS ) : "" );
+	const char* versionString = (const char*)glGetString( GL_VERSION );
+	int major = 1;
+	int minor = 0;
+	if ( versionString )
+		sscanf( versionString, "%d.%d", &major, &minor );
+	int version = major * 10 + minor;
+
+	if ( version >= 30 || extensions.find( "GL_ARB_framebuffer_object" ) != std::string::npos )
+	{
+		genFramebuffers = (pglGenFramebuffers)loader( "glGenFramebuffers" );
+		deleteFramebuffers = (pglDeleteFramebuffers)loader( "glDeleteFramebuffers" );
+		bindFramebuffer = (pglBindFramebuffer)loader( "glBindFramebuffer" );
+		checkFramebufferStatus = (pglCheckFramebufferStatus)loader( "glCheckFramebufferStatus" );
+		framebufferRenderbuffer = (pglFramebufferRenderbuffer)loader( "glFramebufferRenderbuffer" );
+		genRenderbuffers = (pglGenRenderbuffers)loader( "glGenRenderbuffers" );
+		deleteRenderbuffers = (pglDeleteRenderbuffers)loader( "glDeleteRenderbuffers" );
+		bindRenderbuffer = (pglBindRenderbuffer)loader( "glBindRenderbuffer" );
+		renderbufferStorage = (pglRenderbufferStorage)loader( "glRenderbufferStorage" );
+		framebufferTexture2D = (pglFramebufferTexture2D)loader( "glFramebufferTexture2D" );
+		generateMipmap = (pglGenerateMipmap)loader( "glGenerateMipmap" );
+	}
+	else if ( extensions.find( "GL_EXT_framebuffer_object" ) != std::string::npos )
+	{
+		genFramebuffers = (pglGenFramebuffers)loader( "glGenFramebuffersEXT" );
+		deleteFramebuffers = (pglDeleteFramebuffers)loader( "glDeleteFramebuffersEXT" );
+		bindFramebuffer = (pglBindFramebuffer)loader( "glBindFramebufferEXT" );
+		checkFramebufferStatus = (pglCheckFramebufferStatus)loader( "glCheckFramebufferStatusEXT" );
+		framebufferRenderbuffer = (pglFramebufferRenderbuffer)loader( "glFramebufferRenderbufferEXT" );
+		genRenderbuffers = (pglGenRenderbuffers)loader( "glGenRenderbuffersEXT" );
+		deleteRenderbuffers = (pglDeleteRenderbuffers)loader( "glDeleteRenderbuffersEXT" );
+		bindRenderbuffer = (pglBindRenderbuffer)loader( "glBindRenderbufferEXT" );
+		renderbufferStorage = (pglRenderbufferStorage)loader( "glRenderbufferStorageEXT" );
+		framebufferTexture2D = (pglFramebufferTexture2D)loader( "glFramebufferTexture2DEXT" );
+		generateMipmap = (pglGenerateMipmap)loader( "glGenerateMipmapEXT" );
+	}
+
+	// all or nothing
+	if ( !genFramebuffers || !deleteFramebuffers || !bindFramebuffer || !checkFramebufferStatus || !framebufferRenderbuffer ||
+		!genRenderbuffers || !deleteRenderbuffers || !bindRenderbuffer || !renderbufferStorage || !framebufferTexture2D )
+		genFramebuffers = 0;
+
+	if ( version >= 15 )
+	{
+		genBuffers = (pglGenBuffers)loader( "glGenBuffers" );
+		deleteBuffers = (pglDeleteBuffers)loader( "glDeleteBuffers" );
+		bindBuffer = (pglBindBuffer)loader( "glBindBuffer" );
+		bufferData = (pglBufferData)loader( "glBufferData" );
+		bufferSubData = (pglBufferSubData)loader( "glBufferSubData" );
+		mapBuffer = (pglMapBuffer)loader( "glMapBuffer" );
+		unmapBuffer = (pglUnmapBuffer)loader( "glUnmapBuffer" );
+	}
+	else if ( extensions.find( "GL_ARB_vertex_buffer_object" ) != std::string::npos )
+	{
+		genBuffers = (pglGenBuffers)loader( "glGenBuffersARB" );
+		deleteBuffers = (pglDeleteBuffers)loader( "glDeleteBuffersARB" );
+		bindBuffer = (pglBindBuffer)loader( "glBindBufferARB" );
+		bufferData = (pglBufferData)loader( "glBufferDataARB" );
+		bufferSubData = (pglBufferSubData)loader( "glBufferSubDataARB" );
+		mapBuffer = (pglMapBuffer)loader( "glMapBufferARB" );
+		unmapBuffer = (pglUnmapBuffer)loader( "glUnmapBufferARB" );
+	}
+
+	if ( !genBuffers || !deleteBuffers || !bindBuffer || !bufferData || !bufferSubData || !mapBuffer || !unmapBuffer )
+		genBuffers = 0;
+
+	m_bPixelBufferObject = genBuffers && ( version >= 21 || 
+		extensions.find( "GL_ARB_pixel_buffer_object" ) != std::string::npos || 
+		extensions.find( "GL_EXT_pixel_buffer_object" ) != std::string::npos );
+
+	// only the GL 2.0 interface, the ARB_shader_objects one uses different handles
+	if ( version >= 20 )
+	{
+		createShader = (pglCreateShader)loader( "glCreateShader" );
+		shaderSource = (pglShaderSource)loader( "glShaderSource" );
+		compileShader = (pglCompileShader)loader( "glCompileShader" );
+		getShaderiv = (pglGetShaderiv)loader( "glGetShaderiv" );
+		getShaderInfoLog = (pglGetShaderInfoLog)loader( "glGetShaderInfoLog" );
+		deleteShader = (pglDeleteShader)loader( "glDeleteShader" );
+		createProgram = (pglCreateProgram)loader( "glCreateProgram" );
+		attachShader = (pglAttachShader)loader( "glAttachShader" );
+		linkProgram = (pglLinkProgram)loader( "glLinkProgram" );
+		getProgramiv = (pglGetProgramiv)loader( "glGetProgramiv" );
+		getProgramInfoLog = (pglGetProgramInfoLog)loader( "glGetProgramInfoLog" );
+		deleteProgram = (pglDeleteProgram)loader( "glDeleteProgram" );
+		useProgram = (pglUseProgram)loader( "glUseProgram" );
+		getUniformLocation = (pglGetUniformLocation)loader( "glGetUniformLocation" );
+		getAttribLocation = (pglGetAttribLocation)loader( "glGetAttribLocation" );
+		uniform1i = (pglUniform1i)loader( "glUniform1i" );
+		uniform1f = (pglUniform1f)loader( "glUniform1f" );
+		uniform4f = (pglUniform4f)loader( "glUniform4f" );
+		uniformMatrix3fv = (pglUniformMatrix3fv)loader( "glUniformMatrix3fv" );
+		uniformMatrix4fv = (pglUniformMatrix4fv)loader( "glUniformMatrix4fv" );
+		vertexAttribPointer = (pglVertexAttribPointer)loader( "glVertexAttribPointer" );
+		enableVertexAttribArray = (pglEnableVertexAttribArray)loader( "glEnableVertexAttribArray" );
+		disableVertexAttribArray = (pglDisableVertexAttribArray)loader( "glDisableVertexAttribArray" );
+	}
+
+	if ( !createShader || !shaderSource || !compileShader || !getShaderiv || !getShaderInfoLog || !deleteShader || 
+		!createProgram || !attachShader || !linkProgram || !getProgramiv || !getProgramInfoLog || !deleteProgram || 
+		!useProgram || !getUniformLocation || !getAttribLocation || !uniform1i || !uniform1f || !uniform4f )
+		createShader = 0;
+
+	// query objects are core since GL 1.5, the 64 bit result comes with timer queries
+	if ( version >= 33 || extensions.find( "GL_ARB_timer_query" ) != std::string::npos )
+	{
+		genQueries = (pglGenQueries)loader( "glGenQueries" );
+		deleteQueries = (pglDeleteQueries)loader( "glDeleteQueries" );
+		beginQuery = (pglBeginQuery)loader( "glBeginQuery" );
+		endQuery = (pglEndQuery)loader( "glEndQuery" );
+		getQueryObjectiv = (pglGetQueryObjectiv)loader( "glGetQueryObjectiv" );
+		getQueryObjectui64v = (pglGetQueryObjectui64v)loader( "glGetQueryObjectui64v" );
+	}
+	else if ( version >= 15 && extensions.find( "GL_EXT_timer_query" ) != std::string::npos )
+	{
+		genQueries = (pglGenQueries)loader( "glGenQueries" );
+		deleteQueries = (pglDeleteQueries)loader( "glDeleteQueries" );
+		beginQuery = (pglBeginQuery)loader( "glBeginQuery" );
+		endQuery = (pglEndQuery)loader( "glEndQuery" );
+		getQueryObjectiv = (pglGetQueryObjectiv)loader( "glGetQueryObjectiv" );
+		getQueryObjectui64v = (pglGetQueryObjectui64v)loader( "glGetQueryObjectui64vEXT" );
+	}
+
+	if ( !genQueries || !deleteQueries || !beginQuery || !endQuery || !getQueryObjectiv || !getQueryObjectui64v )
+		genQueries = 0;
+
+	// per-instance attributes need the divisor, instanced draw calls alone are not enough
+	if ( version >= 33 )
+	{
+		drawElementsInstanced = (pglDrawElementsInstanced)loader( "glDrawElementsInstanced" );
+		vertexAttribDivisor = (pglVertexAttribDivisor)loader( "glVertexAttribDivisor" );
+	}
+	else if ( extensions.find( "GL_ARB_instanced_arrays" ) != std::string::npos )
+	{
+		drawElementsInstanced = (pglDrawElementsInstanced)loader( version >= 31 ? "glDrawElementsInstanced" : "glDrawElementsInstancedARB" );
+		vertexAttribDivisor = (pglVertexAttribDivisor)loader( "glVertexAttribDivisorARB" );
+	}
+
+	if ( !drawElementsInstanced || !vertexAttribDivisor || !uniformMatrix3fv || !uniformMatrix4fv || !vertexAttribPointer || 
+		!enableVertexAttribArray || !disableVertexAttribArray )
+	{
+		drawElementsInstanced = 0;
+		vertexAttribDivisor = 0;
+	}
+
+	m_bTextureFloat = version >= 30 || extensions.find( "GL_ARB_texture_float" ) != std::string::npos;
+	m_bTextureRG = version >= 30 || extensions.find( "GL_ARB_texture_rg" ) != std::string::npos;
+	m_bTextureNonPowerOfTwo = version >= 20 || extensions.find( "GL_ARB_texture_non_power_of_two" ) != std::string::npos;
+
+	// S3TC is not core, but available on practically all desktop drivers
+	if ( version >= 13 )
+	{
+		compressedTexImage2D = (pglCompressedTexImage2D)loader( "glCompressedTexImage2D" );
+		compressedTexSubImage2D = (pglCompressedTexSubImage2D)loader( "glCompressedTexSubImage2D" );
+	}
+	else if ( extensions.find( "GL_ARB_texture_compression" ) != std::string::npos )
+	{
+		compressedTexImage2D = (pglCompressedTexImage2D)loader( "glCompressedTexImage2DARB" );
+		compressedTexSubImage2D = (pglCompressedTexSubImage2D)loader( "glCompressedTexSubImage2DARB" );
+	}
+
+	if ( !compressedTexImage2D || !compressedTexSubImage2D )
+	{
+		compressedTexImage2D = 0;
+		compressedTexSubImage2D = 0;
+	}
+	m_bTextureCompressionS3TC = compressedTexImage2D && extensions.find( "GL_EXT_texture_compression_s3tc" ) != std::string::npos;
+}
+
+
+GLuint GLExtensions::compileShaderSource( GLenum type, const char* source, std::string& log ) const
+{
+	GLuint shader = createShader( type );
+	shaderSource( shader, 1, &source, 0 );
+	compileShader( shader );
+
+	GLint status = 0;
+	getShaderiv( shader, GL_COMPILE_STATUS, &status );
+	if ( status )
+		return shader;
+
+	char buffer[ 1024 ];
+	GLsizei length = 0;
+	getShaderInfoLog( shader, sizeof( buffer ), &length, buffer );
+	log.append( buffer, length );
+	deleteShader( shader );
+	return 0;
+}
+
+
+GLuint GLExtensions::compileProgram( const char* vertexSource, const char* fragmentSource, std::string& log ) const
+{
+	if ( !hasShaders() )
+	{
+		log = "GLSL is not supported";
+		return 0;
+	}
+
+	GLuint vertexShader = 0;
+	if ( vertexSource && !( vertexShader = compileShaderSource( GL_VERTEX_SHADER, vertexSource, log ) ) )
+		return 0;
+
+	GLuint fragmentShader = 0;
+	if ( fragmentSource && !( fragmentShader = compileShaderSource( GL_FRAGMENT_SHADER, fragmentSource, log ) ) )
+	{
+		if ( vertexShader )
+			deleteShader( vertexShader );
+		return 0;
+	}
+
+	GLuint program = createProgram();
+	if ( vertexShader )
+		attachShader( program, vertexShader );
+	if ( fragmentShader )
+		attachShader( program, fragmentShader );
+	linkProgram( program );
+
+	// the shaders are deleted together with the program
+	if ( vertexShader )
+		deleteShader( vertexShader );
+	if ( fragmentShader )
+		deleteShader( fragmentShader );
+
+	GLint status = 0;
+	getProgramiv( program, GL_LINK_STATUS, &status );
+	if ( status )
+		return program;
+
+	char buffer[ 1024 ];
+	GLsizei length = 0;
+	getProgramInfoLog( program, sizeof( buffer ), &length, buffer );
+	log.append( buffer, length );
+	deleteProgram( program );
+	return 0;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,336 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * OpenGL extension entry points, loaded per context.
+ *
+ * GLEW keeps one global set of function pointers that is initialized from
+ * the window system, which does not work for offscreen contexts. The entry
+ * points needed by the render module are therefore loaded per VirtualCamera
+ * through the loader of its context. Members are named without the gl prefix,
+ * so they do not clash with the GLEW macros.
+ */
+
+#ifndef __GLExtensions_h_INCLUDED__
+#define __GLExtensions_h_INCLUDED__
+
+#include "GL/freeglut.h"
+
+#include <cstddef>
+#include <string>
+
+#ifndef APIENTRY
+	#define APIENTRY
+#endif
+
+// buffer objects (GL 1.5, ARB_vertex_buffer_object) and pixel buffer objects (GL 2.1, ARB_pixel_buffer_object)
+#ifndef GL_ARRAY_BUFFER
+	#define GL_ARRAY_BUFFER 0x8892
+	#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+	#define GL_READ_ONLY 0x88B8
+	#define GL_WRITE_ONLY 0x88B9
+	#define GL_STREAM_DRAW 0x88E0
+	#define GL_STREAM_READ 0x88E1
+	#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_DYNAMIC_DRAW
+	#define GL_DYNAMIC_DRAW 0x88E8
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+	#define GL_PIXEL_PACK_BUFFER 0x88EB
+	#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_BGRA
+	#define GL_BGRA 0x80E1
+#endif
+
+// compressed textures (GL 1.3, EXT_texture_compression_s3tc)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+	#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+	#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+// shaders (GL 2.0)
+#ifndef GL_FRAGMENT_SHADER
+	#define GL_FRAGMENT_SHADER 0x8B30
+	#define GL_VERTEX_SHADER 0x8B31
+	#define GL_COMPILE_STATUS 0x8B81
+	#define GL_LINK_STATUS 0x8B82
+#endif
+
+// float and single channel textures (ARB_texture_float, ARB_texture_rg)
+#ifndef GL_RGBA32F
+	#define GL_RGBA32F 0x8814
+#endif
+#ifndef GL_R32F
+	#define GL_R32F 0x822E
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+	#define GL_DEPTH_COMPONENT24 0x81A6
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+	#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_FRAMEBUFFER_BINDING
+	#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+
+// framebuffer objects (GL 3.0, ARB/EXT_framebuffer_object)
+#ifndef GL_FRAMEBUFFER
+	#define GL_FRAMEBUFFER 0x8D40
+	#define GL_RENDERBUFFER 0x8D41
+	#define GL_COLOR_ATTACHMENT0 0x8CE0
+	#define GL_DEPTH_ATTACHMENT 0x8D00
+	#define GL_STENCIL_ATTACHMENT 0x8D20
+	#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_DEPTH24_STENCIL8
+	#define GL_DEPTH24_STENCIL8 0x88F0
+#endif
+
+// timer queries (GL 3.3, ARB_timer_query)
+#ifndef GL_TIME_ELAPSED
+	#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+	#define GL_QUERY_RESULT 0x8866
+	#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
+namespace Ubitrack { namespace Drivers {
+
+/** generic OpenGL entry point */
+typedef void (APIENTRY *GLProc)();
+
+/** returns the entry point of the given name, or 0 */
+typedef GLProc (*GLProcLoader)( const char* name );
+
+
+/**
+ * @ingroup driver_components
+ * Entry points of OpenGL extensions for one context.
+ * All pointers are 0 if the extension is not available.
+ */
+class GLExtensions
+{
+public:
+	GLExtensions();
+
+	/**
+	 * Loads all entry points. The context must be current on the calling thread.
+	 * @param loader the loader of the context, 0 for the window system's default
+	 */
+	void load( GLProcLoader loader = 0 );
+
+	/** window system default loader (glX, wgl or the Apple framework) */
+	static GLProc defaultLoader( const char* name );
+
+	/** true if framebuffer objects can be used */
+	bool hasFramebufferObject() const
+	{ return genFramebuffers != 0; }
+
+	/** true if buffer objects can be used */
+	bool hasBufferObject() const
+	{ return genBuffers != 0; }
+
+	/** true if buffer objects can be bound to the pixel pack and unpack targets */
+	bool hasPixelBufferObject() const
+	{ return m_bPixelBufferObject; }
+
+	/** true if GLSL shaders can be used */
+	bool hasShaders() const
+	{ return createShader != 0; }
+
+	/** true if meshes can be drawn several times in one call with per-instance vertex attributes */
+	bool hasInstancedArrays() const
+	{ return drawElementsInstanced != 0 && hasShaders() && hasBufferObject(); }
+
+	/** true if the GPU time of commands can be measured with GL_TIME_ELAPSED queries */
+	bool hasTimerQuery() const
+	{ return genQueries != 0; }
+
+	/** true if float textures can be rendered to */
+	bool hasTextureFloat() const
+	{ return m_bTextureFloat; }
+
+	/** true if single channel GL_R32F textures exist */
+	bool hasTextureRG() const
+	{ return m_bTextureRG; }
+
+	/** true if textures may have sizes that are not powers of two */
+	bool hasTextureNonPowerOfTwo() const
+	{ return m_bTextureNonPowerOfTwo; }
+
+	/** true if DXT1 and DXT5 compressed textures can be uploaded */
+	bool hasTextureCompressionS3TC() const
+	{ return m_bTextureCompressionS3TC; }
+
+	/** 
+	 * Compiles and links a GLSL program.
+	 * @param vertexSource source of the vertex shader, 0 for the fixed function vertex stage
+	 * @param fragmentSource source of the fragment shader, 0 for the fixed function fragment stage
+	 * @param log receives the compiler output if it fails
+	 * @return the program, 0 on failure
+	 */
+	GLuint compileProgram( const char* vertexSource, const char* fragmentSource, std::string& log ) const;
+
+	typedef void (APIENTRY *pglGenFramebuffers)( GLsizei n, GLuint* framebuffers );
+	typedef void (APIENTRY *pglDeleteFramebuffers)( GLsizei n, const GLuint* framebuffers );
+	typedef void (APIENTRY *pglBindFramebuffer)( GLenum target, GLuint framebuffer );
+	typedef GLenum (APIENTRY *pglCheckFramebufferStatus)( GLenum target );
+	typedef void (APIENTRY *pglFramebufferRenderbuffer)( GLenum target, GLenum attachment, GLenum renderbufferTarget, GLuint renderbuffer );
+	typedef void (APIENTRY *pglGenRenderbuffers)( GLsizei n, GLuint* renderbuffers );
+	typedef void (APIENTRY *pglDeleteRenderbuffers)( GLsizei n, const GLuint* renderbuffers );
+	typedef void (APIENTRY *pglBindRenderbuffer)( GLenum target, GLuint renderbuffer );
+	typedef void (APIENTRY *pglRenderbufferStorage)( GLenum target, GLenum internalFormat, GLsizei width, GLsizei height );
+	typedef void (APIENTRY *pglFramebufferTexture2D)( GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level );
+	typedef void (APIENTRY *pglGenerateMipmap)( GLenum target );
+
+	pglGenFramebuffers genFramebuffers;
+	pglDeleteFramebuffers deleteFramebuffers;
+	pglBindFramebuffer bindFramebuffer;
+	pglCheckFramebufferStatus checkFramebufferStatus;
+	pglFramebufferRenderbuffer framebufferRenderbuffer;
+	pglGenRenderbuffers genRenderbuffers;
+	pglDeleteRenderbuffers deleteRenderbuffers;
+	pglBindRenderbuffer bindRenderbuffer;
+	pglRenderbufferStorage renderbufferStorage;
+	pglFramebufferTexture2D framebufferTexture2D;
+
+	/** comes with framebuffer objects, but is loaded even if the rest of them is incomplete */
+	pglGenerateMipmap generateMipmap;
+
+	typedef void (APIENTRY *pglCompressedTexImage2D)( GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, 
+		GLint border, GLsizei size, const GLvoid* data );
+	typedef void (APIENTRY *pglCompressedTexSubImage2D)( GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, 
+		GLenum format, GLsizei size, const GLvoid* data );
+
+	pglCompressedTexImage2D compressedTexImage2D;
+	pglCompressedTexSubImage2D compressedTexSubImage2D;
+
+	typedef void (APIENTRY *pglGenBuffers)( GLsizei n, GLuint* buffers );
+	typedef void (APIENTRY *pglDeleteBuffers)( GLsizei n, const GLuint* buffers );
+	typedef void (APIENTRY *pglBindBuffer)( GLenum target, GLuint buffer );
+	typedef void (APIENTRY *pglBufferData)( GLenum target, ptrdiff_t size, const GLvoid* data, GLenum usage );
+	typedef void (APIENTRY *pglBufferSubData)( GLenum target, ptrdiff_t offset, ptrdiff_t size, const GLvoid* data );
+	typedef GLvoid* (APIENTRY *pglMapBuffer)( GLenum target, GLenum access );
+	typedef GLboolean (APIENTRY *pglUnmapBuffer)( GLenum target );
+
+	pglGenBuffers genBuffers;
+	pglDeleteBuffers deleteBuffers;
+	pglBindBuffer bindBuffer;
+	pglBufferData bufferData;
+	pglBufferSubData bufferSubData;
+	pglMapBuffer mapBuffer;
+	pglUnmapBuffer unmapBuffer;
+
+	typedef GLuint (APIENTRY *pglCreateShader)( GLenum type );
+	typedef void (APIENTRY *pglShaderSource)( GLuint shader, GLsizei count, const char** strings, const GLint* lengths );
+	typedef void (APIENTRY *pglCompileShader)( GLuint shader );
+	typedef void (APIENTRY *pglGetShaderiv)( GLuint shader, GLenum name, GLint* value );
+	typedef void (APIENTRY *pglGetShaderInfoLog)( GLuint shader, GLsizei size, GLsizei* length, char* log );
+	typedef void (APIENTRY *pglDeleteShader)( GLuint shader );
+	typedef GLuint (APIENTRY *pglCreateProgram)();
+	typedef void (APIENTRY *pglAttachShader)( GLuint program, GLuint shader );
+	typedef void (APIENTRY *pglLinkProgram)( GLuint program );
+	typedef void (APIENTRY *pglGetProgramiv)( GLuint program, GLenum name, GLint* value );
+	typedef void (APIENTRY *pglGetProgramInfoLog)( GLuint program, GLsizei size, GLsizei* length, char* log );
+	typedef void (APIENTRY *pglDeleteProgram)( GLuint program );
+	typedef void (APIENTRY *pglUseProgram)( GLuint program );
+	typedef GLint (APIENTRY *pglGetUniformLocation)( GLuint program, const char* name );
+	typedef GLint (APIENTRY *pglGetAttribLocation)( GLuint program, const char* name );
+	typedef void (APIENTRY *pglUniform1i)( GLint location, GLint v0 );
+	typedef void (APIENTRY *pglUniform1f)( GLint location, GLfloat v0 );
+	typedef void (APIENTRY *pglUniform4f)( GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3 );
+	typedef void (APIENTRY *pglUniformMatrix3fv)( GLint location, GLsizei count, GLboolean transpose, const GLfloat* value );
+	typedef void (APIENTRY *pglUniformMatrix4fv)( GLint location, GLsizei count, GLboolean transpose, const GLfloat* value );
+	typedef void (APIENTRY *pglVertexAttribPointer)( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer );
+	typedef void (APIENTRY *pglEnableVertexAttribArray)( GLuint index );
+	typedef void (APIENTRY *pglDisableVertexAttribArray)( GLuint index );
+
+	pglCreateShader createShader;
+	pglShaderSource shaderSource;
+	pglCompileShader compileShader;
+	pglGetShaderiv getShaderiv;
+	pglGetShaderInfoLog getShaderInfoLog;
+	pglDeleteShader deleteShader;
+	pglCreateProgram createProgram;
+	pglAttachShader attachShader;
+	pglLinkProgram linkProgram;
+	pglGetProgramiv getProgramiv;
+	pglGetProgramInfoLog getProgramInfoLog;
+	pglDeleteProgram deleteProgram;
+	pglUseProgram useProgram;
+	pglGetUniformLocation getUniformLocation;
+	pglGetAttribLocation getAttribLocation;
+	pglUniform1i uniform1i;
+	pglUniform1f uniform1f;
+	pglUniform4f uniform4f;
+	pglUniformMatrix3fv uniformMatrix3fv;
+	pglUniformMatrix4fv uniformMatrix4fv;
+	pglVertexAttribPointer vertexAttribPointer;
+	pglEnableVertexAttribArray enableVertexAttribArray;
+	pglDisableVertexAttribArray disableVertexAttribArray;
+
+	typedef void (APIENTRY *pglDrawElementsInstanced)( GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei instances );
+	typedef void (APIENTRY *pglVertexAttribDivisor)( GLuint index, GLuint divisor );
+
+	/** both 0 unless instanced arrays are available (GL 3.3, ARB_instanced_arrays) */
+	pglDrawElementsInstanced drawElementsInstanced;
+	pglVertexAttribDivisor vertexAttribDivisor;
+
+	typedef void (APIENTRY *pglGenQueries)( GLsizei n, GLuint* ids );
+	typedef void (APIENTRY *pglDeleteQueries)( GLsizei n, const GLuint* ids );
+	typedef void (APIENTRY *pglBeginQuery)( GLenum target, GLuint id );
+	typedef void (APIENTRY *pglEndQuery)( GLenum target );
+	typedef void (APIENTRY *pglGetQueryObjectiv)( GLuint id, GLenum name, GLint* value );
+	typedef void (APIENTRY *pglGetQueryObjectui64v)( GLuint id, GLenum name, unsigned long long* value );
+
+	pglGenQueries genQueries;
+	pglDeleteQueries deleteQueries;
+	pglBeginQuery beginQuery;
+	pglEndQuery endQuery;
+	pglGetQueryObjectiv getQueryObjectiv;
+	pglGetQueryObjectui64v getQueryObjectui64v;
+
+protected:
+
+	/** compiles a single shader, returns 0 and appends to the log on failure */
+	GLuint compileShaderSource( GLenum type, const char* source, std::string& log ) const;
+
+	bool m_bPixelBufferObject;
+	bool m_bTextureFloat;
+	bool m_bTextureRG;
+	bool m_bTextureNonPowerOfTwo;
+	bool m_bTextureCompressionS3TC;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Retained meshes in vertex buffer objects.
+ */
+
+#include "GLGeometry.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+GLGeometry::GLGeometry( GLenum mode, unsigned attributes, GLenum usage )
+	: m_mode( mode )
+	, m_attributes( attributes )
+	, m_usage( usage )
+	, m_stride( 3 )
+	, m_pVertices( 0 )
+	, m_pIndices( 0 )
+	, m_externalVertexCount( 0 )
+	, m_externalIndexCount( 0 )
+	, m_vertexBuffer( 0 )
+	, m_indexBuffer( 0 )
+	, m_bDirty( true )
+	, m_bResident( false )
+{
+	if ( attributes & normals )
+		m_stride += 3;
+	if ( attributes & colors )
+		m_stride += 4;
+	if ( attributes & texCoords )
+		m_stride += 2;
+
+	normal( 0, 0, 1 );
+	color( 1, 1, 1 );
+	texCoord( 0, 0 );
+}
+
+
+void GLGeometry::clear()
+{
+	m_vertices.clear();
+	m_indices.clear();
+	m_pVertices = 0;
+	m_pIndices = 0;
+	m_bDirty = true;
+}
+
+
+void GLGeometry::assign( const float* vertices, unsigned vertexCount, const GLuint* indices, unsigned indexCount )
+{
+	clear();
+	if ( !vertexCount )
+		return;
+
+	m_pVertices = vertices;
+	m_pIndices = indices;
+	m_externalVertexCount = vertexCount;
+	m_externalIndexCount = indexCount;
+}
+
+
+GLuint GLGeometry::vertex( float x, float y, float z )
+{
+	m_vertices.push_back( x );
+	m_vertices.push_back( y );
+	m_vertices.push_back( z );
+	if ( m_attributes & normals )
+		m_vertices.insert( m_vertices.end(), m_normal, m_normal + 3 );
+	if ( m_attributes & colors )
+		m_vertices.insert( m_vertices.end(), m_color, m_color + 4 );
+	if ( m_attributes & texCoords )
+		m_vertices.insert( m_vertices.end(), m_texCoord, m_texCoord + 2 );
+
+	m_bDirty = true;
+	return GLuint( m_vertices.size() / m_stride - 1 );
+}
+
+
+void GLGeometry::upload( const GLExtensions& ext )
+{
+	m_sequence.clear();
+	if ( !indexCount() )
+	{
+		m_sequence.resize( vertexCount() );
+		for ( unsigned i = 0; i < m_sequence.size(); i++ )
+			m_sequence[ i ] = i;
+	}
+
+	if ( ext.hasBufferObject() )
+	{
+		if ( !m_vertexBuffer )
+		{
+			ext.genBuffers( 1, &m_vertexBuffer );
+			ext.genBuffers( 1, &m_indexBuffer );
+		}
+
+		// respecifying the whole store lets the driver orphan a buffer that is still in use
+		ext.bindBuffer( GL_ARRAY_BUFFER, m_vertexBuffer );
+		ext.bufferData( GL_ARRAY_BUFFER, ptrdiff_t( vertexCount() * m_stride * sizeof( float ) ), vertexData(), m_usage );
+		ext.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer );
+		ext.bufferData( GL_ELEMENT_ARRAY_BUFFER, ptrdiff_t( size() * sizeof( GLuint ) ), drawIndices(), m_usage );
+	}
+
+	m_bDirty = false;
+}
+
+
+void GLGeometry::drawInstanced( const GLExtensions& ext, unsigned first, unsigned count, unsigned instances )
+{
+	m_bResident = true;
+	if ( empty() || count == 0 )
+		return;
+
+	if ( m_bDirty || ( ext.hasBufferObject() && !m_vertexBuffer ) )
+		upload( ext );
+
+	// offsets into the bound buffers, or pointers into client memory without buffer objects
+	const char* pVertices = 0;
+	const GLuint* pIndices = 0;
+	if ( m_vertexBuffer )
+	{
+		ext.bindBuffer( GL_ARRAY_BUFFER, m_vertexBuffer );
+		ext.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer );
+	}
+	else
+	{
+		pVertices = reinterpret_cast< const char* >( vertexData() );
+		pIndices = drawIndices();
+	}
+
+	// other renderers may leave arrays enabled, so every array is set explicitly
+	GLsizei stride = GLsizei( m_stride * sizeof( float ) );
+	const char* pAttribute = pVertices + 3 * sizeof( float );
+	glEnableClientState( GL_VERTEX_ARRAY );
+	glVertexPointer( 3, GL_FLOAT, stride, pVertices );
+
+	if ( m_attributes & normals )
+	{
+		glEnableClientState( GL_NORMAL_ARRAY );
+		glNormalPointer( GL_FLOAT, stride, pAttribute );
+		pAttribute += 3 * sizeof( float );
+	}
+	else
+		glDisableClientState( GL_NORMAL_ARRAY );
+
+	if ( m_attributes & colors )
+	{
+		glEnableClientState( GL_COLOR_ARRAY );
+		glColorPointer( 4, GL_FLOAT, stride, pAttribute );
+		pAttribute += 4 * sizeof( float );
+	}
+	else
+		glDisableClientState( GL_COLOR_ARRAY );
+
+	if ( m_attributes & texCoords )
+	{
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, stride, pAttribute );
+	}
+	else
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+
+	if ( instances )
+		ext.drawElementsInstanced( m_mode, GLsizei( count ), GL_UNSIGNED_INT, pIndices + first, GLsizei( instances ) );
+	else
+		glDrawElements( m_mode, GLsizei( count ), GL_UNSIGNED_INT, pIndices + first );
+
+	glDisableClientState( GL_VERTEX_ARRAY );
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_COLOR_ARRAY );
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+
+	if ( m_vertexBuffer )
+	{
+		ext.bindBuffer( GL_ARRAY_BUFFER, 0 );
+		ext.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+	}
+}
+
+
+void GLGeometry::release( const GLExtensions& ext )
+{
+	if ( m_vertexBuffer )
+	{
+		ext.deleteBuffers( 1, &m_vertexBuffer );
+		ext.deleteBuffers( 1, &m_indexBuffer );
+	}
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_bDirty = true;
+	m_bResident = false;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,190 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Retained meshes in vertex buffer objects.
+ */
+
+#ifndef __GLGeometry_h_INCLUDED__
+#define __GLGeometry_h_INCLUDED__
+
+#include <vector>
+
+#include "GLExtensions.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Indexed mesh with interleaved float vertices that is kept on the GPU.
+ *
+ * The mesh is built once like in immediate mode: the current normal, color and texture
+ * coordinate are copied into every vertex(). It is uploaded into a vertex and an index
+ * buffer on the first draw() after it has changed, so static geometry costs a single
+ * glDrawElements() per frame. Without buffer object support, the same arrays are drawn
+ * from client memory.
+ *
+ * Building may happen on any thread that owns the component, drawing and releasing
+ * only on the GL thread.
+ */
+class GLGeometry
+{
+public:
+
+	/** optional vertex attributes, interleaved after the position in this order */
+	enum Attributes { normals = 1, colors = 2, texCoords = 4 };
+
+	/**
+	 * @param mode primitive type passed to glDrawElements()
+	 * @param attributes combination of Attributes stored with each vertex
+	 * @param usage buffer usage hint, GL_DYNAMIC_DRAW for meshes that are rebuilt often
+	 */
+	GLGeometry( GLenum mode, unsigned attributes = 0, GLenum usage = GL_STATIC_DRAW );
+
+	/** removes all vertices and indices, the buffers are updated on the next draw() */
+	void clear();
+
+	/**
+	 * Uses external arrays instead of building the mesh, e.g. from a memory-mapped file.
+	 * The arrays are not copied and must stay valid until clear() or destruction.
+	 * The mesh cannot be extended with vertex() or index() before the next clear().
+	 * @param vertices interleaved vertices in the layout given by the attributes
+	 * @param indices indices, must not be 0 if vertices are given
+	 */
+	void assign( const float* vertices, unsigned vertexCount, const GLuint* indices, unsigned indexCount );
+
+	/** sets the normal of the following vertices */
+	void normal( float x, float y, float z )
+	{ m_normal[ 0 ] = x; m_normal[ 1 ] = y; m_normal[ 2 ] = z; }
+
+	/** sets the color of the following vertices */
+	void color( float r, float g, float b, float a = 1.0f )
+	{ m_color[ 0 ] = r; m_color[ 1 ] = g; m_color[ 2 ] = b; m_color[ 3 ] = a; }
+
+	/** sets the texture coordinate of the following vertices */
+	void texCoord( float s, float t )
+	{ m_texCoord[ 0 ] = s; m_texCoord[ 1 ] = t; }
+
+	/** appends a vertex with the current attributes and returns its index */
+	GLuint vertex( float x, float y, float z );
+
+	/** appends an index. If no indices are given, the vertices are drawn in order. */
+	void index( GLuint i )
+	{ m_indices.push_back( i ); m_bDirty = true; }
+
+	/** number of indices that draw() uses */
+	unsigned size() const
+	{ return indexCount() ? indexCount() : vertexCount(); }
+
+	bool empty() const
+	{ return vertexCount() == 0; }
+
+	unsigned vertexCount() const
+	{ return m_pVertices ? m_externalVertexCount : m_vertices.size() / m_stride; }
+
+	/** number of explicitly given indices */
+	unsigned indexCount() const
+	{ return m_pVertices ? m_externalIndexCount : m_indices.size(); }
+
+	/** floats per vertex */
+	unsigned stride() const
+	{ return m_stride; }
+
+	/** the interleaved vertices, 0 if empty */
+	const float* vertexData() const
+	{ return m_pVertices ? m_pVertices : ( m_vertices.empty() ? 0 : &m_vertices[ 0 ] ); }
+
+	/** the explicitly given indices, 0 if none */
+	const GLuint* indexData() const
+	{ return m_pVertices ? m_pIndices : ( m_indices.empty() ? 0 : &m_indices[ 0 ] ); }
+
+	/** draws the whole mesh, uploading it first if it has changed */
+	void draw( const GLExtensions& ext )
+	{ draw( ext, 0, size() ); }
+
+	/** draws count indices starting at first */
+	void draw( const GLExtensions& ext, unsigned first, unsigned count )
+	{ drawInstanced( ext, first, count, 0 ); }
+
+	/**
+	 * Draws count indices starting at first once for each instance, in a single call.
+	 * The caller sets up the per-instance attributes, which needs GLExtensions::hasInstancedArrays().
+	 * @param instances number of instances, 0 for a plain draw call
+	 */
+	void drawInstanced( const GLExtensions& ext, unsigned first, unsigned count, unsigned instances );
+
+	/** true once the mesh has been drawn, until release() */
+	bool isResident() const
+	{ return m_bResident; }
+
+	/** deletes the buffers, the mesh is kept and uploaded again by the next draw() */
+	void release( const GLExtensions& ext );
+
+protected:
+
+	/** copies the mesh into the buffers */
+	void upload( const GLExtensions& ext );
+
+	/** the indices that are drawn, valid after upload() */
+	const GLuint* drawIndices() const
+	{ return indexCount() ? indexData() : &m_sequence[ 0 ]; }
+
+	GLenum m_mode;
+	unsigned m_attributes;
+	GLenum m_usage;
+
+	/** floats per vertex */
+	unsigned m_stride;
+
+	std::vector< float > m_vertices;
+	std::vector< GLuint > m_indices;
+
+	/** external arrays given to assign(), used instead of the vectors if not 0 */
+	const float* m_pVertices;
+	const GLuint* m_pIndices;
+	unsigned m_externalVertexCount;
+	unsigned m_externalIndexCount;
+
+	/** sequence of all vertices, drawn if no indices are given */
+	std::vector< GLuint > m_sequence;
+
+	float m_normal[ 3 ];
+	float m_color[ 4 ];
+	float m_texCoord[ 2 ];
+
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+
+	/** the mesh has changed since the last upload */
+	bool m_bDirty;
+	bool m_bResident;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Shadow copy of the OpenGL state that components change while drawing.
+ */
+
+#include "GLStateCache.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+// capabilities whose enable bit is shadowed, in slot order after slotFirstCap
+static const GLenum g_trackedCaps[] = { GL_LIGHTING, GL_LIGHT0, GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_TEXTURE_2D, 
+	GL_LINE_SMOOTH, GL_LINE_STIPPLE, GL_POINT_SMOOTH, GL_STENCIL_TEST, GL_COLOR_MATERIAL, GL_NORMALIZE };
+static const int g_trackedCapCount = sizeof( g_trackedCaps ) / sizeof( g_trackedCaps[ 0 ] );
+
+
+GLStateCache::GLStateCache()
+	: m_entries( slotFirstCap + g_trackedCapCount )
+	, m_issuedCalls( 0 )
+	, m_avoidedCalls( 0 )
+	, m_queries( 0 )
+{
+	invalidate();
+}
+
+
+void GLStateCache::reset()
+{
+	invalidate();
+
+	// initial values of the OpenGL specification, all capabilities except GL_DITHER and GL_MULTISAMPLE are disabled
+	m_entries[ slotBlendFunc ].value = Value( GL_ONE, GL_ZERO );
+	m_entries[ slotLineWidth ].value = Value( 1.0 );
+	m_entries[ slotPointSize ].value = Value( 1.0 );
+	m_entries[ slotColorMask ].value = Value( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+	m_entries[ slotDepthMask ].value = Value( GL_TRUE );
+	m_entries[ slotTexture2D ].value = Value( 0 );
+	m_entries[ slotTexEnvMode ].value = Value( GL_MODULATE );
+	m_entries[ slotPixelZoom ].value = Value( 1.0, 1.0 );
+	for ( std::size_t i = 0; i < m_entries.size(); i++ )
+		m_entries[ i ].bKnown = true;
+}
+
+
+void GLStateCache::invalidate()
+{
+	for ( std::size_t i = 0; i < m_entries.size(); i++ )
+	{
+		m_entries[ i ].bKnown = false;
+		m_entries[ i ].value = Value();
+	}
+}
+
+
+int GLStateCache::capSlot( GLenum cap )
+{
+	for ( int i = 0; i < g_trackedCapCount; i++ )
+		if ( g_trackedCaps[ i ] == cap )
+			return slotFirstCap + i;
+	return -1;
+}
+
+
+void GLStateCache::setEnabled( GLenum cap, bool bEnabled )
+{
+	int slot = capSlot( cap );
+	if ( slot >= 0 )
+		set( slot, Value( bEnabled ? 1 : 0 ) );
+	else
+	{
+		m_issuedCalls++;
+		if ( bEnabled )
+			glEnable( cap );
+		else
+			glDisable( cap );
+	}
+}
+
+
+bool GLStateCache::isEnabled( GLenum cap )
+{
+	int slot = capSlot( cap );
+	if ( slot >= 0 )
+		return get( slot ).v[ 0 ] != 0;
+
+	m_queries++;
+	return glIsEnabled( cap ) == GL_TRUE;
+}
+
+
+void GLStateCache::blendFunc( GLenum src, GLenum dst )
+{ set( slotBlendFunc, Value( src, dst ) ); }
+
+
+void GLStateCache::lineWidth( GLfloat width )
+{ set( slotLineWidth, Value( width ) ); }
+
+
+GLfloat GLStateCache::lineWidth()
+{ return GLfloat( get( slotLineWidth ).v[ 0 ] ); }
+
+
+void GLStateCache::pointSize( GLfloat size )
+{ set( slotPointSize, Value( size ) ); }
+
+
+void GLStateCache::colorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha )
+{ set( slotColorMask, Value( red ? 1 : 0, green ? 1 : 0, blue ? 1 : 0, alpha ? 1 : 0 ) ); }
+
+
+void GLStateCache::depthMask( GLboolean flag )
+{ set( slotDepthMask, Value( flag ? 1 : 0 ) ); }
+
+
+void GLStateCache::bindTexture2D( GLuint texture )
+{ set( slotTexture2D, Value( texture ) ); }
+
+
+void GLStateCache::deleteTextures( GLsizei n, const GLuint* textures )
+{
+	m_issuedCalls++;
+	glDeleteTextures( n, textures );
+
+	Entry& binding = m_entries[ slotTexture2D ];
+	for ( GLsizei i = 0; i < n; i++ )
+		if ( binding.bKnown && binding.value.v[ 0 ] == textures[ i ] )
+			binding.value = Value( 0 );
+}
+
+
+void GLStateCache::texEnvMode( GLint mode )
+{ set( slotTexEnvMode, Value( mode ) ); }
+
+
+void GLStateCache::pixelZoom( GLfloat x, GLfloat y )
+{ set( slotPixelZoom, Value( x, y ) ); }
+
+
+void GLStateCache::push()
+{
+	m_marks.push_back( m_undo.size() );
+}
+
+
+void GLStateCache::pop()
+{
+	if ( m_marks.empty() )
+		return;
+
+	// undo the changes in reverse order, without recording them again
+	std::size_t mark = m_marks.back();
+	m_marks.pop_back();
+	while ( m_undo.size() > mark )
+	{
+		const std::pair< int, Value >& change = m_undo.back();
+		Entry& entry = m_entries[ change.first ];
+		if ( entry.bKnown && entry.value == change.second )
+			m_avoidedCalls++;
+		else
+		{
+			apply( change.first, change.second );
+			entry.bKnown = true;
+			entry.value = change.second;
+		}
+		m_undo.pop_back();
+	}
+}
+
+
+void GLStateCache::set( int slot, const Value& value )
+{
+	Entry& entry = m_entries[ slot ];
+	if ( entry.bKnown && entry.value == value )
+	{
+		m_avoidedCalls++;
+		return;
+	}
+
+	// an unknown value is only queried if it has to be restored later
+	if ( !m_marks.empty() )
+		m_undo.push_back( std::make_pair( slot, get( slot ) ) );
+
+	apply( slot, value );
+	entry.bKnown = true;
+	entry.value = value;
+}
+
+
+const GLStateCache::Value& GLStateCache::get( int slot )
+{
+	Entry& entry = m_entries[ slot ];
+	if ( !entry.bKnown )
+	{
+		entry.value = query( slot );
+		entry.bKnown = true;
+	}
+	return entry.value;
+}
+
+
+void GLStateCache::apply( int slot, const Value& value )
+{
+	m_issuedCalls++;
+	const double* v = value.v;
+	switch ( slot )
+	{
+	case slotBlendFunc:
+		glBlendFunc( GLenum( v[ 0 ] ), GLenum( v[ 1 ] ) );
+		break;
+	case slotLineWidth:
+		glLineWidth( GLfloat( v[ 0 ] ) );
+		break;
+	case slotPointSize:
+		glPointSize( GLfloat( v[ 0 ] ) );
+		break;
+	case slotColorMask:
+		glColorMask( v[ 0 ] != 0, v[ 1 ] != 0, v[ 2 ] != 0, v[ 3 ] != 0 );
+		break;
+	case slotDepthMask:
+		glDepthMask( v[ 0 ] != 0 );
+		break;
+	case slotTexture2D:
+		glBindTexture( GL_TEXTURE_2D, GLuint( v[ 0 ] ) );
+		break;
+	case slotTexEnvMode:
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GLint( v[ 0 ] ) );
+		break;
+	case slotPixelZoom:
+		glPixelZoom( GLfloat( v[ 0 ] ), GLfloat( v[ 1 ] ) );
+		break;
+	default:
+		if ( v[ 0 ] != 0 )
+			glEnable( g_trackedCaps[ slot - slotFirstCap ] );
+		else
+			glDisable( g_trackedCaps[ slot - slotFirstCap ] );
+		break;
+	}
+}
+
+
+GLStateCache::Value GLStateCache::query( int slot )
+{
+	m_queries++;
+	GLint i[ 2 ] = { 0, 0 };
+	GLfloat f[ 2 ] = { 0, 0 };
+	GLboolean b[ 4 ] = { GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE };
+	switch ( slot )
+	{
+	case slotBlendFunc:
+		glGetIntegerv( GL_BLEND_SRC, &i[ 0 ] );
+		glGetIntegerv( GL_BLEND_DST, &i[ 1 ] );
+		return Value( i[ 0 ], i[ 1 ] );
+	case slotLineWidth:
+		glGetFloatv( GL_LINE_WIDTH, &f[ 0 ] );
+		return Value( f[ 0 ] );
+	case slotPointSize:
+		glGetFloatv( GL_POINT_SIZE, &f[ 0 ] );
+		return Value( f[ 0 ] );
+	case slotColorMask:
+		glGetBooleanv( GL_COLOR_WRITEMASK, b );
+		return Value( b[ 0 ] ? 1 : 0, b[ 1 ] ? 1 : 0, b[ 2 ] ? 1 : 0, b[ 3 ] ? 1 : 0 );
+	case slotDepthMask:
+		glGetBooleanv( GL_DEPTH_WRITEMASK, b );
+		return Value( b[ 0 ] ? 1 : 0 );
+	case slotTexture2D:
+		glGetIntegerv( GL_TEXTURE_BINDING_2D, &i[ 0 ] );
+		return Value( i[ 0 ] );
+	case slotTexEnvMode:
+		glGetTexEnviv( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, &i[ 0 ] );
+		return Value( i[ 0 ] );
+	case slotPixelZoom:
+		glGetFloatv( GL_ZOOM_X, &f[ 0 ] );
+		glGetFloatv( GL_ZOOM_Y, &f[ 1 ] );
+		return Value( f[ 0 ], f[ 1 ] );
+	default:
+		return Value( glIsEnabled( g_trackedCaps[ slot - slotFirstCap ] ) ? 1 : 0 );
+	}
+}
+
+
+} } // namespace Ubitrack::Drivers
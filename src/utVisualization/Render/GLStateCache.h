@@ -0,0 +1,172 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Shadow copy of the OpenGL state that components change while drawing.
+ */
+
+#ifndef __GLStateCache_h_INCLUDED__
+#define __GLStateCache_h_INCLUDED__
+
+#include <vector>
+
+#include "GL/freeglut.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Keeps a copy of the GL state that is set by the components of a window.
+ *
+ * Setters only call GL if the value differs from the shadowed one. Components save and
+ * restore state with push() and pop() instead of glGet*() queries, which stall the pipeline
+ * on some drivers. This only works if all changes of the tracked state go through the cache,
+ * code that changes it directly must restore it itself, e.g. with glPushAttrib().
+ *
+ * Tracked are the enable bits of common capabilities, blend function, line width, point size,
+ * color and depth masks, the 2D texture binding, the texture environment mode and the pixel zoom.
+ * Other capabilities are passed on to GL unfiltered. All methods must be called on the GL thread.
+ */
+class GLStateCache
+{
+public:
+	GLStateCache();
+
+	/** assumes the initial state of a new context, called after the context has been created */
+	void reset();
+
+	/** forgets all shadowed values, unknown values are queried when they are needed */
+	void invalidate();
+
+	void enable( GLenum cap )
+	{ setEnabled( cap, true ); }
+
+	void disable( GLenum cap )
+	{ setEnabled( cap, false ); }
+
+	void setEnabled( GLenum cap, bool bEnabled );
+
+	bool isEnabled( GLenum cap );
+
+	void blendFunc( GLenum src, GLenum dst );
+
+	void lineWidth( GLfloat width );
+
+	GLfloat lineWidth();
+
+	void pointSize( GLfloat size );
+
+	void colorMask( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha );
+
+	void depthMask( GLboolean flag );
+
+	/** binds a texture to GL_TEXTURE_2D of the active texture unit */
+	void bindTexture2D( GLuint texture );
+
+	/** deletes textures, the binding falls back to 0 if the bound one is deleted */
+	void deleteTextures( GLsizei n, const GLuint* textures );
+
+	/** GL_TEXTURE_ENV_MODE of the texture environment */
+	void texEnvMode( GLint mode );
+
+	void pixelZoom( GLfloat x, GLfloat y );
+
+	/** starts recording changes, which are undone by the matching pop() */
+	void push();
+
+	/** restores the state of the matching push() */
+	void pop();
+
+	/** GL calls that were made, filtered out as redundant, and queries of unknown state since the last resetCounters() */
+	unsigned long issuedCalls() const
+	{ return m_issuedCalls; }
+
+	unsigned long avoidedCalls() const
+	{ return m_avoidedCalls; }
+
+	unsigned long queries() const
+	{ return m_queries; }
+
+	void resetCounters()
+	{ m_issuedCalls = m_avoidedCalls = m_queries = 0; }
+
+protected:
+
+	enum Slot { slotBlendFunc, slotLineWidth, slotPointSize, slotColorMask, slotDepthMask, slotTexture2D,
+		slotTexEnvMode, slotPixelZoom, slotFirstCap };
+
+	/** a state value, large enough for the color mask */
+	struct Value
+	{
+		Value()
+		{ v[ 0 ] = v[ 1 ] = v[ 2 ] = v[ 3 ] = 0; }
+
+		Value( double v0, double v1 = 0, double v2 = 0, double v3 = 0 )
+		{ v[ 0 ] = v0; v[ 1 ] = v1; v[ 2 ] = v2; v[ 3 ] = v3; }
+
+		bool operator==( const Value& other ) const
+		{ return v[ 0 ] == other.v[ 0 ] && v[ 1 ] == other.v[ 1 ] && v[ 2 ] == other.v[ 2 ] && v[ 3 ] == other.v[ 3 ]; }
+
+		double v[ 4 ];
+	};
+
+	struct Entry
+	{
+		bool bKnown;
+		Value value;
+	};
+
+	/** slot of a capability, -1 if it is not tracked */
+	static int capSlot( GLenum cap );
+
+	/** sets a value, filtering redundant calls and recording the old value between push() and pop() */
+	void set( int slot, const Value& value );
+
+	/** the shadowed value, queried from GL if unknown */
+	const Value& get( int slot );
+
+	/** makes the GL call for a slot */
+	void apply( int slot, const Value& value );
+
+	/** reads the GL state of a slot */
+	Value query( int slot );
+
+	std::vector< Entry > m_entries;
+
+	/** old values of the changes since the push() calls, and where each push() starts */
+	std::vector< std::pair< int, Value > > m_undo;
+	std::vector< std::size_t > m_marks;
+
+	unsigned long m_issuedCalls;
+	unsigned long m_avoidedCalls;
+	unsigned long m_queries;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Measures the GPU time of frames with timer queries.
+ */
+
+#include "GpuTimer.h"
+
+#include <algorithm>
+
+namespace Ubitrack { namespace Drivers {
+
+
+GpuTimer::GpuTimer( unsigned size )
+	: m_queries( size < 1 ? 1 : size, 0 )
+	, m_pending( m_queries.size(), false )
+	, m_next( 0 )
+	, m_bActive( false )
+{
+}
+
+
+void GpuTimer::begin( const GLExtensions& ext )
+{
+	if ( !ext.hasTimerQuery() || m_bActive )
+		return;
+
+	if ( !m_queries[ 0 ] )
+		ext.genQueries( GLsizei( m_queries.size() ), &m_queries[ 0 ] );
+
+	// an unread result is dropped by reusing its query
+	ext.beginQuery( GL_TIME_ELAPSED, m_queries[ m_next ] );
+	m_bActive = true;
+}
+
+
+void GpuTimer::end( const GLExtensions& ext )
+{
+	if ( !m_bActive )
+		return;
+
+	ext.endQuery( GL_TIME_ELAPSED );
+	m_bActive = false;
+	m_pending[ m_next ] = true;
+	m_next = ( m_next + 1 ) % m_queries.size();
+}
+
+
+bool GpuTimer::result( const GLExtensions& ext, Measurement::Timestamp& elapsed )
+{
+	if ( !m_pending[ m_next ] )
+		return false;
+
+	GLint available = 0;
+	ext.getQueryObjectiv( m_queries[ m_next ], GL_QUERY_RESULT_AVAILABLE, &available );
+	if ( !available )
+		return false;
+
+	unsigned long long value = 0;
+	ext.getQueryObjectui64v( m_queries[ m_next ], GL_QUERY_RESULT, &value );
+	m_pending[ m_next ] = false;
+	elapsed = value;
+	return true;
+}
+
+
+void GpuTimer::clear( const GLExtensions& ext )
+{
+	if ( m_queries[ 0 ] )
+		ext.deleteQueries( GLsizei( m_queries.size() ), &m_queries[ 0 ] );
+	std::fill( m_queries.begin(), m_queries.end(), 0 );
+	std::fill( m_pending.begin(), m_pending.end(), false );
+	m_next = 0;
+	m_bActive = false;
+}
+
+
+} } // namespace Ubitrack::Drivers
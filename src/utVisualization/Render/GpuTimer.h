@@ -0,0 +1,89 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Measures the GPU time of frames with timer queries.
+ */
+
+#ifndef __GpuTimer_h_INCLUDED__
+#define __GpuTimer_h_INCLUDED__
+
+#include <vector>
+
+#include <utMeasurement/Measurement.h>
+
+#include "GLExtensions.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Ring of GL_TIME_ELAPSED queries.
+ *
+ * The result of a query is only fetched when the ring has wrapped around, 
+ * so reading it never stalls the pipeline. Only one query can be active 
+ * in a context at a time. All methods must be called on the GL thread.
+ */
+class GpuTimer
+{
+public:
+
+	/** @param size number of queries in the ring */
+	GpuTimer( unsigned size );
+
+	/** starts timing the following commands, does nothing if timer queries are not supported */
+	void begin( const GLExtensions& ext );
+
+	/** stops timing, must follow begin() */
+	void end( const GLExtensions& ext );
+
+	/**
+	 * Fetches the GPU time of the oldest measurement if it is available.
+	 * @param elapsed receives the GPU time between begin() and end() in nanoseconds
+	 * @return false if no result is ready
+	 */
+	bool result( const GLExtensions& ext, Measurement::Timestamp& elapsed );
+
+	/** deletes all queries, pending results are lost */
+	void clear( const GLExtensions& ext );
+
+protected:
+
+	std::vector< GLuint > m_queries;
+	std::vector< bool > m_pending;
+
+	/** query that is used next, the oldest pending one */
+	unsigned m_next;
+
+	/** between begin() and end() */
+	bool m_bActive;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
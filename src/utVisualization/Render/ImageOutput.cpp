@@ -23,38 +23,102 @@
 
 #include "ImageOutput.h"
 
+#include <cstring>
+#include <utUtil/Exception.h>
+
 namespace Ubitrack { namespace Drivers {
 
+// number of readback buffers from the configuration, 1 for synchronous readback
+static unsigned readbackBuffers( boost::shared_ptr< Graph::UTQLSubgraph > subgraph )
+{
+	int n = 1;
+	subgraph->m_DataflowAttributes.getAttributeData( "readbackBuffers", n );
+	return n < 1 ? 1 : n;
+}
+
+
 ImageOutput::ImageOutput( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
 	, m_port( "Output", *this )
 	, m_width(0)
 	, m_height(0)
+	, m_format( GL_RGB )
+	, m_channels( 3 )
+	, m_readbackBuffers( readbackBuffers( subgraph ) )
+	, m_readback( m_readbackBuffers )
 {
+	std::string format = subgraph->m_DataflowAttributes.getAttributeString( "imageFormat" );
+	if ( format == "BGRA" )
+	{
+		m_format = GL_BGRA;
+		m_channels = 4;
+	}
+	else if ( format == "RGBA" )
+	{
+		m_format = GL_RGBA;
+		m_channels = 4;
+	}
+	else if ( !format.empty() && format != "RGB" )
+		UBITRACK_THROW( "Unsupported image format " + format );
 }
 
 /** render the object */
-void ImageOutput::draw( Measurement::Timestamp&, int parity )
+void ImageOutput::draw( Measurement::Timestamp& t, int parity )
 {
 	if (parity) return;
 
+	// asynchronous readback
+	if ( m_readbackBuffers > 1 && 
+		m_readback.read( m_pModule->glExtensions(), m_pModule->m_width, m_pModule->m_height, m_format, GL_UNSIGNED_BYTE, m_channels, t ) )
+	{
+		sendReadback();
+		return;
+	}
+
 	unsigned char* data;
 	if ((m_width != m_pModule->m_width) || (m_height != m_pModule->m_height))
 	{
 		m_width  = m_pModule->m_width;
 		m_height = m_pModule->m_height;
 		if ((m_image) && (m_image->imageData)) delete[] (unsigned char*)(m_image->imageData);
-		data = new unsigned char[m_width*m_height*3];
-		m_image = boost::shared_ptr< Vision::Image >( new Vision::Image( m_width, m_height, 3, data, IPL_DEPTH_8U ) );
+		data = new unsigned char[m_width*m_height*m_channels];
+		m_image = boost::shared_ptr< Vision::Image >( new Vision::Image( m_width, m_height, m_channels, data, IPL_DEPTH_8U ) );
 	}
 
 	data = (unsigned char*)m_image->imageData;
-	glReadPixels( 0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, data ); 
+	glReadPixels( 0, 0, m_width, m_height, m_format, GL_UNSIGNED_BYTE, data ); 
 	m_image->origin = 1;
 
-	m_port.send( Measurement::ImageMeasurement( Measurement::now(), m_image ) );
+	m_port.send( Measurement::ImageMeasurement( t, m_image ) );
 }
 
-} } // namespace Ubitrack::Drivers
 
+void ImageOutput::sendReadback()
+{
+	const GLExtensions& ext = m_pModule->glExtensions();
+	Measurement::Timestamp time;
+	const unsigned char* pData = static_cast< const unsigned char* >( m_readback.map( ext, time ) );
+	if ( !pData )
+		return;
+
+	// the buffer is reused, so every frame gets its own image
+	int width = m_readback.width();
+	int height = m_readback.height();
+	boost::shared_ptr< Vision::Image > pImage( new Vision::Image( width, height, m_channels, IPL_DEPTH_8U ) );
+	pImage->origin = 1;
+	for ( int y = 0; y < height; y++ )
+		memcpy( pImage->imageData + y * pImage->widthStep, pData + y * width * m_channels, width * m_channels );
+
+	m_readback.unmap( ext );
+
+	m_port.send( Measurement::ImageMeasurement( time, pImage ) );
+}
+
+
+void ImageOutput::glCleanup()
+{
+	m_readback.clear( m_pModule->glExtensions() );
+}
+
+} } // namespace Ubitrack::Drivers
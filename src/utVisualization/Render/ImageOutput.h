@@ -25,6 +25,7 @@
 #define _IMAGEOUTPUT_H_
 
 #include "RenderModule.h"
+#include "PixelReadback.h"
 #include <utVision/Image.h>
 
 namespace Ubitrack { namespace Drivers {
@@ -34,6 +35,10 @@ namespace Ubitrack { namespace Drivers {
  * @ingroup driver_components
  * Component for Image output.
  * Provides a push-out port for the color image.
+ *
+ * With readbackBuffers > 1, frames are transferred asynchronously through a
+ * ring of pixel buffer objects and sent readbackBuffers-1 frames later. Every
+ * image carries the timestamp of the frame it was rendered for.
  */
 class ImageOutput
 	: public VirtualObject
@@ -53,12 +58,25 @@ public:
 	/** render the object */
 	virtual void draw( Measurement::Timestamp&, int parity );
 
+	/** deletes the readback buffers */
+	virtual void glCleanup();
+
 protected:
 
+	/** sends the oldest frame of the readback ring, if any */
+	void sendReadback();
+
 	PushSupplier< Ubitrack::Measurement::ImageMeasurement > m_port;
 	boost::shared_ptr< Vision::Image > m_image;
 
 	int m_width, m_height;
+
+	/** pixel format of the output image */
+	GLenum m_format;
+	int m_channels;
+
+	unsigned m_readbackBuffers;
+	PixelReadback m_readback;
 };
 
 
@@ -0,0 +1,241 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Instanced drawing of X3D scenes that are shown by several tracked objects.
+ */
+
+#include "InstanceRenderer.h"
+
+#include <string.h>
+
+#include <utMath/Matrix.h>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.InstanceRenderer" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+// pose of the instance between the model-view matrix and the item, lighting as set up by VirtualCamera::initGL()
+static const char* g_instanceShader =
+	"#version 120\n"
+	"attribute mat4 instancePose;\n"
+	"uniform mat4 itemTransform;\n"
+	"uniform mat3 itemNormal;\n"
+	"uniform bool lighting;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 eye = gl_ModelViewMatrix * ( instancePose * ( itemTransform * gl_Vertex ) );\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"	gl_ClipVertex = eye;\n"
+	"	gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+	"	if ( !lighting )\n"
+	"	{\n"
+	"		gl_FrontColor = gl_Color;\n"
+	"		gl_BackColor = gl_Color;\n"
+	"		return;\n"
+	"	}\n"
+	"	vec3 normal = normalize( gl_NormalMatrix * ( mat3( instancePose ) * ( itemNormal * gl_Normal ) ) );\n"
+	"	vec3 light = normalize( gl_LightSource[0].position.xyz );\n"
+	"	vec3 color = gl_Color.rgb * ( gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + \n"
+	"		max( dot( normal, light ), 0.0 ) * gl_LightSource[0].diffuse.rgb );\n"
+	"	gl_FrontColor = vec4( color, gl_Color.a );\n"
+	"	gl_BackColor = gl_FrontColor;\n"
+	"}\n";
+
+
+InstanceRenderer::InstanceRenderer()
+	: m_groupCount( 0 )
+	, m_program( 0 )
+	, m_poseLocation( -1 )
+	, m_transformLocation( -1 )
+	, m_normalLocation( -1 )
+	, m_lightingLocation( -1 )
+	, m_buffer( 0 )
+	, m_drawCalls( 0 )
+	, m_instances( 0 )
+{
+}
+
+
+void InstanceRenderer::init( const GLExtensions& ext, bool bEnabled )
+{
+	clear( ext );
+	if ( !bEnabled )
+		return;
+
+	if ( !ext.hasInstancedArrays() )
+	{
+		LOG4CPP_INFO( logger, "Instanced arrays are not supported, tracked objects are drawn one by one" );
+		return;
+	}
+
+	std::string log;
+	m_program = ext.compileProgram( g_instanceShader, 0, log );
+	if ( !m_program )
+	{
+		LOG4CPP_ERROR( logger, "Could not compile the instancing shader: " << log );
+		return;
+	}
+
+	m_poseLocation = ext.getAttribLocation( m_program, "instancePose" );
+	m_transformLocation = ext.getUniformLocation( m_program, "itemTransform" );
+	m_normalLocation = ext.getUniformLocation( m_program, "itemNormal" );
+	m_lightingLocation = ext.getUniformLocation( m_program, "lighting" );
+	if ( m_poseLocation < 0 )
+	{
+		LOG4CPP_ERROR( logger, "The instancing shader has no pose attribute" );
+		ext.deleteProgram( m_program );
+		m_program = 0;
+	}
+}
+
+
+void InstanceRenderer::add( const double* view, const X3DScene& scene, X3DScene::Resources& resources, bool bOcclusionOnly, 
+	const Math::Pose& pose, unsigned level )
+{
+	// the matrix is constant during a batch
+	if ( m_groupCount == 0 )
+		memcpy( m_modelView, view, sizeof( m_modelView ) );
+
+	unsigned i = 0;
+	while ( i < m_groupCount && ( m_groups[ i ].pScene != &scene || m_groups[ i ].bOcclusionOnly != bOcclusionOnly || 
+		m_groups[ i ].level != level ) )
+		i++;
+
+	if ( i == m_groupCount )
+	{
+		if ( m_groups.size() == m_groupCount )
+			m_groups.push_back( Group() );
+		Group& group( m_groups[ m_groupCount++ ] );
+		group.pScene = &scene;
+		group.pResources = &resources;
+		group.bOcclusionOnly = bOcclusionOnly;
+		group.level = level;
+		group.poses.clear();
+	}
+
+	Math::Matrix< double, 4, 4 > m( pose.rotation(), pose.translation() );
+	const double* pMatrix = m.content();
+	std::vector< float >& poses( m_groups[ i ].poses );
+	for ( unsigned j = 0; j < 16; j++ )
+		poses.push_back( float( pMatrix[ j ] ) );
+}
+
+
+void InstanceRenderer::flush( GLStateCache& state, const GLExtensions& ext, TextureManager& textures )
+{
+	if ( m_groupCount == 0 )
+		return;
+
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glLoadMatrixd( m_modelView );
+
+	for ( unsigned i = 0; i < m_groupCount; i++ )
+	{
+		Group& group( m_groups[ i ] );
+		unsigned instances = group.poses.size() / 16;
+
+		state.push();
+		if ( group.bOcclusionOnly )
+			state.colorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+
+		if ( instances == 1 )
+		{
+			glPushMatrix();
+			glMultMatrixf( &group.poses[ 0 ] );
+			group.pScene->draw( state, ext, textures, *group.pResources, group.level );
+			glPopMatrix();
+		}
+		else
+		{
+			// a fresh store each frame, so the driver does not wait for the previous draw calls
+			if ( !m_buffer )
+				ext.genBuffers( 1, &m_buffer );
+			ext.bindBuffer( GL_ARRAY_BUFFER, m_buffer );
+			ext.bufferData( GL_ARRAY_BUFFER, ptrdiff_t( group.poses.size() * sizeof( float ) ), &group.poses[ 0 ], GL_STREAM_DRAW );
+
+			// a mat4 attribute takes four locations, one per column
+			for ( GLuint c = 0; c < 4; c++ )
+			{
+				GLuint location = GLuint( m_poseLocation ) + c;
+				ext.enableVertexAttribArray( location );
+				ext.vertexAttribPointer( location, 4, GL_FLOAT, GL_FALSE, 16 * sizeof( float ), 
+					reinterpret_cast< const GLvoid* >( c * 4 * sizeof( float ) ) );
+				ext.vertexAttribDivisor( location, 1 );
+			}
+			ext.bindBuffer( GL_ARRAY_BUFFER, 0 );
+
+			ext.useProgram( m_program );
+			ext.uniform1i( m_lightingLocation, state.isEnabled( GL_LIGHTING ) ? 1 : 0 );
+			group.pScene->drawInstanced( state, ext, textures, *group.pResources, instances, m_transformLocation, m_normalLocation, 
+				group.level );
+			ext.useProgram( 0 );
+
+			for ( GLuint c = 0; c < 4; c++ )
+			{
+				GLuint location = GLuint( m_poseLocation ) + c;
+				ext.vertexAttribDivisor( location, 0 );
+				ext.disableVertexAttribArray( location );
+			}
+
+			m_drawCalls += group.pScene->size();
+			m_instances += instances;
+		}
+
+		state.pop();
+		group.poses.clear();
+	}
+
+	glPopMatrix();
+	m_groupCount = 0;
+}
+
+
+void InstanceRenderer::counters( unsigned long& drawCalls, unsigned long& instances )
+{
+	drawCalls = m_drawCalls;
+	instances = m_instances;
+	m_drawCalls = 0;
+	m_instances = 0;
+}
+
+
+void InstanceRenderer::clear( const GLExtensions& ext )
+{
+	m_groupCount = 0;
+	if ( m_program )
+		ext.deleteProgram( m_program );
+	m_program = 0;
+	if ( m_buffer )
+		ext.deleteBuffers( 1, &m_buffer );
+	m_buffer = 0;
+}
+
+
+} } // namespace Ubitrack::Drivers
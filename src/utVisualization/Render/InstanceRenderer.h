@@ -0,0 +1,128 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Instanced drawing of X3D scenes that are shown by several tracked objects.
+ */
+
+#ifndef __InstanceRenderer_h_INCLUDED__
+#define __InstanceRenderer_h_INCLUDED__
+
+#include <vector>
+
+#include <utMath/Pose.h>
+
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "TextureManager.h"
+#include "X3DScene.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Collects the poses of tracked objects that show the same scene and draws each scene once for all of them.
+ *
+ * Instead of drawing, an X3DObject adds its pose, and the window calls flush() before it draws the next 
+ * component that does not queue its instances and at the end of each pass. All instances of a scene with the 
+ * same occlusion mode and detail level form a group. Groups of several instances are drawn with one instanced draw call per item: 
+ * the poses are streamed into a buffer each frame and applied by a vertex shader, which also does the lighting 
+ * of the fixed function pipeline as set up by the module (color material, directional light 0). 
+ * Groups with a single instance are drawn as before.
+ *
+ * One instance exists per VirtualCamera, all methods must be called on its render thread.
+ */
+class InstanceRenderer
+{
+public:
+	InstanceRenderer();
+
+	/**
+	 * creates the program, called once the context is current
+	 * @param bEnabled false to draw every object on its own
+	 */
+	void init( const GLExtensions& ext, bool bEnabled );
+
+	/** true if add() may be used */
+	bool isEnabled() const
+	{ return m_program != 0; }
+
+	/**
+	 * queues an instance of a scene
+	 * @param view model-view matrix without the pose, as recorded by the window. It must not change until the next flush().
+	 * @param bOcclusionOnly only draw into the depth buffer
+	 * @param level detail level of the scene, instances at different levels form different groups
+	 */
+	void add( const double* view, const X3DScene& scene, X3DScene::Resources& resources, bool bOcclusionOnly, 
+		const Math::Pose& pose, unsigned level = 0 );
+
+	/** draws the queued instances in the order in which their groups were started */
+	void flush( GLStateCache& state, const GLExtensions& ext, TextureManager& textures );
+
+	/** number of instanced draw calls and of instances drawn by them since the last call, for the statistics */
+	void counters( unsigned long& drawCalls, unsigned long& instances );
+
+	/** deletes the program and the buffer */
+	void clear( const GLExtensions& ext );
+
+protected:
+
+	struct Group
+	{
+		const X3DScene* pScene;
+		X3DScene::Resources* pResources;
+		bool bOcclusionOnly;
+		unsigned level;
+
+		/** column-major pose matrices */
+		std::vector< float > poses;
+	};
+
+	/** groups of the current batch, the first m_groupCount are used. Kept to avoid allocations. */
+	std::vector< Group > m_groups;
+	unsigned m_groupCount;
+
+	/** model-view matrix of the batch, read when its first instance is added */
+	double m_modelView[ 16 ];
+
+	GLuint m_program;
+	GLint m_poseLocation;
+	GLint m_transformLocation;
+	GLint m_normalLocation;
+	GLint m_lightingLocation;
+
+	/** stream buffer of the poses */
+	GLuint m_buffer;
+
+	unsigned long m_drawCalls;
+	unsigned long m_instances;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
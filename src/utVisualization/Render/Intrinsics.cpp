@@ -54,11 +54,8 @@ void Intrinsics::draw( Measurement::Timestamp& time, int parity )
 	double f = m_pModule->m_far;
 
 	// create a perspective projection matrix
-	glMatrixMode( GL_PROJECTION );
-	glLoadIdentity();
 	Math::Matrix< double, 4, 4 > m = Ubitrack::Calibration::projectionMatrixToOpenGL( l, r, b, t, n, f, m_intrinsics );
-	glMultMatrixd( m.content() );
-	glMatrixMode( GL_MODELVIEW );
+	m_pModule->loadProjection( m.content() );
 }
 
 
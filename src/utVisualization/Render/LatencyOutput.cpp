@@ -0,0 +1,90 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+#include "LatencyOutput.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace Ubitrack { namespace Drivers {
+
+LatencyOutput::LatencyOutput( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
+	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
+	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_port( "Output", *this )
+	, m_statisticsPort( "Statistics", *this )
+	, m_intervalStart( 0 )
+{
+	double interval = 1.0;
+	subgraph->m_DataflowAttributes.getAttributeData( "statisticsInterval", interval );
+	m_interval = Measurement::Timestamp( 1e9 * std::max( interval, 0.01 ) );
+}
+
+void LatencyOutput::frameDone( const FrameTiming& timing )
+{
+	if ( timing.measurementTimes.empty() )
+		return;
+
+	Measurement::Timestamp oldest = timing.measurementTimes.front();
+	for ( std::vector< Measurement::Timestamp >::const_iterator it = timing.measurementTimes.begin(); it != timing.measurementTimes.end(); it++ )
+		if ( *it < oldest )
+			oldest = *it;
+
+	double age = 1e-6 * ( double( timing.swapEnd ) - double( oldest ) );
+	m_port.send( Measurement::Distance( timing.swapEnd, Math::Scalar< double >( age ) ) );
+
+	if ( !m_statisticsPort.isConnected() )
+		return;
+
+	if ( !m_intervalStart )
+		m_intervalStart = timing.swapEnd;
+	m_ages.push_back( age );
+	if ( timing.swapEnd >= m_intervalStart + m_interval )
+		sendStatistics( timing.swapEnd );
+}
+
+
+void LatencyOutput::sendStatistics( Measurement::Timestamp t )
+{
+	std::sort( m_ages.begin(), m_ages.end() );
+	double sum = 0.0;
+	for ( std::vector< double >::const_iterator it = m_ages.begin(); it != m_ages.end(); it++ )
+		sum += *it;
+
+	// nearest-rank percentiles
+	const double quantiles[ 3 ] = { 0.5, 0.9, 0.99 };
+	boost::shared_ptr< std::vector< Math::Scalar< double > > > pValues( new std::vector< Math::Scalar< double > > );
+	pValues->push_back( Math::Scalar< double >( sum / m_ages.size() ) );
+	for ( unsigned i = 0; i < 3; i++ )
+	{
+		std::size_t rank = std::size_t( ceil( quantiles[ i ] * m_ages.size() - 1e-9 ) );
+		pValues->push_back( Math::Scalar< double >( m_ages[ std::max( rank, std::size_t( 1 ) ) - 1 ] ) );
+	}
+	pValues->push_back( Math::Scalar< double >( m_ages.back() ) );
+	m_statisticsPort.send( Measurement::DistanceList( t, pValues ) );
+
+	m_ages.clear();
+	m_intervalStart = t;
+}
+
+} } // namespace Ubitrack::Drivers
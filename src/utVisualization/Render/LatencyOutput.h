@@ -0,0 +1,87 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+#ifndef _LATENCYOUTPUT_H_
+#define _LATENCYOUTPUT_H_
+
+#include <vector>
+
+#include "RenderModule.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Component for latency output.
+ * Provides a push-out port that sends, for every frame that shows measurements, 
+ * the age of the oldest shown measurement when the buffer swap returned, in milliseconds.
+ * The timestamp is the time of the buffer swap.
+ *
+ * A second push-out port sends the distribution of these ages once per interval: 
+ * mean, median, 90th and 99th percentile and maximum, in milliseconds.
+ */
+class LatencyOutput
+	: public VirtualObject
+{
+public:
+
+	/**
+	 * Constructor
+	 * @param name edge name
+	 * @param config component configuration
+	 * @param componentKey the unique identifier for this component
+	 * @param pModule parent object
+	 */
+	LatencyOutput( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
+		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
+
+	virtual void frameDone( const FrameTiming& timing );
+
+	/** draws nothing, skipped frames have no latency to report */
+	virtual unsigned long generation()
+	{ return 0; }
+
+protected:
+
+	/** sends the statistics of the collected ages and starts a new interval */
+	void sendStatistics( Measurement::Timestamp t );
+
+	PushSupplier< Measurement::Distance > m_port;
+	PushSupplier< Measurement::DistanceList > m_statisticsPort;
+
+	/** length of a statistics interval in nanoseconds */
+	Measurement::Timestamp m_interval;
+
+	/** start of the current interval, 0 before the first frame */
+	Measurement::Timestamp m_intervalStart;
+
+	/** ages in milliseconds of the frames of the current interval */
+	std::vector< double > m_ages;
+
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif // _LATENCYOUTPUT_H_
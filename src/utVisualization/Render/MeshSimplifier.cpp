@@ -0,0 +1,386 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Simplification of triangle meshes by quadric edge collapse.
+ */
+
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace Ubitrack { namespace Drivers {
+
+namespace {
+
+/** cross product of b - a and c - a */
+void triangleNormal( const float* a, const float* b, const float* c, float* n )
+{
+	float u[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+	float v[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+	n[ 0 ] = u[ 1 ] * v[ 2 ] - u[ 2 ] * v[ 1 ];
+	n[ 1 ] = u[ 2 ] * v[ 0 ] - u[ 0 ] * v[ 2 ];
+	n[ 2 ] = u[ 0 ] * v[ 1 ] - u[ 1 ] * v[ 0 ];
+}
+
+} // anonymous namespace
+
+
+MeshSimplifier::MeshSimplifier( const float* vertices, unsigned stride, const GLuint* indices, unsigned indexCount )
+	: m_scale( 1.0 )
+	, m_mark( 0 )
+	, m_maxError( 0.0f )
+{
+	// compact the used vertices, which are usually a block of a larger mesh
+	GLuint minIndex = indexCount ? indices[ 0 ] : 0;
+	GLuint maxIndex = minIndex;
+	for ( unsigned i = 0; i < indexCount; i++ )
+	{
+		minIndex = std::min( minIndex, indices[ i ] );
+		maxIndex = std::max( maxIndex, indices[ i ] );
+	}
+	std::vector< unsigned > local( indexCount ? maxIndex - minIndex + 1 : 0, ~0U );
+
+	m_triangles.reserve( indexCount - indexCount % 3 );
+	for ( unsigned i = 0; i + 2 < indexCount; i += 3 )
+	{
+		if ( indices[ i ] == indices[ i + 1 ] || indices[ i + 1 ] == indices[ i + 2 ] || indices[ i ] == indices[ i + 2 ] )
+			continue;
+
+		for ( unsigned j = 0; j < 3; j++ )
+		{
+			GLuint index = indices[ i + j ];
+			unsigned& slot( local[ index - minIndex ] );
+			if ( slot == ~0U )
+			{
+				slot = m_original.size();
+				m_original.push_back( index );
+			}
+			m_triangles.push_back( slot );
+		}
+	}
+
+	// positions in the unit cube keep the float quadrics accurate
+	unsigned vertexCount = m_original.size();
+	float lower[ 3 ] = { 0, 0, 0 };
+	float upper[ 3 ] = { 0, 0, 0 };
+	for ( unsigned v = 0; v < vertexCount; v++ )
+		for ( unsigned k = 0; k < 3; k++ )
+		{
+			float x = vertices[ std::size_t( m_original[ v ] ) * stride + k ];
+			lower[ k ] = v ? std::min( lower[ k ], x ) : x;
+			upper[ k ] = v ? std::max( upper[ k ], x ) : x;
+		}
+	float extent = std::max( upper[ 0 ] - lower[ 0 ], std::max( upper[ 1 ] - lower[ 1 ], upper[ 2 ] - lower[ 2 ] ) );
+	if ( extent > 0.0f )
+		m_scale = extent;
+
+	m_positions.resize( 3 * vertexCount );
+	for ( unsigned v = 0; v < vertexCount; v++ )
+		for ( unsigned k = 0; k < 3; k++ )
+			m_positions[ 3 * v + k ] = float( ( vertices[ std::size_t( m_original[ v ] ) * stride + k ] - lower[ k ] ) / m_scale );
+
+	// each vertex starts with the planes of its triangles
+	Quadric zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	m_quadrics.assign( vertexCount, zero );
+	for ( unsigned i = 0; i < m_triangles.size(); i += 3 )
+	{
+		const float* p = &m_positions[ 3 * m_triangles[ i ] ];
+		float n[ 3 ];
+		triangleNormal( p, &m_positions[ 3 * m_triangles[ i + 1 ] ], &m_positions[ 3 * m_triangles[ i + 2 ] ], n );
+		float length = sqrtf( n[ 0 ] * n[ 0 ] + n[ 1 ] * n[ 1 ] + n[ 2 ] * n[ 2 ] );
+		if ( length == 0.0f )
+			continue;
+
+		float a = n[ 0 ] / length, b = n[ 1 ] / length, c = n[ 2 ] / length;
+		float d = -( a * p[ 0 ] + b * p[ 1 ] + c * p[ 2 ] );
+		for ( unsigned j = 0; j < 3; j++ )
+		{
+			Quadric& q( m_quadrics[ m_triangles[ i + j ] ] );
+			q.a2 += a * a; q.ab += a * b; q.ac += a * c; q.ad += a * d;
+			q.b2 += b * b; q.bc += b * c; q.bd += b * d;
+			q.c2 += c * c; q.cd += c * d;
+			q.d2 += d * d;
+			q.planes += 1.0f;
+		}
+	}
+
+	m_marks.assign( vertexCount, 0 );
+}
+
+
+const std::vector< GLuint >& MeshSimplifier::simplify( unsigned targetTriangles )
+{
+	while ( triangles() > targetTriangles && pass( targetTriangles ) > 0 )
+		;
+
+	m_result.resize( m_triangles.size() );
+	for ( unsigned i = 0; i < m_triangles.size(); i++ )
+		m_result[ i ] = m_original[ m_triangles[ i ] ];
+	return m_result;
+}
+
+
+double MeshSimplifier::error() const
+{
+	return sqrt( double( m_maxError ) ) * m_scale;
+}
+
+
+float MeshSimplifier::evaluate( const Quadric& q, const float* p ) const
+{
+	float x = p[ 0 ], y = p[ 1 ], z = p[ 2 ];
+	float e = q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x
+		+ q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y
+		+ q.c2 * z * z + 2 * q.cd * z
+		+ q.d2;
+	return e > 0.0f ? e : 0.0f;
+}
+
+
+void MeshSimplifier::buildAdjacency()
+{
+	unsigned vertexCount = m_original.size();
+	m_offsets.assign( vertexCount + 1, 0 );
+	for ( unsigned i = 0; i < m_triangles.size(); i++ )
+		m_offsets[ m_triangles[ i ] + 1 ]++;
+	for ( unsigned v = 0; v < vertexCount; v++ )
+		m_offsets[ v + 1 ] += m_offsets[ v ];
+
+	m_adjacency.resize( m_triangles.size() );
+	std::vector< unsigned > fill( m_offsets.begin(), m_offsets.end() - 1 );
+	for ( unsigned i = 0; i < m_triangles.size(); i++ )
+		m_adjacency[ fill[ m_triangles[ i ] ]++ ] = i / 3;
+
+	// an edge is on a border or non-manifold unless exactly two triangles share it
+	m_border.assign( vertexCount, 0 );
+	std::vector< std::pair< unsigned, unsigned > > neighbours;
+	for ( unsigned v = 0; v < vertexCount; v++ )
+	{
+		neighbours.clear();
+		for ( unsigned t = m_offsets[ v ]; t < m_offsets[ v + 1 ]; t++ )
+			for ( unsigned j = 0; j < 3; j++ )
+			{
+				unsigned w = m_triangles[ 3 * m_adjacency[ t ] + j ];
+				if ( w == v )
+					continue;
+
+				unsigned k = 0;
+				while ( k < neighbours.size() && neighbours[ k ].first != w )
+					k++;
+				if ( k == neighbours.size() )
+					neighbours.push_back( std::make_pair( w, 0U ) );
+				neighbours[ k ].second++;
+			}
+
+		for ( unsigned k = 0; k < neighbours.size() && !m_border[ v ]; k++ )
+			if ( neighbours[ k ].second != 2 )
+				m_border[ v ] = 1;
+	}
+}
+
+
+bool MeshSimplifier::isValid( unsigned from, unsigned to )
+{
+	// the two vertices may only share the neighbours opposite to their edge, otherwise two sheets are joined
+	m_mark += 2;
+	for ( unsigned t = m_offsets[ to ]; t < m_offsets[ to + 1 ]; t++ )
+		for ( unsigned j = 0; j < 3; j++ )
+			m_marks[ m_triangles[ 3 * m_adjacency[ t ] + j ] ] = m_mark;
+
+	unsigned shared = 0;
+	for ( unsigned t = m_offsets[ from ]; t < m_offsets[ from + 1 ]; t++ )
+		for ( unsigned j = 0; j < 3; j++ )
+		{
+			unsigned w = m_triangles[ 3 * m_adjacency[ t ] + j ];
+			if ( w != from && w != to && m_marks[ w ] == m_mark )
+			{
+				m_marks[ w ] = m_mark + 1;
+				shared++;
+			}
+		}
+	if ( shared != 2 )
+		return false;
+
+	// the surface normal at from, the area-weighted sum of its triangle normals, smooths out scanner noise
+	float surface[ 3 ] = { 0, 0, 0 };
+	for ( unsigned t = m_offsets[ from ]; t < m_offsets[ from + 1 ]; t++ )
+	{
+		const GLuint* triangle = &m_triangles[ 3 * m_adjacency[ t ] ];
+		float n[ 3 ];
+		triangleNormal( &m_positions[ 3 * triangle[ 0 ] ], &m_positions[ 3 * triangle[ 1 ] ], &m_positions[ 3 * triangle[ 2 ] ], n );
+		for ( unsigned k = 0; k < 3; k++ )
+			surface[ k ] += n[ k ];
+	}
+
+	// the remaining triangles of from must keep their orientation, both their own and that of the surface
+	const float* target = &m_positions[ 3 * to ];
+	for ( unsigned t = m_offsets[ from ]; t < m_offsets[ from + 1 ]; t++ )
+	{
+		const GLuint* triangle = &m_triangles[ 3 * m_adjacency[ t ] ];
+		if ( triangle[ 0 ] == to || triangle[ 1 ] == to || triangle[ 2 ] == to )
+			continue;
+
+		const float* p[ 3 ];
+		const float* q[ 3 ];
+		for ( unsigned j = 0; j < 3; j++ )
+		{
+			p[ j ] = &m_positions[ 3 * triangle[ j ] ];
+			q[ j ] = triangle[ j ] == from ? target : p[ j ];
+		}
+
+		float before[ 3 ], after[ 3 ];
+		triangleNormal( p[ 0 ], p[ 1 ], p[ 2 ], before );
+		triangleNormal( q[ 0 ], q[ 1 ], q[ 2 ], after );
+		float dot = before[ 0 ] * after[ 0 ] + before[ 1 ] * after[ 1 ] + before[ 2 ] * after[ 2 ];
+		float lengths = sqrtf( ( before[ 0 ] * before[ 0 ] + before[ 1 ] * before[ 1 ] + before[ 2 ] * before[ 2 ] ) *
+			( after[ 0 ] * after[ 0 ] + after[ 1 ] * after[ 1 ] + after[ 2 ] * after[ 2 ] ) );
+		if ( dot <= 0.25f * lengths || surface[ 0 ] * after[ 0 ] + surface[ 1 ] * after[ 1 ] + surface[ 2 ] * after[ 2 ] <= 0.0f )
+			return false;
+	}
+
+	return true;
+}
+
+
+unsigned MeshSimplifier::pass( unsigned targetTriangles )
+{
+	buildAdjacency();
+
+	// the cheaper direction of every manifold edge, each edge is seen from its smaller vertex
+	std::vector< Collapse > collapses;
+	std::vector< std::pair< unsigned, unsigned > > neighbours;
+	unsigned vertexCount = m_original.size();
+	for ( unsigned v = 0; v < vertexCount; v++ )
+	{
+		neighbours.clear();
+		for ( unsigned t = m_offsets[ v ]; t < m_offsets[ v + 1 ]; t++ )
+			for ( unsigned j = 0; j < 3; j++ )
+			{
+				unsigned w = m_triangles[ 3 * m_adjacency[ t ] + j ];
+				if ( w <= v )
+					continue;
+
+				unsigned k = 0;
+				while ( k < neighbours.size() && neighbours[ k ].first != w )
+					k++;
+				if ( k == neighbours.size() )
+					neighbours.push_back( std::make_pair( w, 0U ) );
+				neighbours[ k ].second++;
+			}
+
+		for ( unsigned k = 0; k < neighbours.size(); k++ )
+		{
+			unsigned w = neighbours[ k ].first;
+			if ( neighbours[ k ].second != 2 || ( m_border[ v ] && m_border[ w ] ) )
+				continue;
+
+			Quadric q( m_quadrics[ v ] );
+			q.add( m_quadrics[ w ] );
+
+			Collapse collapse;
+			if ( m_border[ v ] )
+			{
+				collapse.from = w;
+				collapse.to = v;
+			}
+			else if ( m_border[ w ] )
+			{
+				collapse.from = v;
+				collapse.to = w;
+			}
+			else
+			{
+				bool bToW = evaluate( q, &m_positions[ 3 * w ] ) <= evaluate( q, &m_positions[ 3 * v ] );
+				collapse.from = bToW ? v : w;
+				collapse.to = bToW ? w : v;
+			}
+			collapse.error = evaluate( q, &m_positions[ 3 * collapse.to ] );
+			collapses.push_back( collapse );
+		}
+	}
+	std::sort( collapses.begin(), collapses.end() );
+
+	// cheapest first, each neighbourhood changes at most once per pass
+	std::vector< unsigned > remap( vertexCount );
+	for ( unsigned v = 0; v < vertexCount; v++ )
+		remap[ v ] = v;
+	m_locked.assign( vertexCount, 0 );
+
+	unsigned triangles = this->triangles();
+	unsigned count = 0;
+	for ( std::vector< Collapse >::const_iterator it = collapses.begin(); it != collapses.end() && triangles > targetTriangles; it++ )
+	{
+		unsigned from = it->from;
+		unsigned to = it->to;
+		if ( m_locked[ from ] || m_locked[ to ] )
+			continue;
+
+		bool bFree = true;
+		for ( unsigned t = m_offsets[ from ]; t < m_offsets[ from + 1 ] && bFree; t++ )
+			for ( unsigned j = 0; j < 3; j++ )
+				if ( m_locked[ m_triangles[ 3 * m_adjacency[ t ] + j ] ] )
+					bFree = false;
+		if ( !bFree || !isValid( from, to ) )
+			continue;
+
+		remap[ from ] = to;
+		m_quadrics[ to ].add( m_quadrics[ from ] );
+
+		for ( unsigned t = m_offsets[ from ]; t < m_offsets[ from + 1 ]; t++ )
+		{
+			const GLuint* triangle = &m_triangles[ 3 * m_adjacency[ t ] ];
+			if ( triangle[ 0 ] == to || triangle[ 1 ] == to || triangle[ 2 ] == to )
+				triangles--;
+			for ( unsigned j = 0; j < 3; j++ )
+				m_locked[ triangle[ j ] ] = 1;
+		}
+
+		const Quadric& absorbed( m_quadrics[ to ] );
+		if ( absorbed.planes > 0.0f )
+			m_maxError = std::max( m_maxError, evaluate( absorbed, &m_positions[ 3 * to ] ) / absorbed.planes );
+		count++;
+	}
+
+	// move the collapsed vertices and drop the triangles that have become degenerate
+	unsigned size = 0;
+	for ( unsigned i = 0; i < m_triangles.size(); i += 3 )
+	{
+		GLuint a = remap[ m_triangles[ i ] ], b = remap[ m_triangles[ i + 1 ] ], c = remap[ m_triangles[ i + 2 ] ];
+		if ( a == b || b == c || a == c )
+			continue;
+		m_triangles[ size++ ] = a;
+		m_triangles[ size++ ] = b;
+		m_triangles[ size++ ] = c;
+	}
+	m_triangles.resize( size );
+
+	return count;
+}
+
+
+} } // namespace Ubitrack::Drivers
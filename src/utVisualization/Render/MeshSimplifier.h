@@ -0,0 +1,160 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Simplification of triangle meshes by quadric edge collapse.
+ */
+
+#ifndef __MeshSimplifier_h_INCLUDED__
+#define __MeshSimplifier_h_INCLUDED__
+
+#include <vector>
+
+#include "GL/freeglut.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Reduces an indexed triangle list by collapsing edges in the order of their quadric error.
+ *
+ * Every collapse moves one vertex of an edge onto the other one, so the simplified triangles
+ * index a subset of the original vertices and can share their buffer, normals and texture
+ * coordinates. The error of a vertex is the sum of the squared distances to the planes of the
+ * original triangles it has absorbed (Garland and Heckbert). Divided by the number of planes,
+ * its square root is the RMS distance of the vertex from them, which is reported as the error.
+ *
+ * Collapses run in passes: each pass builds the vertex-triangle adjacency, sorts the possible
+ * collapses by error and performs those whose neighbourhoods do not overlap. Collapses that
+ * would remove a vertex on a border or non-manifold edge, flip a triangle or join two sheets
+ * are rejected, so the result may keep more triangles than requested.
+ */
+class MeshSimplifier
+{
+public:
+
+	/**
+	 * copies the positions of the vertices used by the triangles, does not keep the arrays
+	 * @param vertices interleaved vertices starting with the position
+	 * @param stride floats per vertex
+	 * @param indices triangle list
+	 * @param indexCount number of indices, a multiple of three
+	 */
+	MeshSimplifier( const float* vertices, unsigned stride, const GLuint* indices, unsigned indexCount );
+
+	/**
+	 * Collapses edges until at most targetTriangles remain or no edge can be collapsed.
+	 * Calling it again with a smaller target continues from the previous result.
+	 * @return the remaining triangles, indexing the original vertices
+	 */
+	const std::vector< GLuint >& simplify( unsigned targetTriangles );
+
+	/** number of remaining triangles */
+	unsigned triangles() const
+	{ return m_triangles.size() / 3; }
+
+	/** largest RMS distance of a collapsed vertex from its planes so far, in the units of the vertices */
+	double error() const;
+
+protected:
+
+	/** symmetric 4x4 matrix, the sum of the squared distance functions of planes */
+	struct Quadric
+	{
+		float a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		/** number of planes */
+		float planes;
+
+		void add( const Quadric& q )
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+			bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+			planes += q.planes;
+		}
+	};
+
+	/** a collapse of vertex from into vertex to */
+	struct Collapse
+	{
+		unsigned from;
+		unsigned to;
+		float error;
+
+		bool operator<( const Collapse& other ) const
+		{ return error < other.error; }
+	};
+
+	/** one pass of independent collapses, returns the number of collapses */
+	unsigned pass( unsigned targetTriangles );
+
+	/** builds the triangles of each vertex and marks vertices on border or non-manifold edges */
+	void buildAdjacency();
+
+	/** squared distance sum of the quadric of a vertex at a position */
+	float evaluate( const Quadric& q, const float* p ) const;
+
+	/** false if moving vertex from onto vertex to would flip a triangle or create a non-manifold edge */
+	bool isValid( unsigned from, unsigned to );
+
+	/** positions of the used vertices, scaled into the unit cube */
+	std::vector< float > m_positions;
+	double m_scale;
+
+	/** original index of each used vertex */
+	std::vector< GLuint > m_original;
+
+	std::vector< Quadric > m_quadrics;
+
+	/** current triangle list in indices of used vertices */
+	std::vector< GLuint > m_triangles;
+
+	/** triangles of each vertex: m_adjacency[ m_offsets[ v ] ] to m_adjacency[ m_offsets[ v + 1 ] - 1 ] */
+	std::vector< unsigned > m_offsets;
+	std::vector< unsigned > m_adjacency;
+
+	/** vertex lies on a border or non-manifold edge and must not be removed */
+	std::vector< char > m_border;
+
+	/** vertex takes part in a collapse of the current pass */
+	std::vector< char > m_locked;
+
+	/** stamps for the neighbour comparison of isValid() */
+	std::vector< unsigned > m_marks;
+	unsigned m_mark;
+
+	/** largest squared RMS distance of a collapse, in unit cube coordinates */
+	float m_maxError;
+
+	/** result in original indices */
+	std::vector< GLuint > m_result;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
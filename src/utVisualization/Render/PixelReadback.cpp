@@ -0,0 +1,126 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Asynchronous readback of the frame buffer through pixel buffer objects.
+ */
+
+#include "PixelReadback.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+PixelReadback::PixelReadback( unsigned size )
+	: m_slots( size < 1 ? 1 : size )
+	, m_next( 0 )
+	, m_width( 0 )
+	, m_height( 0 )
+	, m_format( 0 )
+	, m_type( 0 )
+{
+	for ( unsigned i = 0; i < m_slots.size(); i++ )
+	{
+		m_slots[ i ].buffer = 0;
+		m_slots[ i ].bPending = false;
+		m_slots[ i ].time = 0;
+	}
+}
+
+
+bool PixelReadback::read( const GLExtensions& ext, int width, int height, GLenum format, GLenum type, unsigned pixelSize, 
+	Measurement::Timestamp time )
+{
+	if ( !ext.hasPixelBufferObject() )
+		return false;
+
+	// (re-)allocate the ring
+	if ( width != m_width || height != m_height || format != m_format || type != m_type || !m_slots[ 0 ].buffer )
+	{
+		clear( ext );
+		m_width = width;
+		m_height = height;
+		m_format = format;
+		m_type = type;
+
+		for ( unsigned i = 0; i < m_slots.size(); i++ )
+		{
+			ext.genBuffers( 1, &m_slots[ i ].buffer );
+			ext.bindBuffer( GL_PIXEL_PACK_BUFFER, m_slots[ i ].buffer );
+			ext.bufferData( GL_PIXEL_PACK_BUFFER, ptrdiff_t( width ) * height * pixelSize, 0, GL_STREAM_READ );
+		}
+	}
+
+	Slot& slot = m_slots[ m_next ];
+	ext.bindBuffer( GL_PIXEL_PACK_BUFFER, slot.buffer );
+	glReadPixels( 0, 0, width, height, format, type, 0 );
+	ext.bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	slot.bPending = true;
+	slot.time = time;
+	m_next = ( m_next + 1 ) % m_slots.size();
+	return true;
+}
+
+
+const void* PixelReadback::map( const GLExtensions& ext, Measurement::Timestamp& time )
+{
+	// with a single buffer, the frame that was just read is mapped
+	Slot& slot = m_slots[ m_next ];
+	if ( !slot.bPending )
+		return 0;
+
+	slot.bPending = false;
+	time = slot.time;
+
+	ext.bindBuffer( GL_PIXEL_PACK_BUFFER, slot.buffer );
+	const void* pData = ext.mapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY );
+	if ( !pData )
+		ext.bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	return pData;
+}
+
+
+void PixelReadback::unmap( const GLExtensions& ext )
+{
+	ext.unmapBuffer( GL_PIXEL_PACK_BUFFER );
+	ext.bindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+}
+
+
+void PixelReadback::clear( const GLExtensions& ext )
+{
+	for ( unsigned i = 0; i < m_slots.size(); i++ )
+	{
+		if ( m_slots[ i ].buffer )
+			ext.deleteBuffers( 1, &m_slots[ i ].buffer );
+		m_slots[ i ].buffer = 0;
+		m_slots[ i ].bPending = false;
+	}
+	m_next = 0;
+	m_width = m_height = 0;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,105 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Asynchronous readback of the frame buffer through pixel buffer objects.
+ */
+
+#ifndef __PixelReadback_h_INCLUDED__
+#define __PixelReadback_h_INCLUDED__
+
+#include <vector>
+
+#include <utMeasurement/Measurement.h>
+
+#include "GLExtensions.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Ring of pixel buffer objects for glReadPixels.
+ *
+ * Frame k is read into buffer k mod N and mapped on frame k+N-1, so the
+ * transfer overlaps with rendering the frames in between instead of
+ * stalling the pipeline. All methods must be called on the GL thread.
+ */
+class PixelReadback
+{
+public:
+
+	/** @param size number of buffers in the ring, at least 2 for asynchronous transfers */
+	PixelReadback( unsigned size );
+
+	/** 
+	 * Starts reading the current read buffer into the next buffer of the ring.
+	 * Pending frames are dropped if the size or format changes.
+	 * @return false if pixel buffer objects are not supported, nothing is read then
+	 */
+	bool read( const GLExtensions& ext, int width, int height, GLenum format, GLenum type, unsigned pixelSize, 
+		Measurement::Timestamp time );
+
+	/**
+	 * Maps the oldest frame once the ring is full. Rows are tightly packed from bottom to top.
+	 * @param time receives the timestamp given to read()
+	 * @return pointer to the pixels, 0 if no frame is ready. Must be followed by unmap().
+	 */
+	const void* map( const GLExtensions& ext, Measurement::Timestamp& time );
+
+	/** releases the frame returned by map() */
+	void unmap( const GLExtensions& ext );
+
+	/** deletes all buffers, pending frames are lost */
+	void clear( const GLExtensions& ext );
+
+	int width() const
+	{ return m_width; }
+
+	int height() const
+	{ return m_height; }
+
+protected:
+
+	struct Slot
+	{
+		GLuint buffer;
+		bool bPending;
+		Measurement::Timestamp time;
+	};
+
+	std::vector< Slot > m_slots;
+
+	/** slot that is written next, the oldest pending frame */
+	unsigned m_next;
+
+	int m_width, m_height;
+	GLenum m_format, m_type;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
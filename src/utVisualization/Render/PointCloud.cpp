@@ -36,6 +36,8 @@ PointCloud::PointCloud( const std::string& name, boost::shared_ptr< Graph::UTQLS
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
 	, m_push ( "PushInput", *this, boost::bind( &PointCloud::dataIn, this, _1 ))
+	, m_incoming( m_frameInputs )
+	, m_expiredCount( 0 )
 	, m_ttl(1.0)
 	, m_size(5.0)
 	, m_setup(1)
@@ -56,21 +58,14 @@ PointCloud::PointCloud( const std::string& name, boost::shared_ptr< Graph::UTQLS
 /** render the object */
 void PointCloud::draw( Measurement::Timestamp&, int parity )
 {
-	boost::mutex::scoped_lock l( m_lock );
-
-	// throw out old stuff
-	Measurement::Timestamp current = Measurement::now();
-	if (m_ttl > 0.0)
-		while ( !m_data.empty() && ((current - m_data.front().time()) > m_ttl*1000000000.0) )
-			m_data.pop_front();
-
+	GLStateCache& state = m_pModule->glState();
 	glColor4dv( m_color );
-	glPointSize( (float)m_size );
+	state.pointSize( (float)m_size );
 
 	if (m_setup)
 	{
 		// lots of nice-looking extras
-		glEnable( GL_POINT_SMOOTH );
+		state.enable( GL_POINT_SMOOTH );
 		glHint( GL_POINT_SMOOTH_HINT, GL_NICEST );
 		m_setup = 0;
 
@@ -93,6 +88,28 @@ void PointCloud::draw( Measurement::Timestamp&, int parity )
 	}
 }
 
+void PointCloud::latchInputs()
+{
+	VirtualObject::latchInputs();
+
+	// add the point lists received since the last frame
+	m_data.insert( m_data.end(), m_incoming.get().begin(), m_incoming.get().end() );
+
+	// throw out old stuff
+	Measurement::Timestamp current = Measurement::now();
+	if (m_ttl > 0.0)
+		while ( !m_data.empty() && ((current - m_data.front().time()) > m_ttl*1000000000.0) )
+		{
+			m_data.pop_front();
+			m_expiredCount++;
+		}
+}
+
+unsigned long PointCloud::generation()
+{
+	return m_frameInputs.generation() + m_expiredCount;
+}
+
 bool PointCloud::hasWaitingEvents()
 {
 	return ( m_push.getQueuedEvents() > 0 );
@@ -105,8 +122,7 @@ bool PointCloud::hasWaitingEvents()
  */
 void PointCloud::dataIn( const Ubitrack::Measurement::PositionList& pos )
 {
-	boost::mutex::scoped_lock l( m_lock );
-	m_data.push_back( pos );
+	m_incoming.push( pos );
 
 	// redraw the world
 	m_pModule->invalidate();
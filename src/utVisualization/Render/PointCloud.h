@@ -55,6 +55,10 @@ public:
 
 	virtual bool hasWaitingEvents();
 
+	virtual void latchInputs();
+
+	virtual unsigned long generation();
+
 protected:
 
 	/**
@@ -66,9 +70,15 @@ protected:
 	// pose input
 	PushConsumer< Measurement::PositionList > m_push;
 
+	// point lists received since the last frame
+	FrameQueue< Measurement::PositionList > m_incoming;
+
+	// point lists that are shown, used by the render thread only
 	std::deque< Measurement::PositionList > m_data;
 
-	boost::mutex m_lock;
+	// number of point lists that have expired, used by the render thread only
+	unsigned long m_expiredCount;
+
 	double m_ttl, m_size;
 	double m_color[4];
 	int m_setup;
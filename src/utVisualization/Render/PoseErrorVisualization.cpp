@@ -64,12 +64,49 @@ void rotErrorJacobian( Math::Matrix< double, 3, 3 >& j, const Math::Vector< doub
 	j( 2, 2 ) = 0.0;
 }
 
+/**
+ * Adds a unit sphere with the tessellation of gluSphere() to a GL_TRIANGLES mesh with normals
+ */
+void addSphere( GLGeometry& geometry, unsigned slices, unsigned stacks )
+{
+	for ( unsigned i = 0; i <= stacks; i++ )
+	{
+		double phi = M_PI * i / stacks;
+		for ( unsigned j = 0; j <= slices; j++ )
+		{
+			double theta = 2 * M_PI * j / slices;
+			float x = float( sin( phi ) * cos( theta ) );
+			float y = float( sin( phi ) * sin( theta ) );
+			float z = float( cos( phi ) );
+			geometry.normal( x, y, z );
+			geometry.vertex( x, y, z );
+		}
+	}
+
+	// two counter-clockwise triangles per quad
+	for ( unsigned i = 0; i < stacks; i++ )
+		for ( unsigned j = 0; j < slices; j++ )
+		{
+			GLuint a = i * ( slices + 1 ) + j;
+			GLuint b = a + slices + 1;
+			geometry.index( a );
+			geometry.index( b );
+			geometry.index( b + 1 );
+			geometry.index( a );
+			geometry.index( b + 1 );
+			geometry.index( a + 1 );
+		}
+}
+
 } // anonymous namespace
 
 PoseErrorVisualization::PoseErrorVisualization( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph,
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: TrackedObject( name, subgraph, componentKey, pModule )
 	, m_errorPushPort( "ErrorInput", *this, boost::bind( &PoseErrorVisualization::receiveError, this, _1 ) )
+	, m_errorCount( 0 )
+	, m_sphere( GL_TRIANGLES, GLGeometry::normals )
+	, m_axes( GL_LINES, GLGeometry::colors )
 {
 	double scaling = 3.0;
 	double axisLength = 0.1;
@@ -88,62 +125,66 @@ PoseErrorVisualization::PoseErrorVisualization( const std::string& name, boost::
 }
 
 
-void PoseErrorVisualization::draw3DContent( Measurement::Timestamp& t, int )
+void PoseErrorVisualization::glInit()
 {
-	LOG4CPP_DEBUG( logger, "Drawing ellipsoids" );
+	m_sphere.clear();
+	addSphere( m_sphere, 20, 10 );
+
+	m_axes.clear();
+	const ErrorEllipsoid* ellipsoids[ 3 ] = { &m_rotXEllipsoid, &m_rotYEllipsoid, &m_rotZEllipsoid };
+	for ( unsigned i = 0; i < 3; i++ )
+	{
+		const Math::Vector< double, 3 >& p( ellipsoids[ i ]->position() );
+		m_axes.color( i == 0 ? 0.8f : 0.0f, i == 1 ? 0.8f : 0.0f, i == 2 ? 0.8f : 0.0f );
+		m_axes.vertex( 0, 0, 0 );
+		m_axes.vertex( float( p( 0 ) ), float( p( 1 ) ), float( p( 2 ) ) );
+	}
+}
+
 
-	// save old state
-	GLboolean oldCullMode;
-	glGetBooleanv( GL_CULL_FACE, &oldCullMode );
+void PoseErrorVisualization::drawEllipsoid( ErrorEllipsoid& ellipsoid )
+{
+	glPushMatrix();
+	ellipsoid.transform();
+	drawGeometry( m_sphere );
+	glPopMatrix();
+}
 
-	GLboolean oldLineSmooth = glIsEnabled( GL_LINE_SMOOTH );
 
-	GLfloat oldLineWidth;
-	glGetFloatv( GL_LINE_WIDTH, &oldLineWidth );
+void PoseErrorVisualization::draw3DContent( Measurement::Timestamp& t, int )
+{
+	LOG4CPP_DEBUG( logger, "Drawing ellipsoids" );
 
-	// set new state
-	glEnable( GL_CULL_FACE );
-	glLineWidth( 1 );
-	glEnable( GL_LINE_SMOOTH );
+	boost::mutex::scoped_lock l( m_errorLock );
+
+	// set new state, the old one is restored afterwards
+	GLStateCache& state = m_pModule->glState();
+	state.push();
+	state.enable( GL_CULL_FACE );
+	state.lineWidth( 1 );
+	state.enable( GL_LINE_SMOOTH );
 
 	// position error
 	glColor3f( 0.8f, 0.8f, 0.0f );
-	m_posEllipsoid.draw();
+	drawEllipsoid( m_posEllipsoid );
 
 	// x-axis rotation error
 	glColor3f( 0.8f, 0.0f, 0.0f );
-	m_rotXEllipsoid.draw();
-
-	glBegin( GL_LINES );
-		glVertex3d( 0, 0, 0 );
-		glVertex3d( m_rotXEllipsoid.position()( 0 ), m_rotXEllipsoid.position()( 1 ), m_rotXEllipsoid.position()( 2 ) );
-	glEnd();
+	drawEllipsoid( m_rotXEllipsoid );
 
 	// y-axis rotation error
 	glColor3f( 0.0f, 0.8f, 0.0f );
-	m_rotYEllipsoid.draw();
-
-	glBegin( GL_LINES );
-		glVertex3d( 0, 0, 0 );
-		glVertex3d( m_rotYEllipsoid.position()( 0 ), m_rotYEllipsoid.position()( 1 ), m_rotYEllipsoid.position()( 2 ) );
-	glEnd();
+	drawEllipsoid( m_rotYEllipsoid );
 
 	// z-axis rotation error
 	glColor3f( 0.0f, 0.0f, 0.8f );
-	m_rotZEllipsoid.draw();
+	drawEllipsoid( m_rotZEllipsoid );
 
-	glBegin( GL_LINES );
-		glVertex3d( 0, 0, 0 );
-		glVertex3d( m_rotZEllipsoid.position()( 0 ), m_rotZEllipsoid.position()( 1 ), m_rotZEllipsoid.position()( 2 ) );
-	glEnd();
+	// axes to the rotation errors
+	drawGeometry( m_axes );
 
 	// restore old state
-	if ( !oldCullMode )
-		glDisable( GL_CULL_FACE );
-
-	if ( !oldLineSmooth )
-		glDisable( GL_LINE_SMOOTH );
-	glLineWidth( oldLineWidth );
+	state.pop();
 }
 
 
@@ -152,7 +193,7 @@ void PoseErrorVisualization::receiveError( const Ubitrack::Measurement::ErrorPos
 	LOG4CPP_DEBUG( logger, "Received error pose" );
 	LOG4CPP_TRACE( logger, *error );
 
-	boost::mutex::scoped_lock l( m_poseLock );
+	boost::mutex::scoped_lock l( m_errorLock );
 
 	// rotate the position covariance into the target coordinate frame
 	Matrix< double, 3, 3 > j( ~error->rotation() );
@@ -185,6 +226,7 @@ void PoseErrorVisualization::receiveError( const Ubitrack::Measurement::ErrorPos
 
 	LOG4CPP_TRACE( logger, "Z rotation error: " << std::endl << posError );
 	m_rotZEllipsoid.setCovariance( posError );
+	m_errorCount++;
 }
 
 
@@ -59,9 +59,19 @@ public:
 	PoseErrorVisualization( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
+	/** builds the meshes of the sphere and the axes */
+	virtual void glInit();
+
 	/** render the object */
 	virtual void draw3DContent( Measurement::Timestamp&, int );
 
+	/** also changes with every received error */
+	virtual unsigned long generation()
+	{
+		unsigned long generation = TrackedObject::generation();
+		return generation == generationAlwaysChanged ? generation : generation + m_errorCount;
+	}
+
 protected:
 	/** receives error poses */
 	void receiveError( const Measurement::ErrorPose& error );
@@ -74,6 +84,21 @@ protected:
 	ErrorEllipsoid m_rotXEllipsoid;
 	ErrorEllipsoid m_rotYEllipsoid;
 	ErrorEllipsoid m_rotZEllipsoid;
+
+	/** protects the ellipsoids, which are updated by receiveError() */
+	boost::mutex m_errorLock;
+
+	/** number of received errors */
+	boost::atomic< unsigned long > m_errorCount;
+
+	/** unit sphere that is scaled into the ellipsoids */
+	GLGeometry m_sphere;
+
+	/** lines from the origin to the rotation error ellipsoids */
+	GLGeometry m_axes;
+
+	/** draws an ellipsoid with the sphere mesh */
+	void drawEllipsoid( ErrorEllipsoid& ellipsoid );
 };
 
 
@@ -0,0 +1,101 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Extrapolation of pushed poses to the display time of a frame.
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "PosePredictor.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/** rotation by \p s times the angle of \p q around the same axis */
+static Math::Quaternion scaleRotation( const Math::Quaternion& q, double s )
+{
+	// take the shorter way around
+	double sign = q.w() < 0 ? -1.0 : 1.0;
+	double x = sign * q.x();
+	double y = sign * q.y();
+	double z = sign * q.z();
+	double w = sign * q.w();
+
+	double sinHalfAngle = std::sqrt( x * x + y * y + z * z );
+	if ( sinHalfAngle < 1e-12 )
+		return Math::Quaternion( 0, 0, 0, 1 );
+
+	double halfAngle = s * std::atan2( sinHalfAngle, w );
+	double f = std::sin( halfAngle ) / sinHalfAngle;
+	return Math::Quaternion( f * x, f * y, f * z, std::cos( halfAngle ) );
+}
+
+
+PosePredictor::PosePredictor( unsigned historySize )
+	: m_historySize( historySize < 2 ? 2 : historySize )
+{
+}
+
+
+void PosePredictor::add( const Measurement::Pose& pose )
+{
+	if ( !m_history.empty() )
+	{
+		if ( pose.time() == m_history.back().time() )
+			return;
+		if ( pose.time() < m_history.back().time() )
+			m_history.clear();
+	}
+
+	m_history.push_back( pose );
+	if ( m_history.size() > m_historySize )
+		m_history.pop_front();
+}
+
+
+Math::Pose PosePredictor::predict( Measurement::Timestamp t, Measurement::Timestamp maxExtrapolation ) const
+{
+	const Measurement::Pose& newest = m_history.back();
+	if ( m_history.size() < 2 || t <= newest.time() )
+		return *newest;
+
+	const Measurement::Pose& oldest = m_history.front();
+	Measurement::Timestamp horizon = std::min( t - newest.time(), maxExtrapolation );
+	double s = double( horizon ) / double( newest.time() - oldest.time() );
+
+	// constant linear velocity
+	Math::Vector< double, 3 > translation( newest->translation() + s * ( newest->translation() - oldest->translation() ) );
+
+	// constant angular velocity: continue the rotation from the oldest to the newest pose
+	Math::Quaternion rotation( scaleRotation( newest->rotation() * ~oldest->rotation(), s ) * newest->rotation() );
+	rotation.normalize();
+
+	return Math::Pose( rotation, translation );
+}
+
+
+} } // namespace Ubitrack::Drivers
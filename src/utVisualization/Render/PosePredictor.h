@@ -0,0 +1,80 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Extrapolation of pushed poses to the display time of a frame.
+ */
+
+#ifndef __PosePredictor_h_INCLUDED__
+#define __PosePredictor_h_INCLUDED__
+
+#include <deque>
+
+#include <utMeasurement/Measurement.h>
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Keeps the last few poses of a push input and extrapolates them.
+ *
+ * Translation is extrapolated with constant linear velocity, rotation
+ * with constant angular velocity, both estimated from the oldest and the
+ * newest pose in the history. Poses may be added at a lower rate than they are
+ * measured, e.g. once per frame. Not thread-safe.
+ */
+class PosePredictor
+{
+public:
+
+	/** @param historySize number of poses used to estimate the velocities, at least 2 */
+	PosePredictor( unsigned historySize = 3 );
+
+	/** adds a new pose. The newest pose is ignored if added again, an older one restarts the history. */
+	void add( const Measurement::Pose& pose );
+
+	/** true if no pose has been added yet */
+	bool empty() const
+	{ return m_history.empty(); }
+
+	/**
+	 * Extrapolates the pose to time \p t. Must not be called on an empty history.
+	 * @param t the time the pose is needed for
+	 * @param maxExtrapolation maximum time in nanoseconds to extrapolate beyond the newest pose
+	 * @return the newest pose if \p t is not after it or the velocity is unknown
+	 */
+	Math::Pose predict( Measurement::Timestamp t, Measurement::Timestamp maxExtrapolation ) const;
+
+protected:
+
+	std::deque< Measurement::Pose > m_history;
+	unsigned m_historySize;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -50,6 +50,7 @@ PositionErrorVisualization::PositionErrorVisualization( const std::string& name,
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: TrackedObject( name, subgraph, componentKey, pModule )
 	, m_errorPushPort( "ErrorInput", *this, boost::bind( &PositionErrorVisualization::receiveError, this, _1 ) )
+	, m_errorCount( 0 )
 {
 	double scaling = 3.0;
 	subgraph->m_DataflowAttributes.getAttributeData( "scaling", scaling );
@@ -61,19 +62,18 @@ void PositionErrorVisualization::draw3DContent( Measurement::Timestamp& t, int )
 {
 	LOG4CPP_DEBUG( logger, "Drawing ellipsoids" );
 
-	// save old state
-	GLboolean oldCullMode;
-	glGetBooleanv( GL_CULL_FACE, &oldCullMode );
+	boost::mutex::scoped_lock l( m_errorLock );
 
-	// set new state
-	glEnable( GL_CULL_FACE );
+	// set new state, the old one is restored afterwards
+	GLStateCache& state = m_pModule->glState();
+	state.push();
+	state.enable( GL_CULL_FACE );
 
 	glColor3f( 0.3f, 0.9f, 0.9f );
 	m_posEllipsoid.draw();
 
 	// restore old state
-	if ( !oldCullMode )
-		glDisable( GL_CULL_FACE );
+	state.pop();
 }
 
 
@@ -82,8 +82,10 @@ void PositionErrorVisualization::receiveError( const Ubitrack::Measurement::Erro
 	LOG4CPP_DEBUG( logger, "Received error position" );
 	LOG4CPP_TRACE( logger, error->value << ", " << error->covariance );
 
+	boost::mutex::scoped_lock l( m_errorLock );
 	m_posEllipsoid.setPosition( error->value );
 	m_posEllipsoid.setCovariance( error->covariance );
+	m_errorCount++;
 }
 
 
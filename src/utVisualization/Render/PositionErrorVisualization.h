@@ -62,6 +62,13 @@ public:
 	/** render the object */
 	virtual void draw3DContent( Measurement::Timestamp&, int );
 
+	/** also changes with every received error */
+	virtual unsigned long generation()
+	{
+		unsigned long generation = TrackedObject::generation();
+		return generation == generationAlwaysChanged ? generation : generation + m_errorCount;
+	}
+
 protected:
 	/** receives error poses */
 	void receiveError( const Measurement::ErrorPosition& error );
@@ -71,6 +78,12 @@ protected:
 
 	/* the ellipsoid */
 	ErrorEllipsoid m_posEllipsoid;
+
+	/** protects the ellipsoid, which is updated by receiveError() */
+	boost::mutex m_errorLock;
+
+	/** number of received errors */
+	boost::atomic< unsigned long > m_errorCount;
 };
 
 
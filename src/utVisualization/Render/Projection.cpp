@@ -29,6 +29,7 @@ namespace Ubitrack { namespace Drivers {
 Projection::Projection( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_pushed( m_frameInputs )
 {
 	if ( subgraph->hasEdge( "Input" ) )
 	{
@@ -37,13 +38,13 @@ Projection::Projection( const std::string& name, boost::shared_ptr< Graph::UTQLS
 		if ( pEdge->hasAttribute( "mode" ) && pEdge->getAttributeString( "mode" ) == "pull" )
 			m_pPull.reset( new PullConsumer< Ubitrack::Measurement::Matrix4x4 >( "Input", *this ) );
 		else
-			m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Matrix4x4 >( "Input", *this, boost::bind( &Projection::inputIn, this, _1, 1 ) ) );
+			m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Matrix4x4 >( "Input", *this, boost::bind( &Projection::pushIn, this, _1 ) ) );
 	}
 	else
 	{
 		// legacy behaviour
 		m_pPull.reset( new PullConsumer< Ubitrack::Measurement::Matrix4x4 >( "PullInput", *this ) );
-		m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Matrix4x4 >( "PushInput", *this, boost::bind( &Projection::inputIn, this, _1, 1 ) ) );
+		m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Matrix4x4 >( "PushInput", *this, boost::bind( &Projection::pushIn, this, _1 ) ) );
 	}
 }
 
@@ -55,25 +56,39 @@ void Projection::draw( Measurement::Timestamp& time, int parity )
 		return;
 		
 	if ( m_pPull && m_pPull->isConnected())
-		inputIn( m_pPull->get(time), 0);
+		inputIn( m_pPull->get( time ) );
+	else if ( m_pushed.get() )
+		inputIn( m_pushed.get() );
 
 	LOG4CPP_TRACE( logger, "Updating projection matrix to:" << std::endl << m_projection );
-	glMatrixMode( GL_PROJECTION );
-	glLoadMatrixd( m_projection.content() );
-	glMatrixMode( GL_MODELVIEW );
+	m_pModule->loadProjection( m_projection.content() );
+}
+
+unsigned long Projection::generation()
+{
+	if ( m_pPull && m_pPull->isConnected() )
+		return generationAlwaysChanged;
+	return m_frameInputs.generation();
+}
+
+/**
+ * callback from the push input port
+ * @param m input matrix
+ */
+void Projection::pushIn( const Measurement::Matrix4x4& m )
+{
+	m_pushed.write( m );
+	m_pModule->invalidate();
 }
 
 /**
- * callback from Pose input port
- * @param pose input pose
- * @param redraw trigger a redraw? (only if called from push-input)
+ * takes the input matrix of the current frame, called on the render thread
+ * @param m input matrix
  */
-void Projection::inputIn( const Measurement::Matrix4x4& m, int redraw )
+void Projection::inputIn( const Measurement::Matrix4x4& m )
 {
 	m_lastUpdateTime = m.time();
 	m_projection = *(m.get());
-	// the pose has changed, so redraw the world
-	if (redraw) m_pModule->invalidate();
 }
 
 } } // namespace Ubitrack::Drivers
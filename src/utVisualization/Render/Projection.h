@@ -54,14 +54,24 @@ public:
 	/** render the object */
 	virtual void draw( Measurement::Timestamp& time, int parity );
 
+	virtual unsigned long generation();
+
 protected:
 
 	/**
-	 * callback from Pose input port
-	 * @param pose input pose
-	 * @param redraw trigger a redraw? (only if called from push-input)
+	 * callback from the push input port
+	 * @param m input matrix
 	 */
-	void inputIn( const Measurement::Matrix4x4& m, int redraw );
+	void pushIn( const Measurement::Matrix4x4& m );
+
+	/**
+	 * takes the input matrix of the current frame, called on the render thread
+	 * @param m input matrix
+	 */
+	void inputIn( const Measurement::Matrix4x4& m );
+
+	/** matrix from the push input, frozen for the current frame */
+	FrameValue< Measurement::Matrix4x4 > m_pushed;
 
 	Ubitrack::Math::Matrix< double, 4, 4 > m_projection;
 
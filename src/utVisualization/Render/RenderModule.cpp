@@ -33,6 +33,7 @@
 
 log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render" ) );
 log4cpp::Category& loggerEvents( log4cpp::Category::getInstance( "Ubitrack.Events.Drivers.Render" ) );
+log4cpp::Category& loggerStats( log4cpp::Category::getInstance( "Drivers.Render.Stats" ) );
 
 #ifdef HAVE_OPENCV
 	#include "BackgroundImage.h"
@@ -67,14 +68,20 @@ log4cpp::Category& loggerEvents( log4cpp::Category::getInstance( "Ubitrack.Event
 #include "Cross2D.h"
 #include "Fullscreen.h"
 #include "StereoRendering.h"
+#include "LatencyOutput.h"
 
 #include <utUtil/Exception.h>
 #include <utUtil/OS.h>
 #include <boost/scoped_ptr.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <iomanip>
+#include <algorithm>
 #include <math.h>
 
+#if !defined( _WIN32 ) && !defined( __APPLE__ )
+	#include <X11/Xlib.h>
+#endif
+
 
 namespace Ubitrack { namespace Drivers {
 
@@ -86,21 +93,49 @@ std::deque< VirtualCamera* > g_setup;
 std::map< std::string, int > g_names;
 std::map< int, VirtualCamera* > g_modules;
 std::set< VirtualObject* > g_cleanup_components;
+std::set< VirtualCamera* > g_cleanup_modules;
 boost::scoped_ptr< boost::thread > g_glutThread;
 boost::mutex g_globalMutex;
 boost::condition g_setup_performed;
-boost::condition g_continue;
 boost::condition g_cleanup_done;
+FrameScheduler g_scheduler( "Render thread" );
+boost::mutex g_glewMutex;
 #ifdef __APPLE__
 	bool g_glutInitialized = false;
 #endif
 
 int g_run = 1;
 
+// GLUT cannot wake up the render thread on window system events, so these are polled at this interval
+const Measurement::Timestamp g_eventPollInterval = 100000000LL;
+
+// while further updates are queued, a redraw is postponed by at most this time, polling at the given interval
+const Measurement::Timestamp g_maxCoalesceTime = 5000000LL;
+const Measurement::Timestamp g_coalescePollInterval = 1000000LL;
+
+// interval between two statistics outputs of a window
+const Measurement::Timestamp g_statsInterval = 10000000000LL;
+
 // fake command line for GLUT (yes, the library _is_ 10 years old)
 int   g_argc   = 1;
 char* g_argv[] = { "VirtualCamera", 0 };
 
+// column-major identity matrix
+const double g_identity[ 16 ] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// product a * b of column-major 4x4 matrices, as glMultMatrixd() computes it
+static void multMatrix( const double* a, const double* b, double* result )
+{
+	for ( unsigned c = 0; c < 4; c++ )
+		for ( unsigned r = 0; r < 4; r++ )
+		{
+			double sum = 0.0;
+			for ( unsigned k = 0; k < 4; k++ )
+				sum += a[ k * 4 + r ] * b[ c * 4 + k ];
+			result[ c * 4 + r ] = sum;
+		}
+}
+
 
 
 void g_mainloop()
@@ -117,6 +152,10 @@ void g_mainloop()
 	if ( !glutGet(GLUT_INIT_STATE) )
 	{
 #endif
+		#if !defined( _WIN32 ) && !defined( __APPLE__ )
+			// windows with their own render thread use Xlib concurrently to the GLUT thread
+			XInitThreads();
+		#endif
 		glutInit( &g_argc, g_argv );
 		glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH );
 		glutSetOption( GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_CONTINUE_EXECUTION );
@@ -156,7 +195,7 @@ void g_mainloop()
 			while ( ! g_cleanup_components.empty() )
 			{
 				VirtualObject * voPtr = *(g_cleanup_components.begin());
-				voPtr->glCleanup();
+				voPtr->getModule().cleanupComponent( voPtr );
 				g_cleanup_components.erase( voPtr );
 
 				// let GLUT do its thing..
@@ -165,6 +204,19 @@ void g_mainloop()
 			g_cleanup_done.notify_all();
 			LOG4CPP_DEBUG( logger, "g_mainloop(): Cleaning done" );
 		}
+
+		// are there any windows to be destroyed whose GL resources have to be released?
+		if ( ! g_cleanup_modules.empty() )
+		{
+			LOG4CPP_DEBUG( logger, "g_mainloop(): Cleaning up GL context of all pending windows..." );
+			while ( ! g_cleanup_modules.empty() )
+			{
+				VirtualCamera* module = *(g_cleanup_modules.begin());
+				module->cleanupGL();
+				g_cleanup_modules.erase( module );
+			}
+			g_cleanup_done.notify_all();
+		}
 		
 		// check
 		// - if a redraw is needed for any window
@@ -209,14 +261,24 @@ void g_mainloop()
 		// let GLUT do its thing..
 		glutMainLoopEvent();
 
-		// Be nice to the rest of the system. g_glutThread->yield() doesn't have any noticeable effect
-		// with timeslices of the size that is common today. 5 ms maxes the frame rate at 200 Hz, but 
-		// that should be sufficient for most kinds of hardware.
-		// FIXME: probably needs to be increased to at least 60 Hz again for frame-sequential stereo
-		// Can this only be done when stereo is actually used? Otherwise this will be a waste of processing time.(DP)
-		g_continue.timed_wait( lock, boost::posix_time::milliseconds(100) );
+		// sleep until the earliest window needs a new frame or somebody calls g_scheduler.wakeup()
+		Measurement::Timestamp now = Measurement::now();
+		Measurement::Timestamp deadline = now + g_eventPollInterval;
+		for ( pos = g_modules.begin(); pos != g_modules.end(); pos++ )
+		{
+			if ( !pos->second || pos->second->hasOwnThread() )
+				continue;
+			Measurement::Timestamp next = pos->second->nextFrameTime( now );
+			if ( next && next < deadline )
+				deadline = next;
+		}
+
+		// the global mutex is released while sleeping, so the dataflow can make progress
+		lock.unlock();
+		g_scheduler.waitUntil( deadline );
+		lock.lock();
 		
-		LOG4CPP_TRACE( logger, "g_mainloop(): timed_wait finished" );
+		LOG4CPP_TRACE( logger, "g_mainloop(): waitUntil finished" );
 	}
 }
 
@@ -224,7 +286,11 @@ void g_mainloop()
 void g_display()
 {
 	VirtualCamera* win = g_modules[ glutGetWindow() ];
-	if ( win ) win->display();
+	if ( !win ) return;
+	if ( win->hasOwnThread() ) 
+		win->postRedisplay();
+	else
+		win->display();
 }
 
 
@@ -235,10 +301,21 @@ void g_keyboard( unsigned char key, int x, int y )
 }
 
 
+void g_windowStatus( int state )
+{
+	VirtualCamera* win = g_modules[ glutGetWindow() ];
+	if ( win ) win->setHidden( state == GLUT_HIDDEN || state == GLUT_FULLY_COVERED );
+}
+
+
 void g_reshape( int w, int h )
 {
 	VirtualCamera* win = g_modules[ glutGetWindow() ];
-	if ( win ) win->reshape( w, h );
+	if ( !win ) return;
+	if ( win->hasOwnThread() ) 
+		win->postReshape( w, h );
+	else
+		win->reshape( w, h );
 }
 
 
@@ -291,22 +368,57 @@ int VirtualCamera::setup()
 			glutFullScreen();
 		#endif
 	
+	// make functions known to GLUT
+	glutKeyboardFunc( g_keyboard );
+	glutDisplayFunc ( g_display  );
+	glutReshapeFunc ( g_reshape  );
+	glutWindowStatusFunc( g_windowStatus );
+
+	// hand the window over to its own render thread if requested
+	if ( m_bOwnThread )
+	{
+		boost::scoped_ptr< GLContext > pContext( new WindowGLContext );
+		if ( pContext->isValid() )
+		{
+			LOG4CPP_DEBUG( logger, "setup(): Starting render thread for window " << m_winHandle );
+
+			m_context.swap( pContext );
+			m_renderThread.reset( new boost::thread( boost::bind( &VirtualCamera::renderLoop, this ) ) );
+			return 1;
+		}
+		LOG4CPP_WARN( logger, "setup(): Could not create a context for the render thread of '" << m_moduleKey << "', using the GLUT thread" );
+		m_bOwnThread = false;
+	}
+
+	initGL();
+	return 1;
+}
+
+
+void VirtualCamera::initGL()
+{
 	// GLEW provides access to OpenGL extensions
 	#ifdef HAVE_GLEW
+	{
+		boost::mutex::scoped_lock l( g_glewMutex );
 		glewInit();
+	}
 	#endif
 
+	// the context is new, so its state is known without asking GL
+	m_glState.reset();
+
 	// GL: enable and set colors
-	glEnable( GL_COLOR_MATERIAL );
+	m_glState.enable( GL_COLOR_MATERIAL );
 	glClearColor( 0.0, 0.0, 0.0, 1.0 ); // TODO: make this configurable (but black is best for optical see-through ar!)
 
 	// GL: enable and set depth parameters
-	glEnable( GL_DEPTH_TEST );
+	m_glState.enable( GL_DEPTH_TEST );
 	glClearDepth( 1.0 );
 
 	// GL: disable backface culling
 	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-	glDisable( GL_CULL_FACE );
+	m_glState.disable( GL_CULL_FACE );
 
 	// GL: light parameters
 	GLfloat light_pos[] = { 1.0f, 1.0f, 1.0f, 0.0f };
@@ -317,54 +429,274 @@ int VirtualCamera::setup()
 	glLightfv( GL_LIGHT0, GL_POSITION, light_pos );
 	glLightfv( GL_LIGHT0, GL_AMBIENT,  light_amb );
 	glLightfv( GL_LIGHT0, GL_DIFFUSE,  light_dif );
-	glEnable( GL_LIGHTING );
-	glEnable( GL_LIGHT0 );
+	m_glState.enable( GL_LIGHTING );
+	m_glState.enable( GL_LIGHT0 );
 
 	// GL: bitmap handling
 	glPixelStorei( GL_PACK_ALIGNMENT,   1 );
 	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 
 	// GL: alpha blending
-	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
-	glEnable( GL_BLEND );
+	m_glState.blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	m_glState.enable( GL_BLEND );
 
 	// GL: misc stuff
 	glShadeModel( GL_SMOOTH );
-	glEnable( GL_NORMALIZE );
+	m_glState.enable( GL_NORMALIZE );
 
-	// make functions known to GLUT
-	glutKeyboardFunc( g_keyboard );
-	glutDisplayFunc ( g_display  );
-	glutReshapeFunc ( g_reshape  );
+	m_glExtensions.load( m_context ? m_context->procLoader() : 0 );
+	m_textures.init( m_glExtensions, boost::bind( &VirtualCamera::requestFrame, this ) );
+	m_instances.init( m_glExtensions, m_moduleKey.m_bInstancing );
 
-	ComponentList objects = getAllComponents();
-	for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ )
+	const RenderList& objects = renderList();
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
 	{
         (*i)->glInit();
     }
-     
-	return 1;
 }
 
 
-void VirtualCamera::invalidate( VirtualObject* caller )
+void VirtualCamera::renderLoop()
 {
-	if (m_redraw) return;
-	// check if this is the last incoming update of several concurrent ones
-	ComponentList objects = getAllComponents();
-	for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ ) {
-		if ((*i).get() == caller) continue;
-		if ((*i)->hasWaitingEvents()) return;
+	LOG4CPP_DEBUG( logger, "renderLoop(): Render thread for '" << m_moduleKey << "' started" );
+
+	if ( !m_context->makeCurrent() )
+	{
+		LOG4CPP_ERROR( logger, "renderLoop(): Could not make context of '" << m_moduleKey << "' current" );
+		return;
 	}
+
+	{
+		boost::mutex::scoped_lock l( m_threadMutex );
+		m_bThreadRunning = true;
+	}
+
+	initGL();
+	glViewport( 0, 0, m_width, m_height );
+
+	while ( true )
+	{
+		{
+			boost::mutex::scoped_lock l( m_threadMutex );
+
+			// GL cleanup of stopped components
+			if ( !m_cleanupComponents.empty() )
+			{
+				for ( std::set< VirtualObject* >::iterator i = m_cleanupComponents.begin(); i != m_cleanupComponents.end(); i++ )
+					cleanupComponent( *i );
+				m_cleanupComponents.clear();
+				m_cleanupDone.notify_all();
+			}
+
+			if ( m_bStopThread )
+			{
+				m_bThreadRunning = false;
+				break;
+			}
+
+			if ( m_bReshapePending )
+			{
+				m_bReshapePending = false;
+				reshape( m_reshapeWidth, m_reshapeHeight );
+			}
+		}
+
+		Measurement::Timestamp now = Measurement::now();
+		Measurement::Timestamp next = nextFrameTime( now );
+		if ( next && next <= now )
+		{
+			m_redraw = 0;
+			display();
+			next = nextFrameTime( Measurement::now() );
+		}
+
+		m_scheduler.waitUntil( next );
+	}
+
+	cleanupGL();
+	m_context->release();
+
+	LOG4CPP_DEBUG( logger, "renderLoop(): Render thread for '" << m_moduleKey << "' stopped" );
+}
+
+
+void VirtualCamera::startModule()
+{
+	if ( !m_moduleKey.m_bHeadless || m_renderThread )
+		return;
+
+	LOG4CPP_DEBUG( logger, "startModule(): Starting headless render thread for '" << m_moduleKey << "'" );
+
+	m_bStopThread = false;
 	m_redraw = 1;
-	LOG4CPP_DEBUG( logger, "invalidate(): Waking up main thread" );
-	g_continue.notify_all();
+	m_renderThread.reset( new boost::thread( boost::bind( &VirtualCamera::renderLoop, this ) ) );
+}
+
+
+void VirtualCamera::stopModule()
+{
+	if ( m_moduleKey.m_bHeadless )
+		stopRenderThread();
+}
+
+
+void VirtualCamera::stopRenderThread()
+{
+	if ( !m_renderThread )
+		return;
+
+	{
+		boost::mutex::scoped_lock l( m_threadMutex );
+		m_bStopThread = true;
+	}
+	m_scheduler.wakeup();
+	m_renderThread->join();
+	m_renderThread.reset();
+}
+
+
+void VirtualCamera::postRedisplay()
+{
+	m_bForceFrame = true;
+	if ( hasOwnThread() )
+	{
+		m_redraw = 1;
+		m_scheduler.wakeup();
+	}
+	else
+		glutPostRedisplay();
+}
+
+
+void VirtualCamera::postReshape( int w, int h )
+{
+	{
+		boost::mutex::scoped_lock l( m_threadMutex );
+		m_bReshapePending = true;
+		m_reshapeWidth = w;
+		m_reshapeHeight = h;
+	}
+	postRedisplay();
+}
+
+
+void VirtualCamera::swapBuffers()
+{
+	if ( hasOwnThread() )
+		m_context->swapBuffers();
+	else
+		glutSwapBuffers();
+}
+
+
+FrameScheduler& VirtualCamera::scheduler()
+{
+	return hasOwnThread() ? m_scheduler : g_scheduler;
+}
+
+
+void VirtualCamera::invalidate( VirtualObject* )
+{
+	m_updateCount++;
+
+	// only the first update after a frame wakes up the render thread,
+	// waiting for further queued updates is left to nextFrameTime()
+	if ( m_redraw.exchange( 1 ) ) return;
+	m_invalidateTime = Measurement::now();
+	LOG4CPP_DEBUG( logger, "invalidate(): Waking up render thread" );
+	scheduler().wakeup();
+}
+
+
+void VirtualCamera::requestFrame()
+{
+	// not an update of the scene, so m_redraw, the update count and the invalidate time are left to invalidate()
+	if ( m_bForceFrame.exchange( true ) ) return;
+	scheduler().wakeup();
+}
+
+
+void VirtualCamera::setHidden( bool bHidden )
+{
+	if ( m_bHidden.exchange( bHidden ) == bHidden )
+		return;
+
+	LOG4CPP_DEBUG( logger, "setHidden(): Window '" << m_moduleKey << "' is " << ( bHidden ? "hidden" : "visible" ) );
+
+	// show the current state right away when the window reappears
+	if ( !bHidden )
+		requestFrame();
+}
+
+
+bool VirtualCamera::hasWaitingEvents()
+{
+	const RenderList& objects = renderList();
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
+		if ( (*i)->hasWaitingEvents() )
+			return true;
+	return false;
+}
+
+
+const VirtualCamera::RenderList& VirtualCamera::renderList()
+{
+	unsigned version = m_componentsVersion;
+	if ( version != m_renderListVersion )
+	{
+		LOG4CPP_DEBUG( logger, "renderList(): Component set of '" << m_moduleKey << "' has changed, rebuilding render list" );
+
+		// already sorted by priority thanks to std::map
+		m_renderList.clear();
+		ComponentList objects = getAllComponents();
+		for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ )
+			if ( !(*i)->bCleanup )
+				m_renderList.push_back( i->get() );
+		m_renderListVersion = version;
+	}
+	return m_renderList;
+}
+
+
+void VirtualCamera::cleanupComponent( VirtualObject* vo )
+{
+	vo->glCleanup();
+	vo->releaseGeometry();
+	vo->bCleanup = true;
+
+	// drop the pointer right away, the component may be destroyed as soon as stop() returns
+	m_renderList.erase( std::remove( m_renderList.begin(), m_renderList.end(), vo ), m_renderList.end() );
+}
+
+
+void VirtualCamera::cleanupGL()
+{
+	if ( !hasOwnThread() )
+		glutSetWindow( m_winHandle );
+
+	m_instances.clear( m_glExtensions );
+	m_textures.clear( m_glState, m_glExtensions );
+	m_gpuTimer.clear( m_glExtensions );
 }
 
 
 /** Cleans up the specified component, blocks until the job has been completed on the GL task */
 void VirtualCamera::cleanup( VirtualObject* vo )
 {
+	if ( hasOwnThread() )
+	{
+		// the window's own render thread owns the context
+		boost::mutex::scoped_lock l( m_threadMutex );
+		if ( !m_bThreadRunning )
+			return;
+
+		m_cleanupComponents.insert( vo );
+		m_scheduler.wakeup();
+		while ( m_cleanupComponents.find( vo ) != m_cleanupComponents.end() )
+			m_cleanupDone.wait( l );
+		return;
+	}
+
 	LOG4CPP_DEBUG( logger, "cleanup(): Lock mutex" );
 
 	// Scoped lock
@@ -376,7 +708,7 @@ void VirtualCamera::cleanup( VirtualObject* vo )
 	LOG4CPP_DEBUG( logger, "cleanup(): Waking up GL thread" );
 
 	// Wake up GL thread and wait until cleanup is done
-	g_continue.notify_all();
+	g_scheduler.wakeup();
 	while ( g_cleanup_components.find( vo ) != g_cleanup_components.end() )
 	{
 		LOG4CPP_DEBUG( logger, "cleanup(): Block until GL context of component has been cleaned up" );
@@ -393,16 +725,46 @@ void VirtualCamera::cleanup( VirtualObject* vo )
 
 void VirtualCamera::redraw( )
 {
-	// TODO: fix stereo view handling
-	// TODO: make minmum fps configureable (currently 2fps)
-	if ((!m_redraw) && (m_stereoRenderPasses == stereoRenderNone && m_lastRedrawTime + 500000000L < Measurement::now()  )) return; 
+	if ( hasOwnThread() ) return;
+	Measurement::Timestamp now = Measurement::now();
+	Measurement::Timestamp next = nextFrameTime( now );
+	if ( next == 0 || next > now ) return;
 	glutSetWindow( m_winHandle );
 	LOG4CPP_TRACE( logger, "redraw(): calling glutPostRedisplay" );
 	glutPostRedisplay();
+	m_bFramePosted = true;
 	m_redraw = 0;
 }
 
 
+Measurement::Timestamp VirtualCamera::nextFrameTime( Measurement::Timestamp now )
+{
+	// nobody sees a hidden window, so updates and refreshes are only drawn at the hidden rate
+	if ( m_bThrottleHidden && m_bHidden )
+		return m_hiddenFrameInterval ? m_lastRedrawTime + m_hiddenFrameInterval : 0;
+
+	// updates from the dataflow and requested frames are drawn as soon as no further updates are queued, 
+	// but not earlier than one frame interval of the maximum frame rate after the previous frame
+	if ( m_redraw || m_bForceFrame )
+	{
+		Measurement::Timestamp next = now;
+		Measurement::Timestamp invalidateTime = m_invalidateTime;
+		if ( invalidateTime && now < invalidateTime + g_maxCoalesceTime && hasWaitingEvents() )
+			next = now + g_coalescePollInterval;
+		if ( m_maxFrameInterval && next < m_lastRedrawTime + m_maxFrameInterval )
+			next = m_lastRedrawTime + m_maxFrameInterval;
+		return next;
+	}
+
+	// frame-sequential stereo alternates the eyes continuously, otherwise only refresh at the minimum rate
+	Measurement::Timestamp interval = m_stereoRenderPasses == stereoRenderSequential ? m_stereoFrameInterval : m_minFrameInterval;
+	if ( interval == 0 )
+		return 0;
+
+	return m_lastRedrawTime + interval;
+}
+
+
 VirtualCamera::VirtualCamera( const VirtualCameraKey& key, boost::shared_ptr< Graph::UTQLSubgraph >, FactoryHelper* pFactory )
 	: Module< VirtualCameraKey, VirtualObjectKey, VirtualCamera, VirtualObject >( key, pFactory )
 	, m_width(key.m_width)
@@ -410,19 +772,60 @@ VirtualCamera::VirtualCamera( const VirtualCameraKey& key, boost::shared_ptr< Gr
 	, m_near(key.m_near)
 	, m_far(key.m_far)
 	, m_winHandle(0)
-	, m_redraw(1)
 	, m_doSync(0)
 	, m_parity(0)
 	, m_info(0)
-	, m_lasttime(0)
 	, m_lastframe(0)
+	, m_redraw(1)
+	, m_lasttime(0)
 	, m_fps(0)
 	, m_lastRedrawTime(0)
+	, m_bOwnThread( key.m_bOwnThread || key.m_bHeadless )
+	, m_scheduler( key )
+	, m_bThreadRunning( false )
+	, m_bStopThread( false )
+	, m_bReshapePending( false )
+	, m_reshapeWidth( 0 )
+	, m_reshapeHeight( 0 )
+	, m_invalidateTime(0)
+	, m_componentsVersion(1)
+	, m_renderListVersion(0)
+	, m_minFrameInterval( key.m_minFps > 0 ? Measurement::Timestamp( 1e9 / key.m_minFps ) : 0 )
+	, m_stereoFrameInterval( key.m_stereoFps > 0 ? Measurement::Timestamp( 1e9 / key.m_stereoFps ) : 0 )
+	, m_maxFrameInterval( key.m_maxFps > 0 ? Measurement::Timestamp( 1e9 / key.m_maxFps ) : 0 )
+	, m_hiddenFrameInterval( key.m_hiddenFps > 0 ? Measurement::Timestamp( 1e9 / key.m_hiddenFps ) : 0 )
+	, m_bThrottleHidden( key.m_hiddenFps >= 0 && !key.m_bHeadless )
+	, m_bHidden( false )
+	, m_updateCount( 0 )
+	, m_frameCount( 0 )
+	, m_hiddenFrameCount( 0 )
+	, m_loggedUpdateCount( 0 )
+	, m_gpuTimer( 4 )
+	, m_bForceFrame( true )
+	, m_bFramePosted( false )
+	, m_presentedListVersion( 0 )
+	, m_skippedFrameCount( 0 )
+	, m_culledObjects( 0 )
+	, m_lastStatsReport(0)
+	, m_frameLatency(0)
 	, m_vsync()
 	, m_stereoRenderPasses( stereoRenderNone )
 {
 	LOG4CPP_DEBUG( logger, "VirtualCamera(): Creating module for module key '" << m_moduleKey << "'...");
 
+	m_textures.setBudget( key.m_textureBudget > 0 ? std::size_t( key.m_textureBudget ) * 1024 : 0 );
+	m_textures.setCompression( key.m_bTextureCompression );
+	m_frustum.setEnabled( key.m_bCulling );
+
+	// headless cameras do not use GLUT at all, their thread is started with the module
+	if ( key.m_bHeadless )
+	{
+		m_context.reset( new HeadlessGLContext( m_width, m_height ) );
+		if ( !m_context->isValid() )
+			UBITRACK_THROW( "Could not create headless OpenGL context, EGL or OSMesa support is required" );
+		return;
+	}
+
 	// lock access to globals
 	boost::mutex::scoped_lock l( g_globalMutex );
 
@@ -430,6 +833,7 @@ VirtualCamera::VirtualCamera( const VirtualCameraKey& key, boost::shared_ptr< Gr
 
 	// schedule the setup function for this window
 	g_setup.push_back( this );
+	g_scheduler.wakeup();
 
 	// if there's no thread yet, init GLUT library first and create a new control thread
 	// Note: this thread must do ALL OpenGL operations for all VirtualCameras!
@@ -449,6 +853,16 @@ VirtualCamera::~VirtualCamera()
 	bool bKillThread = false;
 
 	LOG4CPP_DEBUG( logger, "~VirtualCamera(): Destroying module for module key '" << m_moduleKey << "'...");
+
+	// the texture worker wakes up this camera, it must not outlive it
+	m_textures.stop();
+
+	if ( m_moduleKey.m_bHeadless )
+	{
+		stopRenderThread();
+		LOG4CPP_DEBUG( logger, "~VirtualCamera(): headless module destroyed" );
+		return;
+	}
 	
 	{
 		// lock access to globals and remove the stored this-pointer
@@ -467,9 +881,31 @@ VirtualCamera::~VirtualCamera()
 			
 			g_setup_performed.timed_wait( lock, boost::posix_time::milliseconds(100) );
 		}
-		
+	}
+
+	// the own render thread must release its context before GLUT destroys the window
+	stopRenderThread();
+
+	// otherwise the GLUT thread releases the GL resources of the window while its context still exists
+	if ( !hasOwnThread() )
+	{
+		boost::mutex::scoped_lock lock( g_globalMutex );
+		std::map< int, VirtualCamera* >::iterator it = g_modules.find( m_winHandle );
+		if ( it != g_modules.end() && it->second == this )
+		{
+			g_cleanup_modules.insert( this );
+			g_scheduler.wakeup();
+			while ( g_cleanup_modules.find( this ) != g_cleanup_modules.end() )
+				g_cleanup_done.timed_wait( lock, boost::posix_time::milliseconds( 25 ) );
+		}
+	}
+
+	{
+		boost::mutex::scoped_lock lock( g_globalMutex );
+
 		g_modules[ m_winHandle ] = 0;
 		g_names.erase( m_moduleKey );
+		g_scheduler.wakeup();
 
 		// kill thread if this was the last window
 		if ( g_names.empty() ) {
@@ -523,7 +959,7 @@ void VirtualCamera::keyboard( unsigned char key, int x, int y )
 		else
 			m_lastMousePos = Math::Vector< double, 2 >( double( x ) / m_width, double( y ) / m_height );
 	}
-	glutPostRedisplay();
+	postRedisplay();
 }
 
 
@@ -544,6 +980,11 @@ Math::Vector< double, 2 > VirtualCamera::getLastMousePos() {
 void VirtualCamera::display()
 {
 	m_lastRedrawTime = Measurement::now();
+	Measurement::Timestamp invalidateTime = m_invalidateTime.exchange( 0 );
+
+	FrameTiming& timing = m_frameTiming;
+	timing.drawStart = m_lastRedrawTime;
+	timing.measurementTimes.clear();
 
 	// get frame counters and parity
 	int parity = 0;
@@ -555,36 +996,68 @@ void VirtualCamera::display()
 		parity = (retrace%2 == m_parity); // Nick: This seems to be broken on linux
 	}
 
+	// take a snapshot of the pushed inputs of all components, so they are drawn as of the same instant
+	const RenderList& objects = renderList();
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
+		(*i)->latchInputs();
+	timing.measurementTimes.reserve( objects.size() );
+
+	// neither draw nor swap if the frame would look like the one on the screen
+	if ( isFrameUnchanged( objects ) )
+	{
+		LOG4CPP_TRACE( logger, "display(): Nothing has changed, skipping frame" );
+		m_skippedFrameCount++;
+		reportStatistics( m_lastRedrawTime );
+		return;
+	}
+
+	// GPU time of the frame, the result is fetched a few frames later
+	m_gpuTimer.begin( m_glExtensions );
+
+	// textures that have been decoded in the background, within the upload budget of a frame
+	m_textures.update( m_glState, m_glExtensions );
+
 	// predict a little bit (only for pull inputs)
 	Measurement::Timestamp imageTime( Measurement::now() + 5000000L );
+	timing.imageTime = imageTime;
 
 	// clear buffers
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	m_glState.colorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-	// create a perspective projection matrix
-	glMatrixMode( GL_PROJECTION );
-	glLoadIdentity();
-	gluPerspective( m_moduleKey.m_fov, ((double)m_width/(double)m_height), m_moduleKey.m_near, m_moduleKey.m_far );
+	// create a perspective projection matrix, as gluPerspective() does
+	double perspective[ 16 ] = { 0 };
+	double f = 1.0 / tan( m_moduleKey.m_fov * 3.14159265358979323846 / 360.0 );
+	double nearFar = m_moduleKey.m_near - m_moduleKey.m_far;
+	perspective[ 0 ] = f * m_height / m_width;
+	perspective[ 5 ] = f;
+	perspective[ 10 ] = ( m_moduleKey.m_far + m_moduleKey.m_near ) / nearFar;
+	perspective[ 11 ] = -1.0;
+	perspective[ 14 ] = 2.0 * m_moduleKey.m_far * m_moduleKey.m_near / nearFar;
+	loadProjection( perspective );
+	m_frustum.setViewportHeight( m_height );
 
 	// clear model-view transformation
-	glMatrixMode( GL_MODELVIEW );
-	glLoadIdentity();
+	loadModelView( g_identity );
 
 	// calculate fps
-	int curtime = glutGet( GLUT_ELAPSED_TIME );
-	if ((curtime - m_lasttime) >= 1000) {
-		m_fps = (1000.0*(curframe-m_lastframe))/((double)(curtime-m_lasttime));
+	Measurement::Timestamp curtime = Measurement::now();
+	if ((curtime - m_lasttime) >= 1000000000LL) {
+		m_fps = (1e9*(curframe-m_lastframe))/((double)(curtime-m_lasttime));
 		m_lasttime  = curtime;
 		m_lastframe = curframe;
 	}
 
 	LOG4CPP_TRACE( logger, "display(): Redrawing.." );
 
-	// iterate over all components (already sorted by priority thanks to std::map)
-	ComponentList objects = getAllComponents();
-	for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ )
+	// iterate over all components (already sorted by priority)
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
 	{
+		// queued instances are drawn before anything that may depend on them, e.g. their depth
+		if ( !(*i)->queuesInstances() )
+			m_instances.flush( m_glState, m_glExtensions, m_textures );
+
+		Measurement::Timestamp drawStart = Measurement::now();
 		try
 		{
 			(*i)->draw( imageTime, parity ); // Parity = 0 if not frame sequential
@@ -593,18 +1066,28 @@ void VirtualCamera::display()
 		{
 			LOG4CPP_NOTICE( loggerEvents, "display(): Exception in main loop from component " << (*i)->getName() << ": " << e );
 		}
+		(*i)->drawStatistics().add( Measurement::now() - drawStart );
+
+		// measurements older than a second are not shown by tracked objects
+		Measurement::Timestamp measurementTime = (*i)->getTime();
+		if ( measurementTime && timing.drawStart < measurementTime + 1000000000LL )
+			timing.measurementTimes.push_back( measurementTime );
 	}
+	m_instances.flush( m_glState, m_glExtensions, m_textures );
 
 	if ( m_stereoRenderPasses == stereoRenderSingle ) 
 	{
 		// 2nd rendering pass for stereo separation when both eyes are to be rendered into a single image
 		// Only makes sense with color mask stereo separation.
 		glClear( GL_DEPTH_BUFFER_BIT ); // Let color buffer intact, only clear depth information.
-		glMatrixMode( GL_MODELVIEW );
-		glLoadIdentity(); // Reset transformation stack.
+		loadModelView( g_identity ); // Reset transformation stack.
 
-		for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ )
+		for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
 		{
+			if ( !(*i)->queuesInstances() )
+				m_instances.flush( m_glState, m_glExtensions, m_textures );
+
+			Measurement::Timestamp drawStart = Measurement::now();
 			try
 			{        
 				(*i)->draw( imageTime, 1 ); // Parity = 1
@@ -613,11 +1096,13 @@ void VirtualCamera::display()
 			{
 				LOG4CPP_NOTICE( loggerEvents, "display(): Exception in main loop from component " << (*i)->getName() << ": " << e );
 			}
+			(*i)->drawStatistics().add( Measurement::now() - drawStart );
 		}
+		m_instances.flush( m_glState, m_glExtensions, m_textures );
 	}
 
-	// print info string
-	if (m_info) {
+	// print info string, the GLUT font is not available to headless cameras
+	if ( m_info && !m_moduleKey.m_bHeadless ) {
   
 		std::ostringstream text;
 		text << std::fixed << std::showpoint << std::setprecision(2);
@@ -630,13 +1115,9 @@ void VirtualCamera::display()
 		glPushMatrix();
 		glLoadIdentity();
 		gluOrtho2D( 0, m_width, 0, m_height );
-		glDisable( GL_LIGHTING );
-
-		GLfloat xzoom, yzoom;
-		glGetFloatv( GL_ZOOM_X, &xzoom );
-		glGetFloatv( GL_ZOOM_Y, &yzoom );
-
-		glPixelZoom( 1.0, 1.0 );
+		m_glState.push();
+		m_glState.disable( GL_LIGHTING );
+		m_glState.pixelZoom( 1.0, 1.0 );
 
 		glColor4f( 1.0, 0.0, 0.0, 1.0 );
 		glRasterPos2i( 10, m_height-23 );
@@ -644,18 +1125,186 @@ void VirtualCamera::display()
 		for ( unsigned int i = 0; i < text.str().length(); i++ )
 			glutBitmapCharacter( GLUT_BITMAP_8_BY_13, text.str()[i] );
 
-		glPixelZoom( xzoom, yzoom );
-
+		m_glState.pop();
 		glPopMatrix();
-		glEnable( GL_LIGHTING );
 	}
 
+	timing.drawEnd = Measurement::now();
+	m_gpuTimer.end( m_glExtensions );
+
+	m_frustum.frameDone();
+	m_culledObjects = m_frustum.culledLastFrame();
+
 	// wait for the screen refresh
 	m_vsync.wait( m_doSync );
 	
 	// put current buffer into display
 	LOG4CPP_TRACE( logger, "display(): Swapping buffers.." );
-	glutSwapBuffers();
+	swapBuffers();
+	timing.swapEnd = Measurement::now();
+
+	// cost of a frame, which tells how much the governor saves by not drawing
+	m_frameCount++;
+	if ( m_bHidden )
+		m_hiddenFrameCount++;
+	m_cpuFrameTime.add( timing.drawEnd - timing.drawStart );
+	Measurement::Timestamp gpuTime;
+	if ( m_gpuTimer.result( m_glExtensions, gpuTime ) )
+		m_gpuFrameTime.add( gpuTime );
+
+	// used by tracked objects to predict their poses for the next frame
+	Measurement::Timestamp frameLatency = timing.swapEnd - timing.drawStart;
+	m_frameLatency = m_frameLatency ? ( 7 * m_frameLatency + frameLatency ) / 8 : frameLatency;
+
+	// age of the shown measurements when the frame reaches the screen
+	for ( std::vector< Measurement::Timestamp >::iterator it = timing.measurementTimes.begin(); it != timing.measurementTimes.end(); it++ )
+		if ( timing.swapEnd > *it )
+			m_poseAgeStatistics.add( timing.swapEnd - *it );
+
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
+		(*i)->frameDone( timing );
+
+	// statistics on the time from the first update to the finished frame
+	if ( invalidateTime && timing.swapEnd > invalidateTime )
+		m_drawLatency.add( timing.swapEnd - invalidateTime );
+	reportStatistics( timing.swapEnd );
+}
+
+
+bool VirtualCamera::isFrameUnchanged( const RenderList& objects )
+{
+	// always draw when requested by the window system, after changes of the component set, 
+	// for the frame rate display and when frame-sequential stereo alternates the eyes
+	bool bFramePosted = m_bFramePosted;
+	m_bFramePosted = false;
+	bool bChanged = m_bForceFrame.exchange( false ) || ( !hasOwnThread() && !bFramePosted ) || 
+		m_info || m_stereoRenderPasses == stereoRenderSequential || m_renderListVersion != m_presentedListVersion;
+
+	m_frameGenerations.resize( objects.size() );
+	for ( std::size_t i = 0; i < objects.size(); i++ )
+	{
+		m_frameGenerations[ i ] = objects[ i ]->generation();
+		if ( m_frameGenerations[ i ] == VirtualObject::generationAlwaysChanged )
+			bChanged = true;
+	}
+
+	if ( !bChanged && m_frameGenerations == m_presentedGenerations )
+		return true;
+
+	m_presentedGenerations.swap( m_frameGenerations );
+	m_presentedListVersion = m_renderListVersion;
+	return false;
+}
+
+
+void VirtualCamera::reportStatistics( Measurement::Timestamp now )
+{
+	if ( m_lastStatsReport == 0 )
+		m_lastStatsReport = now;
+	if ( now <= m_lastStatsReport + g_statsInterval )
+		return;
+
+	LOG4CPP_INFO( loggerStats, std::fixed << std::setprecision( 3 ) << m_moduleKey << ": update-to-frame latency "
+		<< m_drawLatency.meanMs() << " ms mean, " << m_drawLatency.maxMs() << " ms max (" << m_drawLatency.count() << " frames)" );
+	m_drawLatency.reset();
+	m_lastStatsReport = now;
+
+	// every update would have been a frame of its own without coalescing, rate limit and throttling
+	unsigned long updateCount = m_updateCount;
+	unsigned long updates = updateCount - m_loggedUpdateCount;
+	unsigned long saved = updates > m_frameCount ? updates - m_frameCount : 0;
+	std::ostringstream governor;
+	governor << std::fixed << std::setprecision( 1 ) << m_moduleKey << ": " << updates << " updates drawn in " 
+		<< m_frameCount << " frames (" << m_hiddenFrameCount << " while hidden), " << m_skippedFrameCount 
+		<< " unchanged frames skipped, " << saved << " frames saved, about " << saved * m_cpuFrameTime.meanMs() << " ms CPU";
+	if ( m_gpuFrameTime.count() )
+		governor << " and " << saved * m_gpuFrameTime.meanMs() << " ms GPU";
+	LOG4CPP_INFO( loggerStats, governor.str() );
+	m_loggedUpdateCount = updateCount;
+	unsigned long frames = m_frameCount;
+	m_frameCount = 0;
+	m_hiddenFrameCount = 0;
+	m_skippedFrameCount = 0;
+	m_cpuFrameTime.reset();
+	m_gpuFrameTime.reset();
+
+	DrawStatistics::Snapshot poseAge = m_poseAgeStatistics.snapshot( true );
+	LOG4CPP_INFO( loggerStats, m_moduleKey << ": measurement age at swap: " << ( poseAge - m_loggedPoseAge ).toString() );
+	m_loggedPoseAge = poseAge;
+
+	// redundant state changes filtered out by the state cache
+	if ( frames )
+		LOG4CPP_INFO( loggerStats, std::fixed << std::setprecision( 1 ) << m_moduleKey << ": GL state calls per frame: " 
+			<< double( m_glState.issuedCalls() ) / frames << " made, " << double( m_glState.avoidedCalls() ) / frames 
+			<< " avoided, " << double( m_glState.queries() ) / frames << " queries" );
+	m_glState.resetCounters();
+
+	// tracked objects drawn together with others of the same model
+	unsigned long instancedCalls, instances;
+	m_instances.counters( instancedCalls, instances );
+	if ( frames && instances )
+		LOG4CPP_INFO( loggerStats, std::fixed << std::setprecision( 1 ) << m_moduleKey << ": instanced draw calls per frame: " 
+			<< double( instancedCalls ) / frames << " for " << double( instances ) / frames << " objects" );
+
+	// tracked objects outside the view frustum
+	unsigned long tested, culled;
+	m_frustum.counters( tested, culled );
+	if ( frames && tested )
+		LOG4CPP_INFO( loggerStats, std::fixed << std::setprecision( 1 ) << m_moduleKey << ": objects culled per frame: " 
+			<< double( culled ) / frames << " of " << double( tested ) / frames << " tested" );
+
+	// draw times of the components since the last report
+	const RenderList& objects = renderList();
+	for ( RenderList::const_iterator i = objects.begin(); i != objects.end(); i++ )
+	{
+		DrawStatistics::Snapshot current = (*i)->drawStatistics().snapshot( true );
+		LOG4CPP_INFO( loggerStats, m_moduleKey << ": draw() of " << (*i)->getName() << ": " 
+			<< ( current - (*i)->m_loggedDrawStatistics ).toString() );
+		(*i)->m_loggedDrawStatistics = current;
+	}
+}
+
+
+std::map< std::string, DrawStatistics::Snapshot > VirtualCamera::getDrawStatistics()
+{
+	std::map< std::string, DrawStatistics::Snapshot > result;
+	ComponentList objects = getAllComponents();
+	for ( ComponentList::iterator i = objects.begin(); i != objects.end(); i++ )
+		result[ (*i)->getName() ] = (*i)->drawStatistics().snapshot();
+	return result;
+}
+
+
+void VirtualCamera::loadProjection( const double* m )
+{
+	glMatrixMode( GL_PROJECTION );
+	glLoadMatrixd( m );
+	glMatrixMode( GL_MODELVIEW );
+	m_frustum.setProjection( m );
+}
+
+
+void VirtualCamera::multProjection( const double* m )
+{
+	double product[ 16 ];
+	multMatrix( m_frustum.projection(), m, product );
+	loadProjection( product );
+}
+
+
+void VirtualCamera::loadModelView( const double* m )
+{
+	glMatrixMode( GL_MODELVIEW );
+	glLoadMatrixd( m );
+	m_frustum.setModelView( m );
+}
+
+
+void VirtualCamera::multModelView( const double* m )
+{
+	double product[ 16 ];
+	multMatrix( m_frustum.modelView(), m, product );
+	loadModelView( product );
 }
 
 
@@ -671,7 +1320,7 @@ void VirtualCamera::reshape( int w, int h )
 	glViewport( 0, 0, m_width, m_height );
 
 	// invalidate display
-	glutPostRedisplay();
+	postRedisplay();
 }
 
 
@@ -714,6 +1363,8 @@ boost::shared_ptr< VirtualObject > VirtualCamera::createComponent( const std::st
 		return boost::shared_ptr< VirtualObject >( new StereoRendering( name, pConfig, key, pModule ) );
 	else if ( type == "Cross2D" )
 		return boost::shared_ptr< VirtualObject >( new Cross2D( name, pConfig, key, pModule ) );
+	else if ( type == "LatencyOutput" )
+		return boost::shared_ptr< VirtualObject >( new LatencyOutput( name, pConfig, key, pModule ) );
 
 	#ifdef HAVE_OPENCV
 	else if ( type == "ImageOutput" )
@@ -763,6 +1414,7 @@ UBITRACK_REGISTER_COMPONENT( ComponentFactory* const cf )
 	renderComponents.push_back( "StereoSeparation" );
 	renderComponents.push_back( "StereoRendering" );
 	renderComponents.push_back( "Cross2D" );
+	renderComponents.push_back( "LatencyOutput" );
 	#ifdef HAVE_OPENCV
 		renderComponents.push_back( "ImageOutput" );
 		renderComponents.push_back( "ZBufferOutput" );
@@ -89,10 +89,14 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include <cstdlib>
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
 
 #include <log4cpp/Category.hh>
 
@@ -105,6 +109,17 @@
 #include <utMath/Matrix.h>
 
 #include "VideoSync.h"
+#include "FrameScheduler.h"
+#include "GLContext.h"
+#include "GpuTimer.h"
+#include "GLStateCache.h"
+#include "GLGeometry.h"
+#include "TextureManager.h"
+#include "X3DAssets.h"
+#include "InstanceRenderer.h"
+#include "Frustum.h"
+#include "DrawStatistics.h"
+#include "FrameValue.h"
 
 
 
@@ -140,6 +155,16 @@ public:
 		, m_bFullscreen( false )
 		, m_monitorPoint( Math::Vector< int, 2 >( 0, 0 ) )
 		, m_bEnableStencil( false )
+		, m_bOwnThread( false )
+		, m_bHeadless( false )
+		, m_minFps( 2.0 )
+		, m_stereoFps( 120.0 )
+		, m_maxFps( 0.0 )
+		, m_hiddenFps( 1.0 )
+		, m_textureBudget( 4096 )
+		, m_bTextureCompression( true )
+		, m_bInstancing( true )
+		, m_bCulling( true )
 	{
 		// some sane defaults
 		m_fov  = 30;
@@ -162,6 +187,16 @@ public:
 			cameraNode->getAttributeData( "virtualCameraMonitorX", m_monitorPoint( 0 ) );
 			cameraNode->getAttributeData( "virtualCameraMonitorY", m_monitorPoint( 1 ) );
 			m_sGameMode = cameraNode->getAttributeString( "virtualCameraGameMode" );
+			m_bOwnThread = cameraNode->getAttributeString( "virtualCameraOwnThread" ) == "true";
+			m_bHeadless = cameraNode->getAttributeString( "virtualCameraHeadless" ) == "true";
+			cameraNode->getAttributeData( "virtualCameraMinFps", m_minFps );
+			cameraNode->getAttributeData( "virtualCameraStereoFps", m_stereoFps );
+			cameraNode->getAttributeData( "virtualCameraMaxFps", m_maxFps );
+			cameraNode->getAttributeData( "virtualCameraHiddenFps", m_hiddenFps );
+			cameraNode->getAttributeData( "virtualCameraTextureBudget", m_textureBudget );
+			m_bTextureCompression = cameraNode->getAttributeString( "virtualCameraTextureCompression" ) != "false";
+			m_bInstancing = cameraNode->getAttributeString( "virtualCameraInstancing" ) != "false";
+			m_bCulling = cameraNode->getAttributeString( "virtualCameraCulling" ) != "false";
 			
 			// normally handlede by stereorendering, but we need it at module initialization
 			m_bEnableStencil = cameraNode->getAttributeString( "stereoType" ) == "lineSequential";
@@ -177,6 +212,36 @@ public:
 	std::string m_sGameMode;
 	
 	bool m_bEnableStencil;
+
+	/** render in a dedicated thread with its own GL context instead of the shared GLUT thread */
+	bool m_bOwnThread;
+
+	/** render offscreen without any window, implies an own render thread */
+	bool m_bHeadless;
+
+	/** frame rate at which the window is refreshed without any updates, 0 to disable */
+	double m_minFps;
+
+	/** frame rate for frame-sequential stereo, which needs continuous redraws */
+	double m_stereoFps;
+
+	/** upper limit of the frame rate, updates arriving faster are drawn together. 0 for no limit */
+	double m_maxFps;
+
+	/** frame rate while the window is hidden or iconified, 0 to stop drawing, negative to draw as if visible */
+	double m_hiddenFps;
+
+	/** kilobytes of texture data uploaded per frame, 0 for no limit */
+	int m_textureBudget;
+
+	/** compress textures to S3TC and cache them on disk */
+	bool m_bTextureCompression;
+
+	/** draw tracked objects that share a model with instanced draw calls */
+	bool m_bInstancing;
+
+	/** skip tracked objects outside the view frustum */
+	bool m_bCulling;
 };
 
 
@@ -215,6 +280,7 @@ class VirtualObjectKey
 			if ( dfclass == "ImageOutput"      ) m_priority = 200;
 			if ( dfclass == "ButtonOutput"     ) m_priority = 200;
 			if ( dfclass == "ZBufferOutput"    ) m_priority = 200;
+			if ( dfclass == "LatencyOutput"    ) m_priority = 200;
 		}
 
 		// compare priorities first, then string contents
@@ -230,6 +296,25 @@ class VirtualObjectKey
 };
 
 
+/**
+ * @ingroup driver_components
+ * Timing of one rendered frame, passed to the components after the buffer swap.
+ */
+struct FrameTiming
+{
+	/** the time the frame was rendered for, as passed to VirtualObject::draw() */
+	Measurement::Timestamp imageTime;
+
+	/** start and end of drawing the components, return from the buffer swap */
+	Measurement::Timestamp drawStart;
+	Measurement::Timestamp drawEnd;
+	Measurement::Timestamp swapEnd;
+
+	/** timestamps of the measurements shown in the frame, one per component that showed one */
+	std::vector< Measurement::Timestamp > measurementTimes;
+};
+
+
 /**
  * @ingroup driver_components
  * Module for virtual OpenGL camera.
@@ -265,17 +350,136 @@ public:
 	/** GLUT display callback */
 	void display();
 
-	/** callback from the VirtualObjects if world has changed */
+	/** request a new frame, may be called from any thread */
+	void postRedisplay();
+
+	/** GLUT reshape callback of windows with their own render thread, applied by that thread */
+	void postReshape( int w, int h );
+
+	/** true if the camera renders into an offscreen context without GLUT */
+	bool isHeadless() const
+	{ return m_moduleKey.m_bHeadless; }
+
+	/** true if the window is drawn by its own render thread, may be called from any thread */
+	bool hasOwnThread() const
+	{ return m_bOwnThread; }
+
+	/** extension entry points of the context, valid after GL initialization */
+	const GLExtensions& glExtensions() const
+	{ return m_glExtensions; }
+
+	/** shadowed GL state of the context, used by components to change state. Render thread only. */
+	GLStateCache& glState()
+	{ return m_glState; }
+
+	/** textures of the context, loaded in the background. Render thread only. */
+	TextureManager& textures()
+	{ return m_textures; }
+
+	/** GL resources of the X3D scenes drawn in the context. Render thread only. */
+	X3DContextAssets& x3dAssets()
+	{ return m_x3dAssets; }
+
+	/** instanced drawing of tracked objects that share a scene. Render thread only. */
+	InstanceRenderer& instances()
+	{ return m_instances; }
+
+	/** framebuffer object the window is drawn into, 0 for the default framebuffer. Render thread only. */
+	GLuint framebuffer() const
+	{ return m_context ? m_context->framebuffer() : 0; }
+
+	/** view frustum of the current pass, used by tracked objects to skip drawing. Render thread only. */
+	Frustum& frustum()
+	{ return m_frustum; }
+
+	/** 
+	 * replaces the projection matrix (column-major) of the following components and records it for the 
+	 * frustum. Components that set the projection or the view must use these methods. Render thread only.
+	 */
+	void loadProjection( const double* m );
+
+	/** multiplies the projection matrix from the right, e.g. by a stereo offset. Render thread only. */
+	void multProjection( const double* m );
+
+	/** replaces the model-view matrix of the following components and records it. Render thread only. */
+	void loadModelView( const double* m );
+
+	/** multiplies the model-view matrix from the right, e.g. by the inverse camera pose. Render thread only. */
+	void multModelView( const double* m );
+
+	/** number of tracked objects skipped by frustum culling in the last frame. May be called from any thread. */
+	unsigned long culledObjects() const
+	{ return m_culledObjects; }
+
+	/**
+	 * Draw time statistics of all components since they were created, by component name.
+	 * May be called from any thread, the interval of the periodic report is not affected.
+	 */
+	std::map< std::string, DrawStatistics::Snapshot > getDrawStatistics();
+
+	/**
+	 * Distribution of the age of the shown measurements at buffer swap since the window was created.
+	 * May be called from any thread.
+	 */
+	DrawStatistics::Snapshot getPoseAgeStatistics()
+	{ return m_poseAgeStatistics.snapshot(); }
+
+	/** start of the frame that is currently drawn, called from the thread that renders the window */
+	Measurement::Timestamp frameStartTime() const
+	{ return m_lastRedrawTime; }
+
+	/** 
+	 * Smoothed time from the start of drawing until the buffer swap returned, in nanoseconds.
+	 * Called from the thread that renders the window.
+	 */
+	Measurement::Timestamp frameLatency() const
+	{ return m_frameLatency; }
+
+	/** starts the render thread of headless cameras */
+	virtual void startModule();
+
+	/** stops the render thread of headless cameras */
+	virtual void stopModule();
+
+	/** called when a component is started, the render list is rebuilt before the next frame. May be called from any thread. */
+	void componentsChanged()
+	{ m_componentsVersion++; }
+
+	/** called by GLUT when the window is hidden, iconified or shown again */
+	void setHidden( bool bHidden );
+
+	/** callback from the VirtualObjects if world has changed. Lock-free, may be called from any thread. */
 	void invalidate( VirtualObject* caller = 0 );
 
+	/** draws the next frame even if no component has changed, e.g. when a texture has arrived. May be called from any thread. */
+	void requestFrame();
+
 	/** setup for GL context, called from main GL thread _only_ */
 	int setup();
 
+	/** initializes GL state and components, called from the thread that renders the window */
+	void initGL();
+
 	/** cleanup GL context, called from main GL thread _only_ */
 	void cleanup( VirtualObject* vo );
 
+	/** GL cleanup of a stopped component, called from the thread that renders the window */
+	void cleanupComponent( VirtualObject* vo );
+
+	/** releases the textures, instancing buffers and timer queries of the window, called from the thread that renders it */
+	void cleanupGL();
+
 	/** redraw GL context, called from main GL thread _only_ */
 	void redraw();
+
+	/**
+	 * Time at which the window needs its next frame, called from main GL thread _only_.
+	 * @param now the current time
+	 * A pending update is postponed for a few milliseconds while components still have queued events,
+	 * and until the frame interval of the maximum frame rate has passed. Hidden windows are throttled.
+	 * @return a time not after \p now if a frame is due, 0 if no frame is scheduled at all
+	 */
+	Measurement::Timestamp nextFrameTime( Measurement::Timestamp now );
 	
 	/** create new components. Necessary to support multiple component types. */
 	boost::shared_ptr< VirtualObject > createComponent( const std::string& type, const std::string& name, 
@@ -295,12 +499,141 @@ public:
 
 protected:
 
-	int m_winHandle, m_redraw, m_doSync, m_parity, m_info, m_lasttime, m_lastframe;
+	int m_winHandle, m_doSync, m_parity, m_info, m_lastframe;
+
+	/** set by invalidate() from the dataflow threads, reset when the frame is drawn */
+	boost::atomic< int > m_redraw;
 	unsigned char m_lastKey;
 	Math::Vector< double, 2 > m_lastMousePos;
+	Measurement::Timestamp m_lasttime;
 	double m_fps;
 	Measurement::Timestamp m_lastRedrawTime;
 
+	/** main loop of the render thread of this window */
+	void renderLoop();
+
+	/** stops the render thread of this window and waits for it to finish */
+	void stopRenderThread();
+
+	/** presents the frame using GLUT or the own context */
+	void swapBuffers();
+
+	/** the scheduler that wakes up the thread rendering this window */
+	FrameScheduler& scheduler();
+
+	/** 
+	 * set from the configuration when the module is created, as the dataflow threads read it. Only cleared by setup() 
+	 * if no context could be created for the render thread, before the window is drawn for the first time.
+	 */
+	boost::atomic< bool > m_bOwnThread;
+
+	/** context and thread if the window is rendered by its own thread */
+	boost::scoped_ptr< GLContext > m_context;
+	boost::scoped_ptr< boost::thread > m_renderThread;
+	FrameScheduler m_scheduler;
+	GLExtensions m_glExtensions;
+	GLStateCache m_glState;
+
+	X3DContextAssets m_x3dAssets;
+	InstanceRenderer m_instances;
+	Frustum m_frustum;
+
+	/** destroyed first, so its worker thread stops before anything it wakes up */
+	TextureManager m_textures;
+
+	/** protects the following members, which are handed to the render thread */
+	boost::mutex m_threadMutex;
+	boost::condition m_cleanupDone;
+	std::set< VirtualObject* > m_cleanupComponents;
+	bool m_bThreadRunning;
+	bool m_bStopThread;
+	bool m_bReshapePending;
+	int m_reshapeWidth, m_reshapeHeight;
+
+	/** time of the first invalidate() since the last frame, 0 if none */
+	boost::atomic< Measurement::Timestamp > m_invalidateTime;
+
+	/** true if any component has queued events */
+	bool hasWaitingEvents();
+
+	typedef std::vector< VirtualObject* > RenderList;
+
+	/**
+	 * The components to draw, sorted by priority. Only rebuilt when the component set has changed,
+	 * so frames iterate it without allocations. Used by the thread that renders the window only.
+	 */
+	const RenderList& renderList();
+
+	/** render list and the version of the component set it was built from */
+	RenderList m_renderList;
+	boost::atomic< unsigned > m_componentsVersion;
+	unsigned m_renderListVersion;
+
+	/** intervals derived from the minimum, stereo and maximum frame rates, 0 if disabled */
+	Measurement::Timestamp m_minFrameInterval;
+	Measurement::Timestamp m_stereoFrameInterval;
+	Measurement::Timestamp m_maxFrameInterval;
+
+	/** frame interval while hidden, 0 to stop drawing. Only used if m_bThrottleHidden is set */
+	Measurement::Timestamp m_hiddenFrameInterval;
+	bool m_bThrottleHidden;
+
+	/** set from the GLUT thread while the window is not visible */
+	boost::atomic< bool > m_bHidden;
+
+	/** number of invalidate() calls, each of which would have caused a frame without the governor */
+	boost::atomic< unsigned long > m_updateCount;
+
+	/** frames drawn, frames drawn while hidden and updates counted at the last statistics output */
+	unsigned long m_frameCount;
+	unsigned long m_hiddenFrameCount;
+	unsigned long m_loggedUpdateCount;
+
+	/** CPU time from the start of drawing until the swap is issued, and GPU time of the frames */
+	LatencyStatistics m_cpuFrameTime;
+	LatencyStatistics m_gpuFrameTime;
+	GpuTimer m_gpuTimer;
+
+	/** set by postRedisplay() and requestFrame(), the next frame is drawn even if no component has changed */
+	boost::atomic< bool > m_bForceFrame;
+
+	/** set by redraw() when it posts a frame, a display() from GLUT without it repaints an exposed window */
+	bool m_bFramePosted;
+
+	/** generations of the components in the current and in the last presented frame, and the render list of the latter */
+	std::vector< unsigned long > m_frameGenerations;
+	std::vector< unsigned long > m_presentedGenerations;
+	unsigned m_presentedListVersion;
+
+	/** timing of the frame being drawn, kept across frames so its measurement list is not reallocated */
+	FrameTiming m_frameTiming;
+
+	/** frames that were not drawn because nothing has changed, since the last statistics output */
+	unsigned long m_skippedFrameCount;
+
+	/** tracked objects culled in the last frame, see culledObjects() */
+	boost::atomic< unsigned long > m_culledObjects;
+
+	/** 
+	 * true if the frame would look the same as the last presented one, called by display() after latching the inputs
+	 * @return false if any component generation has changed or the frame must be drawn for other reasons
+	 */
+	bool isFrameUnchanged( const RenderList& objects );
+
+	/** writes the statistics of the window to the log every few seconds, called by display() */
+	void reportStatistics( Measurement::Timestamp now );
+
+	/** time from the first invalidate() until the frame is drawn */
+	LatencyStatistics m_drawLatency;
+
+	/** age of the shown measurements at buffer swap */
+	DrawStatistics m_poseAgeStatistics;
+	DrawStatistics::Snapshot m_loggedPoseAge;
+	Measurement::Timestamp m_lastStatsReport;
+
+	/** smoothed time from the start of drawing until the buffer swap returned */
+	Measurement::Timestamp m_frameLatency;
+
 	VideoSync m_vsync;
 	
 	StereoRenderPasses m_stereoRenderPasses;
@@ -334,11 +667,22 @@ public:
 			m_stereoEye = subgraph->getNode( "ImagePlane" )->getAttributeString( "stereoEye" ) == "left" ? stereoEyeLeft : stereoEyeRight;
 
 		bCleanup = false;
+		m_lastUpdateTime = 0;
+	}
+
+	virtual void start()
+	{
+		VirtualCamera::Component::start();
+
+		// make sure the component is drawn
+		bCleanup = false;
+		getModule().componentsChanged();
 	}
 
 	virtual void stop()
 	{
 		// Trigger the GL cleanup first. This blocks until actions have been performed on behalf of the GL task.
+		// This also removes the component from the render list.
 		getModule().cleanup( this );
 		
 		// Then invoke stop() in superclass
@@ -357,6 +701,41 @@ public:
 	virtual void draw( Measurement::Timestamp& t, int parity )
 	{}
 
+	/**
+	 * true if draw() only queues instances for the InstanceRenderer of the module.
+	 * The window flushes them before it draws the next component that does not.
+	 */
+	virtual bool queuesInstances()
+	{ return false; }
+
+	/** called after the buffer swap of every frame */
+	virtual void frameDone( const FrameTiming& timing )
+	{}
+
+	/** freezes the pushed inputs for the next frame, called by the render thread before any draw() */
+	virtual void latchInputs()
+	{ m_frameInputs.latch(); }
+
+	/** returned by generation() if the output of draw() may change in any frame */
+	static const unsigned long generationAlwaysChanged = ~0UL;
+
+	/**
+	 * Change generation of what draw() shows, called by the render thread after latchInputs().
+	 * The value must grow whenever the output of draw() changes. The window skips frames in which
+	 * the generations of all components are the same as in the last presented frame.
+	 * The default disables skipping, as is needed for pull inputs and components that produce output.
+	 */
+	virtual unsigned long generation()
+	{ return generationAlwaysChanged; }
+
+	/** deletes the buffers of all meshes drawn with drawGeometry(), called on the GL thread after glCleanup() */
+	void releaseGeometry()
+	{
+		for ( std::vector< GLGeometry* >::iterator i = m_geometries.begin(); i != m_geometries.end(); i++ )
+			(*i)->release( m_pModule->glExtensions() );
+		m_geometries.clear();
+	}
+
 	/** check if there are events waiting for this component */
 	virtual bool hasWaitingEvents( )
 	{
@@ -366,6 +745,13 @@ public:
 	Measurement::Timestamp getTime()
 	{ return m_lastUpdateTime; }
 
+	/** wall time of draw(), measured by VirtualCamera::display() */
+	DrawStatistics& drawStatistics()
+	{ return m_drawStatistics; }
+
+	/** draw time counters at the last periodic log output, used by the render thread only */
+	DrawStatistics::Snapshot m_loggedDrawStatistics;
+
 protected:
 
 	/** stereo configuration. Some objects only want to be drawn on one side */
@@ -373,7 +759,33 @@ protected:
 	
 	Measurement::Timestamp m_lastUpdateTime;
 
+	DrawStatistics m_drawStatistics;
+
+	/** the FrameValue members of the component */
+	FrameInputs m_frameInputs;
+
+	/**
+	 * Draws a mesh of the component, usually a member that is built in glInit().
+	 * Its buffers are released automatically when the component is cleaned up.
+	 */
+	void drawGeometry( GLGeometry& geometry )
+	{ drawGeometry( geometry, 0, geometry.size() ); }
+
+	/** draws count indices of a mesh starting at first */
+	void drawGeometry( GLGeometry& geometry, unsigned first, unsigned count )
+	{
+		if ( !geometry.isResident() )
+			m_geometries.push_back( &geometry );
+		geometry.draw( m_pModule->glExtensions(), first, count );
+	}
+
+	/** meshes with buffers on the GPU */
+	std::vector< GLGeometry* > m_geometries;
+
+	/** set on the GL thread after glCleanup(), until the component is started again */
 	bool bCleanup;
+
+	friend class VirtualCamera;
 };
 
 } } // namespace Ubitrack::Drivers
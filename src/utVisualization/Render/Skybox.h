@@ -25,6 +25,7 @@
 #define __Skybox_h_INCLUDED__
 
 #include "RenderModule.h"
+#include "FrameValue.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -63,88 +64,84 @@ public:
 	Skybox( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 		: VirtualObject( name, subgraph, componentKey, pModule )
-		, m_push ( "PushInput", *this, boost::bind( &Skybox::poseIn, this, _1, 1 ))
-		, m_pull ( "PullInput", *this ){
+		, m_push ( "PushInput", *this, boost::bind( &Skybox::poseIn, this, _1 ))
+		, m_pull ( "PullInput", *this )
+		, m_pushedRotation( m_frameInputs )
+		, m_box( GL_QUADS, GLGeometry::texCoords ){
                  objectNode = subgraph->getNode( "Skybox" );
                  };
 	
 	
-	/*draw the skybox of different sizes*/
-void Draw_Skybox(float x, float y, float z, float width, float height, float length)
+	/*build the skybox of different sizes, four vertices per side*/
+void Build_Skybox(float x, float y, float z, float width, float height, float length)
 {
 	// Center the Skybox around the given x,y,z position
 	x = x - width  / 2;
 	y = y - height / 2;
 	z = z - length / 2;
 
+	m_box.clear();
+
+	// Front side
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x,		  y,		z+length);
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x,		  y+height, z+length);
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x+width, y+height, z+length); 
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x+width, y,		z+length);
+
+	// Back side
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x+width, y,		z);
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x+width, y+height, z); 
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x,		  y+height,	z);
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x,		  y,		z);
+
+	// Left side
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x,		  y+height,	z);	
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x,		  y+height,	z+length); 
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x,		  y,		z+length);
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x,		  y,		z);		
+
+	// Right side
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x+width, y,		z);
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x+width, y,		z+length);
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x+width, y+height,	z+length); 
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x+width, y+height,	z);
+
+	// Up side
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x+width, y+height, z);
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x+width, y+height, z+length); 
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x,		  y+height,	z+length);
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x,		  y+height,	z);
+
+	// Down side
+	m_box.texCoord(0.0f, 0.0f); m_box.vertex(x,		  y,		z);
+	m_box.texCoord(1.0f, 0.0f); m_box.vertex(x,		  y,		z+length);
+	m_box.texCoord(1.0f, 1.0f); m_box.vertex(x+width, y,		z+length); 
+	m_box.texCoord(0.0f, 1.0f); m_box.vertex(x+width, y,		z);
+}
 
-	// Draw Front side
-	glBindTexture(GL_TEXTURE_2D, texture[0]);
-	glBegin(GL_QUADS);	
-	
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x,		  y,		z+length);
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x,		  y+height, z+length);
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x+width, y+height, z+length); 
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x+width, y,		z+length);
-		
-	glEnd();
-
-	// Draw Back side
-	glBindTexture(GL_TEXTURE_2D, texture[1]);
-	glBegin(GL_QUADS);		
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x+width, y,		z);
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x+width, y+height, z); 
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x,		  y+height,	z);
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x,		  y,		z);
-		
-	glEnd();
-
-	// Draw Left side
-	glBindTexture(GL_TEXTURE_2D, texture[2]);
-	glBegin(GL_QUADS);		
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x,		  y+height,	z);	
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x,		  y+height,	z+length); 
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x,		  y,		z+length);
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x,		  y,		z);		
-	glEnd();
-
-	// Draw Right side
-	glBindTexture(GL_TEXTURE_2D, texture[3]);
-	glBegin(GL_QUADS);		
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x+width, y,		z);
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x+width, y,		z+length);
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x+width, y+height,	z+length); 
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x+width, y+height,	z);
-	glEnd();
-
-	// Draw Up side
-	glBindTexture(GL_TEXTURE_2D, texture[4]);
-	glBegin(GL_QUADS);		
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x+width, y+height, z);
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x+width, y+height, z+length); 
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x,		  y+height,	z+length);
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x,		  y+height,	z);
-	glEnd();
-
-	// Draw Down side
-	glBindTexture(GL_TEXTURE_2D, texture[5]);
-	glBegin(GL_QUADS);		
-	
-		glTexCoord2f(0.0f, 0.0f); glVertex3f(x,		  y,		z);
-		glTexCoord2f(1.0f, 0.0f); glVertex3f(x,		  y,		z+length);
-		glTexCoord2f(1.0f, 1.0f); glVertex3f(x+width, y,		z+length); 
-		glTexCoord2f(0.0f, 1.0f); glVertex3f(x+width, y,		z);
-	
-	glEnd();
-
+	/*draw the skybox, one call per side as each has its own texture*/
+void Draw_Skybox()
+{
+	for ( unsigned side = 0; side < 6; side++ )
+	{
+		m_pModule->glState().bindTexture2D( texture[side] );
+		drawGeometry( m_box, 4 * side, 4 );
+	}
 }
   
 	/** render the object, if up-to-date tracking information is available */
 	virtual void draw( Measurement::Timestamp& t, int parity )
 	{
             
+		Measurement::Rotation rotation;
 		if ( m_pull.isConnected() ) 
-			poseIn( m_pull.get( t ), 0 );
+			rotation = m_pull.get( t );
+		else
+		{
+			rotation = m_pushedRotation.get();
+			if ( !rotation ) return;
+		}
+		m_lastUpdateTime = rotation.time();
 
 		// remove object if no measurements in the last second
 		// TODO: make this configurable
@@ -156,15 +153,12 @@ void Draw_Skybox(float x, float y, float z, float width, float height, float len
 	    
 		glMatrixMode( GL_MODELVIEW );
 		glPushMatrix();
-		{
-			boost::mutex::scoped_lock l( m_poseLock );
-			glMultMatrixd( m_pose );
-		}
+		glMultMatrixd( rotationMatrix( *rotation ) );
 		
-        glDisable( GL_DEPTH_TEST );
+		m_pModule->glState().disable( GL_DEPTH_TEST );
         glColor4d( 1.0, 1.0, 1.0, 1.0);
-		glEnable(GL_TEXTURE_2D);
-        Draw_Skybox(0,0,0,1,1,1);
+		m_pModule->glState().enable( GL_TEXTURE_2D );
+        Draw_Skybox();
 		
 		glPopMatrix();
 	}
@@ -175,6 +169,16 @@ void Draw_Skybox(float x, float y, float z, float width, float height, float len
 		return ( m_push.getQueuedEvents() > 0 );
 	}
 
+	/** changes with every pushed rotation and when the skybox disappears */
+	virtual unsigned long generation()
+	{
+		if ( m_pull.isConnected() ) return generationAlwaysChanged;
+
+		const Measurement::Rotation& pushed = m_pushedRotation.get();
+		bool bExpired = pushed && m_pModule->frameStartTime() > pushed.time() + 1000000000L;
+		return 2 * m_frameInputs.generation() + ( bExpired ? 1 : 0 );
+	}
+
     virtual void glInit()
     {
 		if ( !objectNode )
@@ -193,6 +197,8 @@ void Draw_Skybox(float x, float y, float z, float width, float height, float len
 		texture[3]=LoadTextureRAW(path3.c_str(), true);
 		texture[4]=LoadTextureRAW(path4.c_str(), true);
 		texture[5]=LoadTextureRAW(path5.c_str(), true);
+
+		Build_Skybox(0,0,0,1,1,1);
     } 
     
 
@@ -223,10 +229,10 @@ GLuint LoadTextureRAW( const char * filename, int wrap )
   glGenTextures( 1, &texture );
 
   // select our current texture
-  glBindTexture( GL_TEXTURE_2D, texture );
+  m_pModule->glState().bindTexture2D( texture );
 
   // select modulate to mix texture with color for shading
-  glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+  m_pModule->glState().texEnvMode( GL_MODULATE );
 
   // when texture area is small, bilinear filter the closest MIP map
   glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
@@ -253,19 +259,23 @@ GLuint LoadTextureRAW( const char * filename, int wrap )
 protected:
 
 	/**
-	 * callback from Pose port
-	 * @param pose current transformation
-	 * @param redraw trigger a redraw? (only if called from push-input)
+	 * callback from Pose push port
+	 * @param pose current rotation
 	 */
-	void poseIn( const Ubitrack::Measurement::Rotation& pose, int redraw )
+	void poseIn( const Ubitrack::Measurement::Rotation& pose )
+	{
+		m_pushedRotation.write( pose );
+
+        // the pose has changed, so redraw the world
+		m_pModule->invalidate();
+	}
+
+	/** converts the rotation into an OpenGL matrix */
+	const double* rotationMatrix( const Ubitrack::Math::Quaternion& rotation )
 	{
-		m_lastUpdateTime = pose.time();
-		Ubitrack::Math::Matrix< double, 3, 3 > m( *pose);
+		Ubitrack::Math::Matrix< double, 3, 3 > m( rotation );
 		double* tmp =  m.content();
 
-		boost::mutex::scoped_lock l( m_poseLock );
-		
-	
         m_pose[0] = tmp[0];
         m_pose[1] = tmp[1];
         m_pose[2] = tmp[2];
@@ -284,19 +294,22 @@ protected:
         m_pose[15] = 1;
         
         LOG4CPP_DEBUG( logger, ""<<m_pose[0]<<","<<m_pose[1]<<","<<m_pose[2] );
-		
-        // the pose has changed, so redraw the world
-		if (redraw) m_pModule->invalidate();
+		return m_pose;
 	}
 
 	// pose input
 	PushConsumer< Ubitrack::Measurement::Rotation > m_push;
 	PullConsumer< Ubitrack::Measurement::Rotation > m_pull;
 
+	// rotation from the push input, frozen for the current frame
+	FrameValue< Ubitrack::Measurement::Rotation > m_pushedRotation;
+
+	// matrix of the rotation, used by the render thread only
 	double m_pose[16];
-	boost::mutex m_poseLock;
 	// texture of the skybox
 	GLuint texture[6];
+	// the sides of the skybox
+	GLGeometry m_box;
 	Graph::UTQLSubgraph::NodePtr objectNode;
 };
 
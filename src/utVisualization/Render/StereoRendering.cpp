@@ -70,16 +70,16 @@ void StereoRendering::draw( Measurement::Timestamp&, int parity )
 	{
 	case stereoRedGreen:
 		LOG4CPP_TRACE( logger, "glColorMask( " << (GLboolean)parity << ", " << (GLboolean)!parity << ", false, true" );
-		glColorMask( parity, !parity, false, true );
+		getModule().glState().colorMask( parity, !parity, false, true );
 		break;
 
 	case stereoRedBlue:
 		LOG4CPP_TRACE( logger, "glColorMask( " << (GLboolean)parity << ", false, " << (GLboolean)!parity << ", true )" );
-		glColorMask( parity, false, !parity, true );
+		getModule().glState().colorMask( parity, false, !parity, true );
 		break;
 		
 	case stereoLineSequential:
-		glEnable( GL_STENCIL_TEST );
+		getModule().glState().enable( GL_STENCIL_TEST );
 		
 		if ( getModule().m_width != m_stencilWidth || getModule().m_height != m_stencilHeight )
 			initStencilBuffer();
@@ -95,9 +95,8 @@ void StereoRendering::draw( Measurement::Timestamp&, int parity )
 	if ( m_stereoOffset > 0 )
 	{
 		// non-calibrated simple stereo: add offset to projection matrix (will not work with spaam)
-		glMatrixMode( GL_PROJECTION );
-		glTranslated( ( parity ? 0.5 : -0.5 ) * m_stereoOffset, 0, 0 );
-		glMatrixMode( GL_MODELVIEW );
+		double offset[ 16 ] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, ( parity ? 0.5 : -0.5 ) * m_stereoOffset, 0, 0, 1 };
+		m_pModule->multProjection( offset );
 	}
 }
 
@@ -118,9 +117,9 @@ void StereoRendering::initStencilBuffer()
 	gluOrtho2D( 0.0, m_stencilWidth, 0.0, m_stencilHeight );
 			
 	// initialize every other line in the stencil buffer with 1
-	GLfloat fOldLineWidth = 1.0;
-	glGetFloatv( GL_LINE_WIDTH, &fOldLineWidth );
-	glLineWidth( 1.0 );
+	GLStateCache& state = getModule().glState();
+	state.push();
+	state.lineWidth( 1.0 );
 
 	glStencilMask( 0x01 );
 	glStencilOp( GL_REPLACE, GL_REPLACE, GL_REPLACE );
@@ -138,7 +137,7 @@ void StereoRendering::initStencilBuffer()
 	// reset stencil operations
 	glStencilOp( GL_KEEP, GL_KEEP, GL_KEEP );
 
-	glLineWidth( fOldLineWidth );
+	state.pop();
 
 	// reset projection matrix
 	glPopMatrix();
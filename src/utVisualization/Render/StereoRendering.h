@@ -54,6 +54,10 @@ public:
 	/** render the object */
 	virtual void draw( Measurement::Timestamp& time, int parity );
 
+	/** the stereo setup only depends on the window size, which forces a frame anyway */
+	virtual unsigned long generation()
+	{ return 0; }
+
 protected:
 	/** initialize the stencil buffer for line sequential stereo */
 	void initStencilBuffer();
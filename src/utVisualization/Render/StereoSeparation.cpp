@@ -30,13 +30,16 @@ namespace Ubitrack { namespace Drivers {
 StereoSeparation::StereoSeparation( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
-	, m_pushInput( "PushInput", *this, boost::bind( &StereoSeparation::poseIn, this, _1, 1 ) )
+	, m_pushInput( "PushInput", *this, boost::bind( &StereoSeparation::poseIn, this, _1, boost::ref( m_pushedInput ) ) )
 	, m_pullInput( "PullInput", *this)
-	, m_pushA( "PushInputA", *this, boost::bind( &StereoSeparation::poseAIn, this, _1, 1 ) )
+	, m_pushA( "PushInputA", *this, boost::bind( &StereoSeparation::poseIn, this, _1, boost::ref( m_pushedOffsetA ) ) )
 	, m_pullA( "PullInputA", *this)
-	, m_pushB( "PushInputB", *this, boost::bind( &StereoSeparation::poseBIn, this, _1, 1 ) )
+	, m_pushB( "PushInputB", *this, boost::bind( &StereoSeparation::poseIn, this, _1, boost::ref( m_pushedOffsetB ) ) )
 	, m_pullB( "PullInputB", *this)
 	, m_outputPort( "Output", *this )
+	, m_pushedInput( m_frameInputs )
+	, m_pushedOffsetA( m_frameInputs )
+	, m_pushedOffsetB( m_frameInputs )
 {
 	// ToDo: Make this configurable!!!
 	m_colorMaskA[0] = false;	//red
@@ -53,61 +56,61 @@ StereoSeparation::StereoSeparation( const std::string& name, boost::shared_ptr<
 /** render the object */
 void StereoSeparation::draw( Measurement::Timestamp& time, int parity )
 {
-	if (m_pullInput.isConnected())
-		poseIn( m_pullInput.get(time), 0);
+	fetchPose( m_poseInput, m_pullInput, m_pushedInput, time );
 
 	if (parity == 0) {
-		if (m_pullA.isConnected())
-			poseAIn( m_pullA.get(time), 0);
-		glColorMask(m_colorMaskA[0], m_colorMaskA[1], m_colorMaskA[2], m_colorMaskA[3]);
+		fetchPose( m_pose_offsetA, m_pullA, m_pushedOffsetA, time );
+		m_pModule->glState().colorMask( m_colorMaskA[0], m_colorMaskA[1], m_colorMaskA[2], m_colorMaskA[3] );
 		Measurement::Pose pose(time, m_poseInput*m_pose_offsetA );
 		m_outputPort.send( pose );
 	} else {
-		if (m_pullB.isConnected())
-			poseBIn( m_pullB.get(time), 0);
-		glColorMask(m_colorMaskB[0], m_colorMaskB[1], m_colorMaskB[2], m_colorMaskB[3]);
+		fetchPose( m_pose_offsetB, m_pullB, m_pushedOffsetB, time );
+		m_pModule->glState().colorMask( m_colorMaskB[0], m_colorMaskB[1], m_colorMaskB[2], m_colorMaskB[3] );
 		Measurement::Pose pose(time, m_poseInput*m_pose_offsetB );
 		m_outputPort.send( pose );
 	}
 }
 
-/**
- * callback from Pose input port
- * @param pose input pose
- * @param redraw trigger a redraw? (only if called from push-input)
- */
-void StereoSeparation::poseIn( const Ubitrack::Measurement::Pose& pose, int redraw )
+unsigned long StereoSeparation::generation()
 {
-	m_lastUpdateTime = pose.time();
-	m_poseInput = *(pose.get());
-	// the pose has changed, so redraw the world
-	if (redraw) m_pModule->invalidate();
+	if ( m_pullInput.isConnected() || m_pullA.isConnected() || m_pullB.isConnected() )
+		return generationAlwaysChanged;
+	return m_frameInputs.generation();
 }
 
 /**
- * callback from PoseA port
- * @param pose offset pose A
- * @param redraw trigger a redraw? (only if called from push-input)
+ * callback from the Pose push ports
+ * @param pose input or offset pose
+ * @param pushed buffer of the port
  */
-void StereoSeparation::poseAIn( const Ubitrack::Measurement::Pose& pose, int redraw )
+void StereoSeparation::poseIn( const Ubitrack::Measurement::Pose& pose, FrameValue< Measurement::Pose >& pushed )
 {
-	m_lastUpdateTime = pose.time();
-	m_pose_offsetA = *(pose.get());
+	pushed.write( pose );
 	// the pose has changed, so redraw the world
-	if (redraw) m_pModule->invalidate();
+	m_pModule->invalidate();
 }
 
 /**
- * callback from PoseB port
- * @param pose offset pose B
- * @param redraw trigger a redraw? (only if called from push-input)
+ * takes the pose of an input for the current frame
+ * @param current pose to update
+ * @param pull pull port, used if connected
+ * @param pushed latest pose of the push port
+ * @param time time of the frame
  */
-void StereoSeparation::poseBIn( const Ubitrack::Measurement::Pose& pose, int redraw )
+void StereoSeparation::fetchPose( Math::Pose& current, PullConsumer< Measurement::Pose >& pull, 
+	FrameValue< Measurement::Pose >& pushed, Measurement::Timestamp time )
 {
-	m_lastUpdateTime = pose.time();
-	m_pose_offsetB = *(pose.get());
-	// the pose has changed, so redraw the world
-	if (redraw) m_pModule->invalidate();
+	if ( pull.isConnected() )
+	{
+		Measurement::Pose pose( pull.get( time ) );
+		m_lastUpdateTime = pose.time();
+		current = *pose;
+	}
+	else if ( pushed.get() )
+	{
+		m_lastUpdateTime = pushed.get().time();
+		current = *pushed.get();
+	}
 }
 
 } } // namespace Ubitrack::Drivers
@@ -25,6 +25,7 @@
 #define _STEREOSEPARATION_H_
 
 #include "RenderModule.h"
+#include "FrameValue.h"
 
 namespace Ubitrack { namespace Drivers {
 
@@ -55,28 +56,20 @@ public:
 	/** render the object */
 	virtual void draw( Measurement::Timestamp& time, int parity );
 
+	virtual unsigned long generation();
+
 protected:
 
 	/**
-	 * callback from Pose input port
-	 * @param pose input pose
-	 * @param redraw trigger a redraw? (only if called from push-input)
+	 * callback from the Pose push ports
+	 * @param pose input or offset pose
+	 * @param pushed buffer of the port
 	 */
-	void poseIn( const Ubitrack::Measurement::Pose& pose, int redraw );
+	void poseIn( const Ubitrack::Measurement::Pose& pose, FrameValue< Measurement::Pose >& pushed );
 
-	/**
-	 * callback from PoseA port
-	 * @param pose offset pose A
-	 * @param redraw trigger a redraw? (only if called from push-input)
-	 */
-	void poseAIn( const Ubitrack::Measurement::Pose& pose, int redraw );
-
-	/**
-	 * callback from PoseB port
-	 * @param pose offset pose B
-	 * @param redraw trigger a redraw? (only if called from push-input)
-	 */
-	void poseBIn( const Ubitrack::Measurement::Pose& pose, int redraw );
+	/** takes the pose of an input for the current frame */
+	void fetchPose( Math::Pose& current, PullConsumer< Measurement::Pose >& pull, 
+		FrameValue< Measurement::Pose >& pushed, Measurement::Timestamp time );
 
 	// pose input
 	PushConsumer< Measurement::Pose >	m_pushInput;
@@ -91,6 +84,12 @@ protected:
 	/** Output port of the component. */
 	PushSupplier< Measurement::Pose > 	m_outputPort;
 
+	/** poses from the push inputs, frozen for the current frame */
+	FrameValue< Measurement::Pose >	m_pushedInput;
+	FrameValue< Measurement::Pose >	m_pushedOffsetA;
+	FrameValue< Measurement::Pose >	m_pushedOffsetB;
+
+	/** current poses, used by the render thread only */
 	Math::Pose				m_poseInput;
 	Math::Pose				m_pose_offsetA;
 	Math::Pose				m_pose_offsetB;
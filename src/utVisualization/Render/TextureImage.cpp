@@ -0,0 +1,612 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Decoding, compression and caching of texture images.
+ */
+
+#include "TextureImage.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <boost/cstdint.hpp>
+
+#ifdef HAVE_OPENCV
+	#include <opencv/highgui.h>
+#endif
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.TextureImage" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+namespace {
+
+/** smallest power of two that is not less than val */
+unsigned powerOfTwo( unsigned val )
+{
+	unsigned result = 1;
+	while ( result < val && result < 32768 )
+		result <<= 1;
+	return result;
+}
+
+
+/** the only level of an uncompressed image */
+TextureImage::Level wholeImage( const TextureImage& image )
+{
+	TextureImage::Level level;
+	level.width = image.width;
+	level.height = image.height;
+	level.offset = 0;
+	level.size = image.data.size();
+	return level;
+}
+
+
+// DDS header, 32 little endian words including the magic
+const boost::uint32_t ddsMagic = 0x20534444;       // "DDS "
+const boost::uint32_t ddsFourCCDXT1 = 0x31545844;  // "DXT1"
+const boost::uint32_t ddsFourCCDXT5 = 0x35545844;  // "DXT5"
+const boost::uint32_t ddsTag = 0x54425455;         // "UTBT", marks the source fields in the reserved words
+const unsigned ddsHeaderSize = 128;
+
+void putWord( unsigned char* pHeader, unsigned index, boost::uint32_t value )
+{
+	for ( unsigned i = 0; i < 4; i++ )
+		pHeader[ 4 * index + i ] = (unsigned char)( value >> ( 8 * i ) );
+}
+
+boost::uint32_t getWord( const unsigned char* pHeader, unsigned index )
+{
+	boost::uint32_t value = 0;
+	for ( unsigned i = 0; i < 4; i++ )
+		value |= boost::uint32_t( pHeader[ 4 * index + i ] ) << ( 8 * i );
+	return value;
+}
+
+
+/** size and modification time of a file */
+bool sourceKey( const std::string& file, boost::uint64_t& size, boost::uint64_t& time )
+{
+	struct stat status;
+	if ( stat( file.c_str(), &status ) != 0 )
+		return false;
+
+	size = boost::uint64_t( status.st_size );
+	time = boost::uint64_t( status.st_mtime );
+	return true;
+}
+
+
+/** 5:6:5 color of 8 bit channels */
+unsigned short pack565( const int* color )
+{
+	return (unsigned short)( ( ( color[ 0 ] * 31 + 127 ) / 255 ) << 11 | ( ( color[ 1 ] * 63 + 127 ) / 255 ) << 5 | 
+		( color[ 2 ] * 31 + 127 ) / 255 );
+}
+
+void unpack565( unsigned short packed, int* color )
+{
+	int r = ( packed >> 11 ) & 31;
+	int g = ( packed >> 5 ) & 63;
+	int b = packed & 31;
+	color[ 0 ] = ( r << 3 ) | ( r >> 2 );
+	color[ 1 ] = ( g << 2 ) | ( g >> 4 );
+	color[ 2 ] = ( b << 3 ) | ( b >> 2 );
+}
+
+
+/**
+ * Compresses the colors of 16 RGBA pixels into a DXT1 block.
+ * The end points span the bounding box along the diagonal that follows the correlation of the channels,
+ * which comes close to a principal axis fit at a fraction of its cost.
+ */
+void compressColorBlock( const unsigned char* pPixels, unsigned char* pBlock )
+{
+	int lo[ 3 ] = { 255, 255, 255 };
+	int hi[ 3 ] = { 0, 0, 0 };
+	int mean[ 3 ] = { 0, 0, 0 };
+	for ( unsigned i = 0; i < 16; i++ )
+		for ( unsigned c = 0; c < 3; c++ )
+		{
+			int value = pPixels[ 4 * i + c ];
+			lo[ c ] = std::min( lo[ c ], value );
+			hi[ c ] = std::max( hi[ c ], value );
+			mean[ c ] += value;
+		}
+
+	// channels that decrease along the one with the largest range run from hi to lo
+	unsigned axis = 0;
+	for ( unsigned c = 1; c < 3; c++ )
+		if ( hi[ c ] - lo[ c ] > hi[ axis ] - lo[ axis ] )
+			axis = c;
+	for ( unsigned c = 0; c < 3; c++ )
+	{
+		if ( c == axis )
+			continue;
+		int covariance = 0;
+		for ( unsigned i = 0; i < 16; i++ )
+			covariance += ( 16 * pPixels[ 4 * i + c ] - mean[ c ] ) * ( 16 * pPixels[ 4 * i + axis ] - mean[ axis ] ) / 256;
+		if ( covariance < 0 )
+			std::swap( lo[ c ], hi[ c ] );
+	}
+
+	// moving the end points inwards by 1/16 of the range lowers the error of the interpolated colors
+	for ( unsigned c = 0; c < 3; c++ )
+	{
+		int inset = ( hi[ c ] - lo[ c ] ) / 16;
+		hi[ c ] -= inset;
+		lo[ c ] += inset;
+	}
+
+	// color0 > color1 selects the mode with four colors
+	unsigned short color0 = pack565( hi );
+	unsigned short color1 = pack565( lo );
+	if ( color0 < color1 )
+		std::swap( color0, color1 );
+
+	int palette[ 4 ][ 3 ];
+	unpack565( color0, palette[ 0 ] );
+	unpack565( color1, palette[ 1 ] );
+	for ( unsigned c = 0; c < 3; c++ )
+	{
+		palette[ 2 ][ c ] = ( 2 * palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 3;
+		palette[ 3 ][ c ] = ( palette[ 0 ][ c ] + 2 * palette[ 1 ][ c ] ) / 3;
+	}
+
+	boost::uint32_t indices = 0;
+	if ( color0 != color1 )
+		for ( unsigned i = 0; i < 16; i++ )
+		{
+			unsigned best = 0;
+			int bestDistance = 0x7fffffff;
+			for ( unsigned k = 0; k < 4; k++ )
+			{
+				int distance = 0;
+				for ( unsigned c = 0; c < 3; c++ )
+				{
+					int d = pPixels[ 4 * i + c ] - palette[ k ][ c ];
+					distance += d * d;
+				}
+				if ( distance < bestDistance )
+				{
+					best = k;
+					bestDistance = distance;
+				}
+			}
+			indices |= boost::uint32_t( best ) << ( 2 * i );
+		}
+
+	pBlock[ 0 ] = (unsigned char)( color0 & 0xff );
+	pBlock[ 1 ] = (unsigned char)( color0 >> 8 );
+	pBlock[ 2 ] = (unsigned char)( color1 & 0xff );
+	pBlock[ 3 ] = (unsigned char)( color1 >> 8 );
+	for ( unsigned i = 0; i < 4; i++ )
+		pBlock[ 4 + i ] = (unsigned char)( indices >> ( 8 * i ) );
+}
+
+
+/** compresses the alpha of 16 RGBA pixels into the first half of a DXT5 block */
+void compressAlphaBlock( const unsigned char* pPixels, unsigned char* pBlock )
+{
+	int lo = 255;
+	int hi = 0;
+	for ( unsigned i = 0; i < 16; i++ )
+	{
+		lo = std::min( lo, int( pPixels[ 4 * i + 3 ] ) );
+		hi = std::max( hi, int( pPixels[ 4 * i + 3 ] ) );
+	}
+
+	// alpha0 > alpha1 selects the mode with eight interpolated values
+	int palette[ 8 ];
+	palette[ 0 ] = hi;
+	palette[ 1 ] = lo;
+	for ( int k = 1; k < 7; k++ )
+		palette[ k + 1 ] = ( ( 7 - k ) * hi + k * lo ) / 7;
+
+	boost::uint64_t indices = 0;
+	if ( hi != lo )
+		for ( unsigned i = 0; i < 16; i++ )
+		{
+			unsigned best = 0;
+			int bestDistance = 256;
+			for ( unsigned k = 0; k < 8; k++ )
+			{
+				int distance = std::abs( pPixels[ 4 * i + 3 ] - palette[ k ] );
+				if ( distance < bestDistance )
+				{
+					best = k;
+					bestDistance = distance;
+				}
+			}
+			indices |= boost::uint64_t( best ) << ( 3 * i );
+		}
+
+	pBlock[ 0 ] = (unsigned char)hi;
+	pBlock[ 1 ] = (unsigned char)lo;
+	for ( unsigned i = 0; i < 6; i++ )
+		pBlock[ 2 + i ] = (unsigned char)( indices >> ( 8 * i ) );
+}
+
+} // anonymous namespace
+
+
+TextureImage::TextureImage()
+	: width( 0 )
+	, height( 0 )
+	, format( GL_RGB )
+	, channels( 3 )
+	, bCompressed( false )
+{
+}
+
+
+bool TextureImage::decode( const std::string& file )
+{
+	bCompressed = false;
+	levels.clear();
+	data.clear();
+
+	std::ifstream stream( file.c_str(), std::ios::in | std::ios::binary );
+	if ( !stream )
+		return false;
+
+	std::string magic, comment;
+	stream >> magic;
+
+	// binary PPM is read directly, everything else by OpenCV
+	if ( magic != "P6" )
+	{
+		stream.close();
+
+#ifdef HAVE_OPENCV
+		// 16 bit images are converted to 8 bit when loaded as color images
+		IplImage* pImage = cvLoadImage( file.c_str(), CV_LOAD_IMAGE_UNCHANGED );
+		if ( pImage && pImage->depth != IPL_DEPTH_8U )
+		{
+			cvReleaseImage( &pImage );
+			pImage = cvLoadImage( file.c_str(), CV_LOAD_IMAGE_COLOR );
+		}
+		if ( !pImage )
+			return false;
+
+		width = pImage->width;
+		height = pImage->height;
+		channels = pImage->nChannels == 4 ? 4 : 3;
+		format = channels == 4 ? GL_RGBA : GL_RGB;
+		data.resize( std::size_t( width ) * height * channels );
+
+		// OpenCV stores BGR(A) or gray
+		for ( unsigned y = 0; y < height; y++ )
+		{
+			const unsigned char* pSource = reinterpret_cast< const unsigned char* >( pImage->imageData ) + 
+				std::size_t( pImage->widthStep ) * ( pImage->origin ? height - 1 - y : y );
+			unsigned char* pTarget = &data[ std::size_t( y ) * width * channels ];
+			for ( unsigned x = 0; x < width; x++, pTarget += channels )
+				if ( pImage->nChannels >= 3 )
+				{
+					const unsigned char* pPixel = pSource + x * pImage->nChannels;
+					pTarget[ 0 ] = pPixel[ 2 ];
+					pTarget[ 1 ] = pPixel[ 1 ];
+					pTarget[ 2 ] = pPixel[ 0 ];
+					if ( channels == 4 )
+						pTarget[ 3 ] = pPixel[ 3 ];
+				}
+				else
+					pTarget[ 0 ] = pTarget[ 1 ] = pTarget[ 2 ] = pSource[ x * pImage->nChannels ];
+		}
+
+		cvReleaseImage( &pImage );
+		levels.push_back( wholeImage( *this ) );
+		return true;
+#else
+		LOG4CPP_WARN( logger, "Only binary PPM textures can be read without OpenCV: " << file );
+		return false;
+#endif
+	}
+
+	int fileWidth, fileHeight, maxValue;
+	stream.ignore( 1 ); if ( stream.peek() == '#' ) getline( stream, comment );
+	stream >> fileWidth;  stream.ignore( 1 ); if ( stream.peek() == '#' ) getline( stream, comment );
+	stream >> fileHeight; stream.ignore( 1 ); if ( stream.peek() == '#' ) getline( stream, comment );
+	stream >> maxValue;
+	if ( !stream || maxValue > 255 || maxValue < 1 || fileWidth < 1 || fileHeight < 1 )
+		return false;
+
+	width = fileWidth;
+	height = fileHeight;
+	format = GL_RGB;
+	channels = 3;
+	data.resize( std::size_t( width ) * height * 3 );
+
+	// a single whitespace character separates the header from the pixels
+	stream.ignore( 1 );
+	stream.read( reinterpret_cast< char* >( &data[ 0 ] ), data.size() );
+	levels.push_back( wholeImage( *this ) );
+	return stream.gcount() == std::streamsize( data.size() );
+}
+
+
+void TextureImage::scaleToPowerOfTwo()
+{
+	unsigned newWidth = powerOfTwo( width );
+	unsigned newHeight = powerOfTwo( height );
+	if ( bCompressed || ( newWidth == width && newHeight == height ) )
+		return;
+
+	// bilinear, like gluScaleImage() when magnifying
+	std::vector< unsigned char > scaled( std::size_t( newWidth ) * newHeight * channels );
+	for ( unsigned y = 0; y < newHeight; y++ )
+	{
+		float fy = newHeight > 1 ? float( y ) * ( height - 1 ) / ( newHeight - 1 ) : 0.0f;
+		unsigned y0 = unsigned( fy );
+		unsigned y1 = y0 + 1 < height ? y0 + 1 : y0;
+		float wy = fy - y0;
+
+		for ( unsigned x = 0; x < newWidth; x++ )
+		{
+			float fx = newWidth > 1 ? float( x ) * ( width - 1 ) / ( newWidth - 1 ) : 0.0f;
+			unsigned x0 = unsigned( fx );
+			unsigned x1 = x0 + 1 < width ? x0 + 1 : x0;
+			float wx = fx - x0;
+
+			for ( unsigned c = 0; c < channels; c++ )
+			{
+				float a = data[ ( std::size_t( y0 ) * width + x0 ) * channels + c ];
+				float b = data[ ( std::size_t( y0 ) * width + x1 ) * channels + c ];
+				float d = data[ ( std::size_t( y1 ) * width + x0 ) * channels + c ];
+				float e = data[ ( std::size_t( y1 ) * width + x1 ) * channels + c ];
+				float value = ( a * ( 1 - wx ) + b * wx ) * ( 1 - wy ) + ( d * ( 1 - wx ) + e * wx ) * wy;
+				scaled[ ( std::size_t( y ) * newWidth + x ) * channels + c ] = (unsigned char)( value + 0.5f );
+			}
+		}
+	}
+
+	width = newWidth;
+	height = newHeight;
+	data.swap( scaled );
+	levels.assign( 1, wholeImage( *this ) );
+}
+
+
+void TextureImage::compress()
+{
+	bool bAlpha = channels == 4;
+	unsigned blockSize = bAlpha ? 16 : 8;
+
+	// RGBA working copy, replaced by the next smaller level after each compression
+	unsigned levelWidth = width;
+	unsigned levelHeight = height;
+	std::vector< unsigned char > pixels( std::size_t( width ) * height * 4, 255 );
+	for ( std::size_t i = 0; i < std::size_t( width ) * height; i++ )
+		for ( unsigned c = 0; c < channels; c++ )
+			pixels[ 4 * i + c ] = data[ channels * i + c ];
+
+	std::vector< unsigned char > compressed;
+	levels.clear();
+	while ( true )
+	{
+		Level level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.offset = compressed.size();
+		level.size = std::size_t( ( levelWidth + 3 ) / 4 ) * ( ( levelHeight + 3 ) / 4 ) * blockSize;
+		compressed.resize( level.offset + level.size );
+		levels.push_back( level );
+
+		// blocks at the right and bottom border repeat the last column and row
+		unsigned char* pBlock = &compressed[ level.offset ];
+		unsigned char tile[ 64 ];
+		for ( unsigned by = 0; by < levelHeight; by += 4 )
+			for ( unsigned bx = 0; bx < levelWidth; bx += 4 )
+			{
+				for ( unsigned y = 0; y < 4; y++ )
+					for ( unsigned x = 0; x < 4; x++ )
+					{
+						std::size_t source = std::size_t( std::min( by + y, levelHeight - 1 ) ) * levelWidth + std::min( bx + x, levelWidth - 1 );
+						memcpy( tile + 16 * y + 4 * x, &pixels[ 4 * source ], 4 );
+					}
+
+				if ( bAlpha )
+				{
+					compressAlphaBlock( tile, pBlock );
+					pBlock += 8;
+				}
+				compressColorBlock( tile, pBlock );
+				pBlock += 8;
+			}
+
+		if ( levelWidth == 1 && levelHeight == 1 )
+			break;
+
+		// 2x2 box filter
+		unsigned nextWidth = std::max( levelWidth / 2, 1u );
+		unsigned nextHeight = std::max( levelHeight / 2, 1u );
+		std::vector< unsigned char > next( std::size_t( nextWidth ) * nextHeight * 4 );
+		for ( unsigned y = 0; y < nextHeight; y++ )
+		{
+			std::size_t y0 = std::min( 2 * y, levelHeight - 1 ) * std::size_t( levelWidth );
+			std::size_t y1 = std::min( 2 * y + 1, levelHeight - 1 ) * std::size_t( levelWidth );
+			for ( unsigned x = 0; x < nextWidth; x++ )
+			{
+				unsigned x0 = std::min( 2 * x, levelWidth - 1 );
+				unsigned x1 = std::min( 2 * x + 1, levelWidth - 1 );
+				for ( unsigned c = 0; c < 4; c++ )
+					next[ 4 * ( std::size_t( y ) * nextWidth + x ) + c ] = (unsigned char)( ( pixels[ 4 * ( y0 + x0 ) + c ] + 
+						pixels[ 4 * ( y0 + x1 ) + c ] + pixels[ 4 * ( y1 + x0 ) + c ] + pixels[ 4 * ( y1 + x1 ) + c ] + 2 ) / 4 );
+			}
+		}
+
+		pixels.swap( next );
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	data.swap( compressed );
+	format = bAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	bCompressed = true;
+}
+
+
+bool TextureImage::read( const std::string& file, const std::string& source )
+{
+	boost::uint64_t sourceSize, sourceTime;
+	if ( !sourceKey( source, sourceSize, sourceTime ) )
+		return false;
+
+	std::ifstream stream( file.c_str(), std::ios::in | std::ios::binary );
+	if ( !stream )
+		return false;
+
+	unsigned char header[ ddsHeaderSize ];
+	if ( !stream.read( reinterpret_cast< char* >( header ), ddsHeaderSize ) )
+		return false;
+
+	if ( getWord( header, 0 ) != ddsMagic || getWord( header, 1 ) != 124 || getWord( header, 8 ) != ddsTag || 
+		getWord( header, 9 ) != boost::uint32_t( sourceSize ) || getWord( header, 10 ) != boost::uint32_t( sourceSize >> 32 ) ||
+		getWord( header, 11 ) != boost::uint32_t( sourceTime ) || getWord( header, 12 ) != boost::uint32_t( sourceTime >> 32 ) )
+	{
+		LOG4CPP_DEBUG( logger, "Compressed texture " << file << " is outdated" );
+		return false;
+	}
+
+	boost::uint32_t fourCC = getWord( header, 21 );
+	if ( fourCC != ddsFourCCDXT1 && fourCC != ddsFourCCDXT5 )
+		return false;
+
+	width = getWord( header, 4 );
+	height = getWord( header, 3 );
+	unsigned levelCount = std::max( getWord( header, 7 ), boost::uint32_t( 1 ) );
+	if ( width < 1 || height < 1 || width > 32768 || height > 32768 || levelCount > 16 )
+		return false;
+
+	channels = fourCC == ddsFourCCDXT5 ? 4 : 3;
+	format = channels == 4 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	bCompressed = true;
+
+	levels.clear();
+	std::size_t total = 0;
+	for ( unsigned i = 0; i < levelCount; i++ )
+	{
+		Level level;
+		level.width = std::max( width >> i, 1u );
+		level.height = std::max( height >> i, 1u );
+		level.offset = total;
+		level.size = std::size_t( ( level.width + 3 ) / 4 ) * ( ( level.height + 3 ) / 4 ) * ( channels == 4 ? 16 : 8 );
+		total += level.size;
+		levels.push_back( level );
+	}
+
+	data.resize( total );
+	stream.read( reinterpret_cast< char* >( &data[ 0 ] ), total );
+	return stream.gcount() == std::streamsize( total );
+}
+
+
+bool TextureImage::write( const std::string& file, const std::string& source ) const
+{
+	boost::uint64_t sourceSize, sourceTime;
+	if ( !bCompressed || !sourceKey( source, sourceSize, sourceTime ) )
+		return false;
+
+	unsigned char header[ ddsHeaderSize ];
+	memset( header, 0, sizeof( header ) );
+	putWord( header, 0, ddsMagic );
+	putWord( header, 1, 124 );
+	putWord( header, 2, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000 );  // caps, height, width, pixel format, mipmap count, linear size
+	putWord( header, 3, height );
+	putWord( header, 4, width );
+	putWord( header, 5, boost::uint32_t( levels[ 0 ].size ) );
+	putWord( header, 7, boost::uint32_t( levels.size() ) );
+	putWord( header, 8, ddsTag );
+	putWord( header, 9, boost::uint32_t( sourceSize ) );
+	putWord( header, 10, boost::uint32_t( sourceSize >> 32 ) );
+	putWord( header, 11, boost::uint32_t( sourceTime ) );
+	putWord( header, 12, boost::uint32_t( sourceTime >> 32 ) );
+	putWord( header, 19, 32 );
+	putWord( header, 20, 0x4 );  // four character code
+	putWord( header, 21, format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? ddsFourCCDXT5 : ddsFourCCDXT1 );
+	putWord( header, 27, 0x1000 | 0x8 | 0x400000 );  // texture, complex, mipmap
+
+	std::string temporary( file + ".tmp" );
+	{
+		std::ofstream stream( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		stream.write( reinterpret_cast< const char* >( header ), ddsHeaderSize );
+		stream.write( reinterpret_cast< const char* >( &data[ 0 ] ), data.size() );
+		if ( !stream )
+		{
+			stream.close();
+			std::remove( temporary.c_str() );
+			return false;
+		}
+	}
+
+	// rename() does not replace existing files on Windows
+	std::remove( file.c_str() );
+	if ( std::rename( temporary.c_str(), file.c_str() ) != 0 )
+	{
+		std::remove( temporary.c_str() );
+		return false;
+	}
+	return true;
+}
+
+
+void TextureImage::swap( TextureImage& other )
+{
+	std::swap( width, other.width );
+	std::swap( height, other.height );
+	std::swap( format, other.format );
+	std::swap( channels, other.channels );
+	std::swap( bCompressed, other.bCompressed );
+	levels.swap( other.levels );
+	data.swap( other.data );
+}
+
+
+bool TextureImage::isPowerOfTwo() const
+{
+	return powerOfTwo( width ) == width && powerOfTwo( height ) == height;
+}
+
+
+std::size_t TextureImage::rowSize( const Level& level ) const
+{
+	if ( bCompressed )
+		return std::size_t( ( level.width + 3 ) / 4 ) * ( format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 8 );
+	return std::size_t( level.width ) * channels;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,123 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Decoding, compression and caching of texture images.
+ */
+
+#ifndef __TextureImage_h_INCLUDED__
+#define __TextureImage_h_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include "GLExtensions.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Pixels of a texture with all levels that are uploaded, rows from top to bottom as in the file.
+ *
+ * Uncompressed images have a single level, their mipmaps are generated by the GPU. 
+ * S3TC compressed images carry the complete mipmap chain, as the GPU cannot generate it for them.
+ */
+struct TextureImage
+{
+	struct Level
+	{
+		unsigned width;
+		unsigned height;
+
+		/** start and size of the level in data */
+		std::size_t offset;
+		std::size_t size;
+	};
+
+	TextureImage();
+
+	/** 
+	 * reads a binary PPM file, or any format OpenCV can read if it is available
+	 * @return false if the file could not be read
+	 */
+	bool decode( const std::string& file );
+
+	/** scales an uncompressed image to the next powers of two, for contexts without non-power-of-two textures */
+	void scaleToPowerOfTwo();
+
+	/** 
+	 * builds the mipmap chain and compresses all levels, DXT1 for RGB and DXT5 for RGBA images.
+	 * The image must not be compressed already.
+	 */
+	void compress();
+
+	/**
+	 * reads a DDS file written by write()
+	 * @param source the file the image was decoded from
+	 * @return false if the file does not exist or is outdated
+	 */
+	bool read( const std::string& file, const std::string& source );
+
+	/** 
+	 * writes a compressed image as a DDS file, which other tools can view. 
+	 * Size and modification time of the source are stored in reserved header fields.
+	 * @return false on errors
+	 */
+	bool write( const std::string& file, const std::string& source ) const;
+
+	/** exchanges the contents without copying the pixels */
+	void swap( TextureImage& other );
+
+	/** true if all levels are powers of two */
+	bool isPowerOfTwo() const;
+
+	/** number of bytes of each row of 4x4 blocks of compressed levels, or of each row of pixels */
+	std::size_t rowSize( const Level& level ) const;
+
+	/** 4 for compressed images, which consist of blocks, otherwise 1 */
+	unsigned rowsPerUnit() const
+	{ return bCompressed ? 4 : 1; }
+
+	unsigned width;
+	unsigned height;
+
+	/** GL_RGB or GL_RGBA for uncompressed images, the S3TC internal format otherwise */
+	GLenum format;
+
+	/** channels of the uncompressed pixels, 3 or 4 */
+	unsigned channels;
+
+	bool bCompressed;
+
+	std::vector< Level > levels;
+	std::vector< unsigned char > data;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
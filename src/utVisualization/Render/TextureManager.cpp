@@ -0,0 +1,396 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Asynchronous loading of texture files.
+ */
+
+#include "TextureManager.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.TextureManager" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+TextureManager::TextureManager()
+	: m_bStop( false )
+	, m_budget( 4 * 1024 * 1024 )
+	, m_bCompression( true )
+	, m_bPixelBufferObject( false )
+	, m_bNonPowerOfTwo( false )
+	, m_bGenerateMipmap( false )
+	, m_bTextureCompressionS3TC( false )
+	, m_placeholder( 0 )
+	, m_buffer( 0 )
+	, m_bufferSize( 0 )
+{
+}
+
+
+TextureManager::~TextureManager()
+{
+	stop();
+}
+
+
+void TextureManager::stop()
+{
+	// the render thread may still request textures, but no longer starts a worker
+	boost::scoped_ptr< boost::thread > pWorker;
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		m_bStop = true;
+		pWorker.swap( m_pWorker );
+	}
+
+	if ( pWorker )
+	{
+		m_decodeRequest.notify_all();
+		pWorker->join();
+	}
+}
+
+
+void TextureManager::init( const GLExtensions& ext, boost::function< void() > wakeup )
+{
+	m_wakeup = wakeup;
+	m_bPixelBufferObject = ext.hasPixelBufferObject();
+	m_bNonPowerOfTwo = ext.hasTextureNonPowerOfTwo();
+	m_bGenerateMipmap = ext.generateMipmap != 0;
+	m_bTextureCompressionS3TC = ext.hasTextureCompressionS3TC();
+
+	// names of a previous context are meaningless now
+	m_entries.clear();
+	m_pending.clear();
+	m_placeholder = 0;
+	m_buffer = 0;
+	m_bufferSize = 0;
+}
+
+
+void TextureManager::setBudget( std::size_t bytes )
+{
+	m_budget = bytes;
+}
+
+
+void TextureManager::setCompression( bool bCompression )
+{
+	m_bCompression = bCompression;
+}
+
+
+TextureManager::Handle TextureManager::request( const std::string& url, bool bRepeatS, bool bRepeatT )
+{
+	std::string key( url );
+	key += bRepeatS ? "\nS" : "\n";
+	key += bRepeatT ? "T" : "";
+
+	std::map< std::string, Handle >::iterator it = m_entries.find( key );
+	if ( it != m_entries.end() )
+		return it->second;
+
+	Handle pEntry( new Entry );
+	pEntry->url = url;
+	pEntry->bRepeatS = bRepeatS;
+	pEntry->bRepeatT = bRepeatT;
+	pEntry->bDecoded = false;
+	pEntry->bFailed = false;
+	pEntry->id = 0;
+	pEntry->bReady = false;
+	pEntry->uploadedLevel = 0;
+	pEntry->uploadedRows = 0;
+	m_entries[ key ] = pEntry;
+	m_pending.push_back( pEntry );
+
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		m_decodeQueue.push_back( pEntry );
+		if ( !m_pWorker && !m_bStop )
+			m_pWorker.reset( new boost::thread( boost::bind( &TextureManager::decodeLoop, this ) ) );
+	}
+	m_decodeRequest.notify_one();
+
+	LOG4CPP_DEBUG( logger, "Requested texture " << url );
+	return pEntry;
+}
+
+
+GLuint TextureManager::name( GLStateCache& state, const Handle& handle )
+{
+	if ( handle && handle->bReady )
+		return handle->id;
+	return placeholder( state );
+}
+
+
+bool TextureManager::busy()
+{
+	return !m_pending.empty();
+}
+
+
+void TextureManager::decodeLoop()
+{
+	while ( true )
+	{
+		Handle pEntry;
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			while ( m_decodeQueue.empty() && !m_bStop )
+				m_decodeRequest.wait( l );
+			if ( m_bStop )
+				return;
+			pEntry = m_decodeQueue.front();
+			m_decodeQueue.pop_front();
+		}
+
+		TextureImage image;
+		bool bDecoded = decode( pEntry->url, image );
+		if ( !bDecoded )
+			LOG4CPP_WARN( logger, "Could not load texture " << pEntry->url );
+
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			pEntry->image.swap( image );
+			pEntry->bFailed = !bDecoded;
+			pEntry->bDecoded = true;
+			if ( m_bStop )
+				return;
+		}
+
+		if ( m_wakeup )
+			m_wakeup();
+	}
+}
+
+
+bool TextureManager::decode( const std::string& url, TextureImage& image )
+{
+	bool bCompress = m_bCompression && m_bTextureCompressionS3TC;
+	std::string cacheFile( url + ".dds" );
+
+	if ( bCompress && image.read( cacheFile, url ) && ( m_bNonPowerOfTwo || image.isPowerOfTwo() ) )
+	{
+		LOG4CPP_DEBUG( logger, "Read compressed texture " << cacheFile );
+		return true;
+	}
+
+	if ( !image.decode( url ) )
+		return false;
+
+	if ( !m_bNonPowerOfTwo )
+		image.scaleToPowerOfTwo();
+
+	if ( bCompress )
+	{
+		image.compress();
+		if ( image.write( cacheFile, url ) )
+			LOG4CPP_INFO( logger, "Wrote compressed texture " << cacheFile );
+		else
+			LOG4CPP_DEBUG( logger, "Could not write compressed texture " << cacheFile );
+	}
+	return true;
+}
+
+
+void TextureManager::update( GLStateCache& state, const GLExtensions& ext )
+{
+	std::size_t budget = m_budget ? m_budget : std::size_t( -1 );
+
+	// textures are completed in the order of their requests
+	while ( !m_pending.empty() && budget > 0 )
+	{
+		Entry& entry( *m_pending.front() );
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			if ( !entry.bDecoded )
+				break;
+		}
+
+		if ( entry.bFailed )
+		{
+			m_pending.pop_front();
+			continue;
+		}
+
+		std::size_t size = upload( state, ext, entry, budget );
+		budget = size < budget ? budget - size : 0;
+
+		if ( entry.uploadedLevel == entry.image.levels.size() )
+		{
+			// compressed images bring their mipmaps
+			if ( m_bGenerateMipmap && !entry.image.bCompressed )
+				ext.generateMipmap( GL_TEXTURE_2D );
+
+			LOG4CPP_INFO( logger, "Loaded texture " << entry.url << " (" << entry.image.width << "x" << entry.image.height << 
+				( entry.image.bCompressed ? ", compressed)" : ")" ) );
+			std::vector< unsigned char >().swap( entry.image.data );
+			entry.bReady = true;
+			m_pending.pop_front();
+		}
+	}
+
+	// the remaining bands follow in the next frames
+	if ( !m_pending.empty() && m_wakeup )
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		if ( m_pending.front()->bDecoded )
+		{
+			l.unlock();
+			m_wakeup();
+		}
+	}
+}
+
+
+std::size_t TextureManager::upload( GLStateCache& state, const GLExtensions& ext, Entry& entry, std::size_t budget )
+{
+	const TextureImage& image( entry.image );
+
+	if ( !entry.id )
+	{
+		bool bMipmaps = image.bCompressed || m_bGenerateMipmap;
+		glGenTextures( 1, &entry.id );
+		state.bindTexture2D( entry.id );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, bMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry.bRepeatS ? GL_REPEAT : GL_CLAMP );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry.bRepeatT ? GL_REPEAT : GL_CLAMP );
+
+		if ( image.bCompressed )
+		{
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint( image.levels.size() ) - 1 );
+			for ( unsigned i = 0; i < image.levels.size(); i++ )
+				ext.compressedTexImage2D( GL_TEXTURE_2D, i, image.format, image.levels[ i ].width, image.levels[ i ].height, 0, 
+					GLsizei( image.levels[ i ].size ), 0 );
+		}
+		else
+			glTexImage2D( GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, 0 );
+
+		entry.uploadedLevel = 0;
+		entry.uploadedRows = 0;
+	}
+	else
+		state.bindTexture2D( entry.id );
+
+	// compressed levels are uploaded in rows of 4x4 blocks
+	const TextureImage::Level& level( image.levels[ entry.uploadedLevel ] );
+	unsigned unitRows = image.rowsPerUnit();
+	std::size_t rowSize = image.rowSize( level );
+	unsigned units = ( level.height - entry.uploadedRows + unitRows - 1 ) / unitRows;
+	if ( budget / rowSize < units )
+		units = budget / rowSize > 0 ? unsigned( budget / rowSize ) : 1;
+
+	unsigned rows = std::min( units * unitRows, level.height - entry.uploadedRows );
+	std::size_t size = units * rowSize;
+	const unsigned char* pRows = &image.data[ level.offset + entry.uploadedRows / unitRows * rowSize ];
+	const unsigned char* pSource = pRows;
+
+	if ( m_bPixelBufferObject )
+	{
+		// a fresh buffer store each time, so the driver never waits for the previous transfer
+		if ( !m_buffer )
+			ext.genBuffers( 1, &m_buffer );
+		ext.bindBuffer( GL_PIXEL_UNPACK_BUFFER, m_buffer );
+		if ( size > m_bufferSize )
+			m_bufferSize = size;
+		ext.bufferData( GL_PIXEL_UNPACK_BUFFER, m_bufferSize, 0, GL_STREAM_DRAW );
+		void* pBuffer = ext.mapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+		if ( pBuffer )
+		{
+			memcpy( pBuffer, pRows, size );
+			ext.unmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+			pSource = 0;
+		}
+		else
+			ext.bindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	}
+
+	if ( image.bCompressed )
+		ext.compressedTexSubImage2D( GL_TEXTURE_2D, entry.uploadedLevel, 0, entry.uploadedRows, level.width, rows, image.format, 
+			GLsizei( size ), pSource );
+	else
+		glTexSubImage2D( GL_TEXTURE_2D, 0, 0, entry.uploadedRows, level.width, rows, image.format, GL_UNSIGNED_BYTE, pSource );
+
+	if ( !pSource )
+		ext.bindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	entry.uploadedRows += rows;
+	if ( entry.uploadedRows == level.height )
+	{
+		entry.uploadedLevel++;
+		entry.uploadedRows = 0;
+	}
+	return size;
+}
+
+
+GLuint TextureManager::placeholder( GLStateCache& state )
+{
+	if ( !m_placeholder )
+	{
+		static const unsigned char white[ 3 ] = { 255, 255, 255 };
+		glGenTextures( 1, &m_placeholder );
+		state.bindTexture2D( m_placeholder );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, white );
+	}
+	return m_placeholder;
+}
+
+
+void TextureManager::clear( GLStateCache& state, const GLExtensions& ext )
+{
+	for ( std::map< std::string, Handle >::iterator it = m_entries.begin(); it != m_entries.end(); it++ )
+		if ( it->second->id )
+		{
+			state.deleteTextures( 1, &it->second->id );
+			it->second->id = 0;
+			it->second->bReady = false;
+		}
+	m_entries.clear();
+	m_pending.clear();
+
+	if ( m_placeholder )
+		state.deleteTextures( 1, &m_placeholder );
+	m_placeholder = 0;
+
+	if ( m_buffer )
+		ext.deleteBuffers( 1, &m_buffer );
+	m_buffer = 0;
+	m_bufferSize = 0;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,178 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Asynchronous loading of texture files.
+ */
+
+#ifndef __TextureManager_h_INCLUDED__
+#define __TextureManager_h_INCLUDED__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+
+#include "GLExtensions.h"
+#include "GLStateCache.h"
+#include "TextureImage.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Loads texture files without stalling the render thread.
+ *
+ * Files are decoded by a worker thread. The pixels are then uploaded by update(), 
+ * which the render thread calls once per frame. Each call uploads at most the budget
+ * of bytes, in bands of rows through a pixel buffer object where supported, so a large 
+ * texture is spread over several frames. Mipmaps are generated by the GPU once the last
+ * band has arrived. Until then, a white placeholder texture is bound instead.
+ *
+ * If the context supports S3TC, the worker compresses the textures to DXT1 or DXT5 including 
+ * all mipmap levels, and stores the result next to the file as <file>.dds. Later runs read
+ * that file instead, as long as the source has not changed.
+ *
+ * One manager exists per GL context. All methods except the constructor, the destructor
+ * and setBudget() must be called on the thread that renders the context.
+ */
+class TextureManager
+{
+protected:
+	struct Entry;
+
+public:
+
+	/** texture of one file with one wrap mode, shared by all users */
+	typedef boost::shared_ptr< Entry > Handle;
+
+	TextureManager();
+
+	/** stops the worker thread */
+	~TextureManager();
+
+	/** stops the worker thread, after which the wakeup function is no longer called by it */
+	void stop();
+
+	/** 
+	 * records the capabilities of the context, called once the context is current
+	 * @param wakeup called from any thread when update() has work to do in the next frame
+	 */
+	void init( const GLExtensions& ext, boost::function< void() > wakeup );
+
+	/** maximum number of bytes uploaded per update(), 0 to upload whole textures at once */
+	void setBudget( std::size_t bytes );
+
+	/** enables S3TC compression of textures where the context supports it, on by default */
+	void setCompression( bool bCompression );
+
+	/** starts loading a texture, or returns the texture loaded before for the same file and wrap mode */
+	Handle request( const std::string& url, bool bRepeatS, bool bRepeatT );
+
+	/** texture name to bind, the placeholder while the texture is not complete or could not be loaded */
+	GLuint name( GLStateCache& state, const Handle& handle );
+
+	/** uploads decoded textures within the budget, called once per frame before drawing */
+	void update( GLStateCache& state, const GLExtensions& ext );
+
+	/** true while textures are decoded or uploaded */
+	bool busy();
+
+	/** deletes all textures and buffers, they are loaded again on the next request */
+	void clear( GLStateCache& state, const GLExtensions& ext );
+
+protected:
+
+	struct Entry
+	{
+		std::string url;
+		bool bRepeatS;
+		bool bRepeatT;
+
+		/** set by the worker, guarded by the mutex */
+		bool bDecoded;
+		bool bFailed;
+		TextureImage image;
+
+		/** used by the render thread only */
+		GLuint id;
+		bool bReady;
+		unsigned uploadedLevel;
+		unsigned uploadedRows;
+	};
+
+	/** main loop of the worker thread */
+	void decodeLoop();
+
+	/** reads an image file, or its compressed version from the disk cache. Called by the worker. */
+	bool decode( const std::string& url, TextureImage& image );
+
+	/** uploads the next band of rows of a texture level, returns the number of bytes */
+	std::size_t upload( GLStateCache& state, const GLExtensions& ext, Entry& entry, std::size_t budget );
+
+	/** white 1x1 texture */
+	GLuint placeholder( GLStateCache& state );
+
+	/** all textures by file and wrap mode */
+	std::map< std::string, Handle > m_entries;
+
+	/** textures being decoded or uploaded, in order of request. Render thread only. */
+	std::deque< Handle > m_pending;
+
+	/** guards the decode queue and the decoded state of the entries */
+	boost::mutex m_mutex;
+	boost::condition m_decodeRequest;
+	std::deque< Handle > m_decodeQueue;
+	bool m_bStop;
+	boost::scoped_ptr< boost::thread > m_pWorker;
+
+	boost::function< void() > m_wakeup;
+	std::size_t m_budget;
+	bool m_bCompression;
+
+	bool m_bPixelBufferObject;
+	bool m_bNonPowerOfTwo;
+	bool m_bGenerateMipmap;
+	bool m_bTextureCompressionS3TC;
+
+	GLuint m_placeholder;
+
+	/** staging buffer of the uploads */
+	GLuint m_buffer;
+	std::size_t m_bufferSize;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
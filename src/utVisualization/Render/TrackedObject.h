@@ -26,6 +26,8 @@
 
 #include <boost/scoped_ptr.hpp>
 #include "RenderModule.h"
+#include "PosePredictor.h"
+#include "FrameValue.h"
 
 namespace Ubitrack { namespace Drivers {
 
@@ -34,6 +36,11 @@ namespace Ubitrack { namespace Drivers {
  * @ingroup driver_components
  * Base class for tracked objects. 
  * Implements push and pull ports and sets the model-view matrix.
+ *
+ * With posePrediction="velocity", poses from the push input are extrapolated
+ * to the expected display time of the frame. The prediction horizon is given
+ * by predictionHorizon in milliseconds, or measured from the frame latency of
+ * the window if it is negative or not set.
  */
 class TrackedObject
 	: public VirtualObject
@@ -50,7 +57,12 @@ public:
 	TrackedObject( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 		: VirtualObject( name, subgraph, componentKey, pModule )
+		, m_pushedPose( m_frameInputs )
+		, m_bPredict( subgraph->m_DataflowAttributes.getAttributeString( "posePrediction" ) == "velocity" )
+		, m_predictionHorizon( -1 )
 	{
+		subgraph->m_DataflowAttributes.getAttributeData( "predictionHorizon", m_predictionHorizon );
+
 		if ( subgraph->hasEdge( "Input" ) )
 		{
 			// new behaviour (Input port is either push or pull)
@@ -58,13 +70,13 @@ public:
 			if ( pEdge->hasAttribute( "mode" ) && pEdge->getAttributeString( "mode" ) == "pull" )
 				m_pPull.reset( new PullConsumer< Ubitrack::Measurement::Pose >( "Input", *this ) );
 			else
-				m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Pose >( "Input", *this, boost::bind( &TrackedObject::poseIn, this, _1, 1 ) ) );
+				m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Pose >( "Input", *this, boost::bind( &TrackedObject::poseIn, this, _1 ) ) );
 		}
 		else
 		{
 			// legacy behaviour (two separate ports for push and pull)
 			m_pPull.reset( new PullConsumer< Ubitrack::Measurement::Pose >( "PullInput", *this ) );
-			m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Pose >( "PushInput", *this, boost::bind( &TrackedObject::poseIn, this, _1, 1 ) ) );
+			m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Pose >( "PushInput", *this, boost::bind( &TrackedObject::poseIn, this, _1 ) ) );
 		}
 	}
 
@@ -77,59 +89,124 @@ public:
 	/** render the object, if up-to-date tracking information is available */
 	virtual void draw( Measurement::Timestamp& t, int parity )
 	{
-		if ( m_pPull && m_pPull->isConnected() ) 
-			poseIn( m_pPull->get( t ), 0 );
+		Math::Pose pose;
+		if ( !currentPose( t, pose ) || !isInView( pose ) )
+			return;
 
-		// remove object if no measurements in the last second
-		// TODO: make this configurable
-		if (t > m_lastUpdateTime + 1000000000L) return;
+		drawAt( t, parity, pose );
+	}
 
+	/** sets the model-view matrix for a pose and calls draw3DContent() */
+	void drawAt( Measurement::Timestamp& t, int parity, const Math::Pose& pose )
+	{
 		glMatrixMode( GL_MODELVIEW );
 		glPushMatrix();
-		{
-			boost::mutex::scoped_lock l( m_poseLock );
-			glMultMatrixd( m_pose );
-		}
+		Ubitrack::Math::Matrix< double, 4, 4 > m( pose.rotation(), pose.translation() );
+		glMultMatrixd( m.content() );
 
 		draw3DContent( t, parity );
 		
 		glPopMatrix();
 	}
 
+	/**
+	 * the pose at which the object is drawn in the current frame
+	 * @return false if there is no pose or the last one is older than a second, the object is not drawn then
+	 */
+	bool currentPose( Measurement::Timestamp& t, Math::Pose& pose )
+	{
+		if ( m_pPull && m_pPull->isConnected() ) 
+		{
+			Measurement::Pose pulled( m_pPull->get( t ) );
+			m_lastUpdateTime = pulled.time();
+			pose = *pulled;
+		}
+		else
+		{
+			const Measurement::Pose& pushed = m_pushedPose.get();
+			if ( !pushed ) return false;
+			m_lastUpdateTime = pushed.time();
+
+			if ( m_bPredict )
+			{
+				// extrapolate at most 100ms to limit the error when the input stalls
+				m_predictor.add( pushed );
+				pose = m_predictor.predict( displayTime(), 100000000L );
+			}
+			else
+				pose = *pushed;
+		}
+
+		// remove object if no measurements in the last second
+		// TODO: make this configurable
+		return t <= m_lastUpdateTime + 1000000000L;
+	}
+
+	/**
+	 * Bounding box of what draw3DContent() draws, in object coordinates. Objects that declare one 
+	 * are not drawn while they are outside the view frustum.
+	 * @return 0 if the extent is unknown, the object is always drawn then
+	 */
+	virtual const BoundingBox* bounds()
+	{ return 0; }
+
+	/** false if the object at the given pose is outside the view frustum of the current pass */
+	bool isInView( const Math::Pose& pose )
+	{
+		const BoundingBox* pBounds = bounds();
+		return !pBounds || m_pModule->frustum().isVisible( pose, *pBounds );
+	}
+
 	virtual bool hasWaitingEvents()
 	{
 		return m_pPush && m_pPush->getQueuedEvents() > 0;
 	}
 
+	/** changes with every pushed pose and when the object disappears, always for pulled or predicted poses */
+	virtual unsigned long generation()
+	{
+		if ( ( m_pPull && m_pPull->isConnected() ) || m_bPredict )
+			return generationAlwaysChanged;
+
+		const Measurement::Pose& pushed = m_pushedPose.get();
+		bool bExpired = pushed && m_pModule->frameStartTime() > pushed.time() + 1000000000L;
+		return 2 * m_frameInputs.generation() + ( bExpired ? 1 : 0 );
+	}
+
 protected:
 
+	/** expected time at which the frame that is currently drawn is displayed */
+	Measurement::Timestamp displayTime() const
+	{
+		Measurement::Timestamp horizon = m_predictionHorizon >= 0 ? 
+			Measurement::Timestamp( m_predictionHorizon * 1e6 ) : m_pModule->frameLatency();
+		return m_pModule->frameStartTime() + horizon;
+	}
+
 	/**
-	 * callback from Pose port
+	 * callback from the Pose push port
 	 * @param pose current transformation
-	 * @param redraw trigger a redraw? (only if called from push-input)
 	 */
-	void poseIn( const Ubitrack::Measurement::Pose& pose, int redraw )
+	void poseIn( const Ubitrack::Measurement::Pose& pose )
 	{
-		m_lastUpdateTime = pose.time();
-		Ubitrack::Math::Matrix< double, 4, 4 > m( pose->rotation(), pose->translation() );
-		double* tmp =  m.content();
-
-		boost::mutex::scoped_lock l( m_poseLock );
-		for ( int i = 0; i < 16; i++ ) m_pose[i] = tmp[i];
+		m_pushedPose.write( pose );
 
 		// the pose has changed, so redraw the world
-		if (redraw) { 
-			LOG4CPP_DEBUG( logger, "TrackedObject: calling invalidate()" );
-			m_pModule->invalidate();
-		}
+		LOG4CPP_DEBUG( logger, "TrackedObject: calling invalidate()" );
+		m_pModule->invalidate();
 	}
 
 	// pose input
 	boost::scoped_ptr< PushConsumer< Ubitrack::Measurement::Pose > > m_pPush;
 	boost::scoped_ptr< PullConsumer< Ubitrack::Measurement::Pose > > m_pPull;
 
-	double m_pose[16];
-	boost::mutex m_poseLock;
+	// pose from the push input, frozen for the current frame
+	FrameValue< Ubitrack::Measurement::Pose > m_pushedPose;
+
+	// prediction of pushed poses, used by the render thread only
+	PosePredictor m_predictor;
+	bool m_bPredict;
+	double m_predictionHorizon;
 };
 
 
@@ -41,10 +41,10 @@ namespace Ubitrack { namespace Drivers {
 Transparency::Transparency( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph,
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_alpha( m_frameInputs, 0.5 )
 {
-	LOG4CPP_DEBUG( logger, "Transparency::Transparency(), initialize alpha to " << alpha );
+	LOG4CPP_DEBUG( logger, "Transparency::Transparency(), initialize alpha to " << m_alpha.get() );
 
-	alpha = 0.5;
 	m_pPush.reset( new PushConsumer< Ubitrack::Measurement::Distance >( "Input", *this, boost::bind( &Transparency::alphaIn, this, _1 ) ) );
 }
 
@@ -59,12 +59,13 @@ void Transparency::draw( Measurement::Timestamp& t, int parity )
 //added win32-guard by CW (16.7.2012): gl-functions seem to be unavailable on windows systems
 #ifndef WIN32 
 #ifdef HAVE_GLEW
+	double alpha = m_alpha.get();
 	LOG4CPP_DEBUG( logger, "Transparency::draw(), set alpha to " << alpha << " for timestamp " << t );
 
 	// Enable global transparency for the virtual scene. This affects
 	// all render components except the BackgroundVideo component.
 	glBlendColor ( 0.0, 0.0, 0.0, alpha );
-	glBlendFunc ( GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA );
+	m_pModule->glState().blendFunc( GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA );
 #else
 	LOG4CPP_ERROR( logger, "Transparency::draw() has no effect since 'glew' is not installed" );
 #endif
@@ -76,20 +77,26 @@ void Transparency::draw( Measurement::Timestamp& t, int parity )
 void Transparency::alphaIn( const Ubitrack::Measurement::Distance &a ) 
 {
 	if ( *a < 0.0 )
-		alpha = 0.0;
+		m_alpha.write( 0.0 );
 	else if ( *a > 1.0 )
-		alpha = 1.0;
+		m_alpha.write( 1.0 );
 	else
-		alpha = *a;
+		m_alpha.write( *a );
 
 	LOG4CPP_DEBUG( logger, "Transparency::alphaIn() " << a );
+
+	m_pModule->invalidate( this );
 }
 
 
 bool Transparency::hasWaitingEvents()
 {
-	LOG4CPP_DEBUG( logger, "Transparency::hasWaitingEvents(), return " << (m_pPush && m_pPush->getQueuedEvents() > 0) );
-	return 1;
+	return m_pPush && m_pPush->getQueuedEvents() > 0;
+}
+
+unsigned long Transparency::generation()
+{
+	return m_frameInputs.generation();
 }
 
 
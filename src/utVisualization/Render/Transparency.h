@@ -66,6 +66,8 @@ public:
 	/** check if there are events waiting for this component */
 	virtual bool hasWaitingEvents();
 
+	virtual unsigned long generation();
+
 protected:
 	/**
 	 * Callback from Distance port
@@ -74,8 +76,8 @@ protected:
 	 */
 	void alphaIn( const Ubitrack::Measurement::Distance &a );
 
-	/** internal alpha value */
-	Math::Scalar< double > alpha;
+	/** alpha value, frozen for the current frame */
+	FrameValue< double > m_alpha;
 
 	/** alpha value input */
 	boost::scoped_ptr< PushConsumer< Ubitrack::Measurement::Distance > > m_pPush;
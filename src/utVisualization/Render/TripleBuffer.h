@@ -0,0 +1,112 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Lock-free handoff of the latest value from a dataflow thread to the render thread.
+ */
+
+#ifndef __TripleBuffer_h_INCLUDED__
+#define __TripleBuffer_h_INCLUDED__
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Single-producer, single-consumer cell that passes the latest value of an input to the render thread.
+ *
+ * The writer fills its own buffer and swaps it with the middle one, the reader swaps
+ * the middle buffer with its own if it is newer. Neither side ever waits for the other,
+ * values that are overwritten before the reader fetches them are dropped.
+ *
+ * Only one thread may call write(), and only one (other) thread update() and read().
+ */
+template< class T >
+class TripleBuffer
+	: private boost::noncopyable
+{
+public:
+
+	TripleBuffer()
+		: m_middle( 1 )
+		, m_writeIndex( 0 )
+		, m_readIndex( 2 )
+	{}
+
+	/** @param initial value returned by read() until the first update */
+	TripleBuffer( const T& initial )
+		: m_middle( 1 )
+		, m_writeIndex( 0 )
+		, m_readIndex( 2 )
+	{
+		for ( int i = 0; i < 3; i++ )
+			m_buffers[ i ] = initial;
+	}
+
+	/** publishes a new value, called by the writer thread */
+	void write( const T& value )
+	{
+		m_buffers[ m_writeIndex ] = value;
+		m_writeIndex = m_middle.exchange( m_writeIndex | freshFlag, boost::memory_order_acq_rel ) & indexMask;
+	}
+
+	/**
+	 * fetches the latest published value, called by the reader thread
+	 * @return true if a new value has been written since the last call
+	 */
+	bool update()
+	{
+		if ( !( m_middle.load( boost::memory_order_acquire ) & freshFlag ) )
+			return false;
+
+		m_readIndex = m_middle.exchange( m_readIndex, boost::memory_order_acq_rel ) & indexMask;
+		return true;
+	}
+
+	/** the value fetched by the last update(), the initial value before the first one */
+	const T& read() const
+	{ return m_buffers[ m_readIndex ]; }
+
+protected:
+
+	enum { indexMask = 3, freshFlag = 4 };
+
+	T m_buffers[ 3 ];
+
+	/** index of the buffer between writer and reader, with freshFlag set if it holds an unread value */
+	boost::atomic< unsigned > m_middle;
+
+	/** buffers owned by the writer and the reader */
+	unsigned m_writeIndex;
+	unsigned m_readIndex;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
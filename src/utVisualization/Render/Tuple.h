@@ -23,5 +23,9 @@ template< typename Type > bool operator!=( const Tuple<Type>& self, const Tuple<
 	return ((self.a != other.a) || (self.b != other.b));
 }
 
+template< typename Type > bool operator==( const Tuple<Type>& self, const Tuple<Type> &other) {
+	return !(self != other);
+}
+
 #endif
 
@@ -30,6 +30,8 @@ namespace Ubitrack { namespace Drivers {
 VectorfieldViewer::VectorfieldViewer( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: TrackedObject( name, subgraph, componentKey, pModule )
+	, m_arrows( GL_LINES )
+	, m_points( GL_POINTS )
 {
 	// load object path
 	/*Graph::UTQLSubgraph::NodePtr objectNode = subgraph->getNode( "Object" );
@@ -56,25 +58,30 @@ VectorfieldViewer::VectorfieldViewer( const std::string& name, boost::shared_ptr
 	}
 }
 
-/** render the object, if up-to-date tracking information is available */
-void VectorfieldViewer::draw3DContent( Measurement::Timestamp& t, int parity )
+void VectorfieldViewer::glInit()
 {
 	double scale = 0.05;
 	double offset = -0.10;
 	int size = m_pos.size();
-	glColor4f(1.0,0.0,0.0,1.0);
-	glBegin(GL_LINES);
+	m_arrows.clear();
+	m_points.clear();
 	for (int i = 0; i < size; i++) {
-		glVertex3d( m_pos[i][0], m_pos[i][1]+offset, m_pos[i][2] );
-		glVertex3d( m_pos[i][0]+m_val[i][0]*scale, m_pos[i][1]+offset+m_val[i][1]*scale, m_pos[i][2]+m_val[i][2]*scale );
+		float x = (float)m_pos[i][0], y = (float)( m_pos[i][1]+offset ), z = (float)m_pos[i][2];
+		m_arrows.vertex( x, y, z );
+		m_arrows.vertex( (float)( x+m_val[i][0]*scale ), (float)( y+m_val[i][1]*scale ), (float)( z+m_val[i][2]*scale ) );
+		m_points.vertex( x, y, z );
 	}
-	glEnd();
+}
+
+
+/** render the object, if up-to-date tracking information is available */
+void VectorfieldViewer::draw3DContent( Measurement::Timestamp& t, int parity )
+{
+	glColor4f(1.0,0.0,0.0,1.0);
+	drawGeometry( m_arrows );
 
-	glPointSize( 3.0 );
-	glBegin(GL_POINTS);
-	for (int i = 0; i < size; i++) 
-		glVertex3d( m_pos[i][0], m_pos[i][1]+offset, m_pos[i][2] );
-	glEnd();
+	m_pModule->glState().pointSize( 3.0 );
+	drawGeometry( m_points );
 }
 
 } } // namespace Ubitrack::Drivers
@@ -25,7 +25,6 @@
 #define __VectorfieldViewer_h_INCLUDED__
 
 #include "TrackedObject.h"
-#include "X3DRender.h"
 
 namespace Ubitrack { namespace Drivers {
 
@@ -50,6 +49,9 @@ public:
 	VectorfieldViewer( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
+	/** builds the meshes of the field */
+	virtual void glInit();
+
 	/** render the object, if up-to-date tracking information is available */
 	virtual void draw3DContent( Measurement::Timestamp& t, int parity );
 
@@ -58,6 +60,12 @@ protected:
 	// X3D parsing/rendering
 	std::vector< Math::Vector< double, 3 > > m_pos;
 	std::vector< Math::Vector< double, 3 > > m_val;
+
+	/** one line per vector */
+	GLGeometry m_arrows;
+
+	/** the positions of the vectors */
+	GLGeometry m_points;
 };
 
 
@@ -31,7 +31,60 @@
 
 #include "WorldFrame.h"
 
+#include <math.h>
+
 namespace Ubitrack { namespace Drivers {	
+
+namespace {
+
+/** adds the lines of a cone like glutWireCone() with its base at the given offset on an axis, pointing outwards */
+void addWireCone( GLGeometry& geometry, int axis, float offset, float base, float height, unsigned slices, unsigned stacks )
+{
+	const float pi = 3.14159265f;
+	float p[ 3 ];
+
+	// circles of the stacks
+	for ( unsigned i = 0; i < stacks; i++ )
+	{
+		float r = base * ( 1.0f - float( i ) / stacks );
+		p[ axis ] = offset + height * i / stacks;
+		GLuint first = 0;
+		for ( unsigned j = 0; j < slices; j++ )
+		{
+			p[ ( axis + 1 ) % 3 ] = r * cos( 2 * pi * j / slices );
+			p[ ( axis + 2 ) % 3 ] = r * sin( 2 * pi * j / slices );
+			GLuint v = geometry.vertex( p[ 0 ], p[ 1 ], p[ 2 ] );
+			if ( j == 0 )
+				first = v;
+			geometry.index( v );
+			geometry.index( j + 1 < slices ? v + 1 : first );
+		}
+	}
+
+	// lines from the base to the tip
+	p[ axis ] = offset + height;
+	p[ ( axis + 1 ) % 3 ] = p[ ( axis + 2 ) % 3 ] = 0;
+	GLuint tip = geometry.vertex( p[ 0 ], p[ 1 ], p[ 2 ] );
+	p[ axis ] = offset;
+	for ( unsigned j = 0; j < slices; j++ )
+	{
+		p[ ( axis + 1 ) % 3 ] = base * cos( 2 * pi * j / slices );
+		p[ ( axis + 2 ) % 3 ] = base * sin( 2 * pi * j / slices );
+		geometry.index( geometry.vertex( p[ 0 ], p[ 1 ], p[ 2 ] ) );
+		geometry.index( tip );
+	}
+}
+
+/** adds a line from a to b */
+void addLine( GLGeometry& geometry, float ax, float ay, float az, float bx, float by, float bz )
+{
+	geometry.index( geometry.vertex( ax, ay, az ) );
+	geometry.index( geometry.vertex( bx, by, bz ) );
+}
+
+} // anonymous namespace
+
+
 WorldFrame::WorldFrame( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph,
 						const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: TrackedObject( name, subgraph, componentKey, pModule )
@@ -40,6 +93,8 @@ WorldFrame::WorldFrame( const std::string& name, boost::shared_ptr< Graph::UTQLS
 	, m_size ( 1 )
 	, m_thickness ( 0.5 )
 	, m_bInitialized ( false )
+	, m_axes( GL_LINES, GLGeometry::colors )
+	, m_grid( GL_LINES )
 {
 	// read parameters
 	Graph::UTQLSubgraph::NodePtr objectNode = subgraph->getNode( "Object" );
@@ -81,86 +136,57 @@ WorldFrame::~WorldFrame()
 }
 
 
+void WorldFrame::glInit()
+{
+	const float CONE1 = 200;
+	const float CONE2 = 270;
+	float len = float( m_size / 2 );
+	float size = float( m_size );
+
+	m_axes.clear();
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		float p[ 3 ] = { 0, 0, 0 };
+		m_axes.color( axis == 0 ? 1.0f : 0.0f, axis == 1 ? 1.0f : 0.0f, axis == 2 ? 1.0f : 0.0f, 1.0f );
+
+		p[ axis ] = -len;
+		GLuint from = m_axes.vertex( p[ 0 ], p[ 1 ], p[ 2 ] );
+		p[ axis ] = len;
+		m_axes.index( from );
+		m_axes.index( m_axes.vertex( p[ 0 ], p[ 1 ], p[ 2 ] ) );
+
+		addWireCone( m_axes, axis, len, size / CONE1, size / CONE2, 10, 10 );
+	}
+
+	//the dash lines
+	m_grid.clear();
+	for(float i=len/(float)m_width;i<len;i+=len/(float)m_width)
+		addLine( m_grid, i, 0.0f, -len, i, 0.0f, len );
+	for(float i=-len/(float)m_width;i>-len;i-=len/(float)m_width)
+		addLine( m_grid, i, 0.0f, -len, i, 0.0f, len );
+	for(float i=len/(float)m_height;i<len;i+=len/(float)m_height)
+		addLine( m_grid, -len, 0.0f, i, len, 0.0f, i );
+	for(float i=-len/(float)m_height;i>-len;i-=len/(float)m_height)
+		addLine( m_grid, -len, 0.0f, i, len, 0.0f, i );
+}
+
+
 void WorldFrame::draw3DContent( Measurement::Timestamp& t, int )
 {             
-	int CONE1 = 200;
-	int CONE2 = 270;
-	double len = m_size/2;
-
-	glEnable ( GL_LINE_SMOOTH );
-	
-	//x
-	glColor4f( 1.0, 0.0, 0.0, 1.0 );
-	glBegin(GL_LINES);
-	glVertex3f((float)-len,0.0f,0.0f);
-	glVertex3f((float)len,0.0f,0.0f);
-	glEnd();
-
-	glPushMatrix();
-	glTranslatef((float)len,0.0,0.0f);
-	glRotatef(90.0f,0.0f,90.0f,0.0f);
-	glutWireCone((float)(m_size/CONE1),(float)(m_size/CONE2),10.0f,10.0f);
-	glPopMatrix();
-
-	//y
-	glColor4f( 0.0, 1.0, 0.0, 1.0 );
-	glBegin(GL_LINES);
-	glVertex3f(0.0f,(float)-len,0.0f);
-	glVertex3f(0.0f,(float)len,0.0f);
-	glEnd();
-
-	glPushMatrix();
-	glTranslatef(0.0f,(float)len,0.0f);
-	glRotatef(90.0f,-1.0f,0.0f,0.0f);
-	glutWireCone((float)(m_size/CONE1),(float)(m_size/CONE2),10.0f,10.0f);
-	glPopMatrix();
-
-	//z
-	glColor4f( 0.0, 0.0, 1.0, 1.0 );
-	glBegin(GL_LINES);
-	glVertex3f(0,0,(float)-len);
-	glVertex3f(0,0,(float)len);
-	glEnd();
-
-	glPushMatrix();
-	glTranslatef(0,0,(float)len);
-	glutWireCone(m_size/CONE1,m_size/CONE2,10,10);
-	glPopMatrix();
+	GLStateCache& state = m_pModule->glState();
+	state.enable( GL_LINE_SMOOTH );
+
+	drawGeometry( m_axes );
 
 	//draw the dash lines
-	glLineWidth( (float)m_thickness );
+	state.lineWidth( (float)m_thickness );
 	glColor4f( (float)m_rgba[0], (float)m_rgba[1], (float)m_rgba[2], (float)m_rgba[3] );
-	for(float i=(float)len/m_width;i<len;(float)(i+=(float)len/m_width)){
-		glEnable(GL_LINE_STIPPLE);
-		glLineStipple (0, 0x0F0F);
-		glBegin(GL_LINES);
-		glVertex3f(i,0.0f,(float)-len);
-		glVertex3f(i,0.0f,(float)len);
-		glEnd();
-	}
-	for(float i=-(float)len/m_width;i>-len;(float)(i-=(float)len/m_width)){
-		glEnable(GL_LINE_STIPPLE);
-		glLineStipple (0, 0x0F0F);
-		glBegin(GL_LINES);
-		glVertex3f(i,0.0f,(float)-len);
-		glVertex3f(i,0.0f,(float)len);
-		glEnd();
-	}
-	for(float i=(float)len/m_height;i<len;(float)(i+=(float)len/m_height)){
-		glBegin(GL_LINES);
-		glVertex3f((float)-len,0.0,i);
-		glVertex3f((float)len,0.0,i);
-		glEnd();
-	}
-	for(float i=-(float)len/m_height;i>-len;(float)(i-=(float)len/m_height)){
-		glBegin(GL_LINES);
-		glVertex3f((float)-len,0.0,i);
-		glVertex3f((float)len,0.0,i);
-		glEnd();
-	 }
-	 glDisable(GL_LINE_STIPPLE);
-
-	 glDisable ( GL_LINE_SMOOTH );
+	state.enable( GL_LINE_STIPPLE );
+	glLineStipple (0, 0x0F0F);
+	drawGeometry( m_grid );
+	state.disable( GL_LINE_STIPPLE );
+
+	state.disable( GL_LINE_SMOOTH );
 }
 
 } } // namespace Ubitrack::Drivers
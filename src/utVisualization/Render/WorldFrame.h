@@ -61,6 +61,9 @@ public:
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
 	~WorldFrame();
+
+	/** builds the meshes of the axes and the grid */
+	virtual void glInit();
 		
 	/** render the object */
 	virtual void draw3DContent( Measurement::Timestamp&, int );
@@ -77,6 +80,12 @@ protected:
 	double m_rgba[4];
 	bool m_bInitialized;
 	int time;
+
+	/** colored axes with cones at their tips */
+	GLGeometry m_axes;
+
+	/** dashed grid lines in the x/z-plane */
+	GLGeometry m_grid;
 };
 
 
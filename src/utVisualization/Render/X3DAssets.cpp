@@ -0,0 +1,239 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Sharing of compiled X3D scenes between components and windows.
+ */
+
+#include "X3DAssets.h"
+#include "X3DCache.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.X3DAssets" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+
+X3DAssets& X3DAssets::instance()
+{
+	static X3DAssets assets;
+	return assets;
+}
+
+
+std::string X3DAssets::canonicalPath( const std::string& path )
+{
+#ifdef _WIN32
+	char buffer[ _MAX_PATH ];
+	if ( _fullpath( buffer, path.c_str(), _MAX_PATH ) )
+		return buffer;
+#else
+	if ( char* pResolved = realpath( path.c_str(), 0 ) )
+	{
+		std::string result( pResolved );
+		free( pResolved );
+		return result;
+	}
+#endif
+	return path;
+}
+
+
+boost::shared_ptr< const X3DScene > X3DAssets::load( const std::string& path, bool bCache, const std::string& cacheDir, bool bStream )
+{
+	std::string canonical( canonicalPath( path ) );
+	X3DCache::SourceKey key;
+	if ( !X3DCache::sourceKey( canonical, key, false ) )
+	{
+		LOG4CPP_ERROR( logger, "Could not read X3D file " << path );
+		return boost::shared_ptr< const X3DScene >( new X3DScene );
+	}
+
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+
+		// scenes without users have been freed already, only their entries are left
+		for ( std::map< std::string, Entry >::iterator it = m_entries.begin(); it != m_entries.end(); )
+			if ( !it->second.bLoading && it->second.pScene.expired() )
+			{
+				LOG4CPP_DEBUG( logger, "Evicted " << it->first );
+				m_entries.erase( it++ );
+			}
+			else
+				it++;
+
+		// another component loading the same model is waited for
+		std::map< std::string, Entry >::iterator existing;
+		while ( ( existing = m_entries.find( canonical ) ) != m_entries.end() && existing->second.bLoading )
+			m_loaded.wait( l );
+
+		// unchanged file, no need to read it
+		if ( existing != m_entries.end() && existing->second.size == key.size && existing->second.time == key.time )
+			if ( boost::shared_ptr< const X3DScene > pScene = existing->second.pScene.lock() )
+			{
+				LOG4CPP_DEBUG( logger, "Sharing " << canonical );
+				return pScene;
+			}
+
+		Entry& entry( m_entries[ canonical ] );
+		entry = Entry();
+		entry.bLoading = true;
+	}
+
+	// a touched or copied file with the same content
+	bool bHashed = false;
+	boost::shared_ptr< const X3DScene > pShared( findCopy( canonical, key, bHashed ) );
+
+	boost::shared_ptr< X3DScene > pScene;
+	bool bLoaded = pShared.get() != 0;
+	if ( !pShared )
+	{
+		pScene.reset( new X3DScene );
+		pShared = pScene;
+		try
+		{
+			X3DCache cache( cacheDir );
+			bLoaded = bCache && cache.load( path, *pScene );
+			if ( !bLoaded )
+			{
+				bLoaded = pScene->load( path, bStream );
+				if ( bLoaded && bCache )
+					cache.store( path, *pScene );
+			}
+		}
+		catch ( ... )
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			m_entries.erase( canonical );
+			m_loaded.notify_all();
+			throw;
+		}
+	}
+
+	boost::mutex::scoped_lock l( m_mutex );
+	if ( bLoaded )
+	{
+		Entry& entry( m_entries[ canonical ] );
+		entry.pScene = pShared;
+		entry.size = key.size;
+		entry.time = key.time;
+		entry.hash = key.hash;
+		entry.bHashed = bHashed;
+		entry.bLoading = false;
+	}
+	else
+	{
+		// failures are not remembered, so the next component tries again
+		m_entries.erase( canonical );
+	}
+	m_loaded.notify_all();
+	return pShared;
+}
+
+
+boost::shared_ptr< const X3DScene > X3DAssets::findCopy( const std::string& canonical, X3DCache::SourceKey& key, bool& bHashed )
+{
+	// only files of the same size are hashed
+	std::vector< std::string > candidates;
+	{
+		boost::mutex::scoped_lock l( m_mutex );
+		for ( std::map< std::string, Entry >::iterator it = m_entries.begin(); it != m_entries.end(); it++ )
+			if ( !it->second.bLoading && it->second.size == key.size && it->first != canonical && !it->second.pScene.expired() )
+				candidates.push_back( it->first );
+	}
+	if ( candidates.empty() || !X3DCache::hashFile( canonical, key.hash ) )
+		return boost::shared_ptr< const X3DScene >();
+	bHashed = true;
+
+	for ( std::vector< std::string >::iterator it = candidates.begin(); it != candidates.end(); it++ )
+	{
+		Entry candidate;
+		{
+			boost::mutex::scoped_lock l( m_mutex );
+			std::map< std::string, Entry >::iterator found = m_entries.find( *it );
+			if ( found == m_entries.end() || found->second.bLoading )
+				continue;
+			candidate = found->second;
+		}
+
+		// the hash of a candidate is computed from its file, which must not have changed since it was loaded
+		if ( !candidate.bHashed )
+		{
+			X3DCache::SourceKey candidateKey;
+			if ( !X3DCache::sourceKey( *it, candidateKey, false ) || candidateKey.size != candidate.size || 
+				candidateKey.time != candidate.time || !X3DCache::hashFile( *it, candidate.hash ) )
+				continue;
+
+			boost::mutex::scoped_lock l( m_mutex );
+			std::map< std::string, Entry >::iterator found = m_entries.find( *it );
+			if ( found != m_entries.end() && !found->second.bLoading && found->second.time == candidate.time )
+			{
+				found->second.hash = candidate.hash;
+				found->second.bHashed = true;
+			}
+		}
+
+		if ( candidate.hash == key.hash )
+			if ( boost::shared_ptr< const X3DScene > pScene = candidate.pScene.lock() )
+			{
+				LOG4CPP_INFO( logger, "Sharing " << *it << " for " << canonical << " of the same content" );
+				return pScene;
+			}
+	}
+	return boost::shared_ptr< const X3DScene >();
+}
+
+
+X3DContextAssets::ResourcesPtr X3DContextAssets::acquire( const boost::shared_ptr< const X3DScene >& pScene )
+{
+	Entry& entry( m_entries[ pScene.get() ] );
+	if ( !entry.pResources )
+	{
+		entry.pScene = pScene;
+		entry.pResources.reset( new X3DScene::Resources );
+		entry.users = 0;
+	}
+	entry.users++;
+	return entry.pResources;
+}
+
+
+void X3DContextAssets::release( const X3DScene* pScene, const GLExtensions& ext )
+{
+	std::map< const X3DScene*, Entry >::iterator it = m_entries.find( pScene );
+	if ( it == m_entries.end() || --it->second.users > 0 )
+		return;
+
+	it->second.pResources->release( ext );
+	m_entries.erase( it );
+}
+
+
+} } // namespace Ubitrack::Drivers
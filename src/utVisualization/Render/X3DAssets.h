@@ -0,0 +1,158 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Sharing of compiled X3D scenes between components and windows.
+ */
+
+#ifndef __X3DAssets_h_INCLUDED__
+#define __X3DAssets_h_INCLUDED__
+
+#include <string>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+
+#include "X3DScene.h"
+#include "X3DCache.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Process-wide cache of compiled X3D scenes.
+ *
+ * All X3DObjects of all windows that show the same model share one X3DScene. Models are
+ * identified by their canonical path, and by their content hash if the file has changed or 
+ * another path is seen, so copies of a model are only compiled once as well. The cache only 
+ * holds weak references: a scene is freed as soon as the last component that uses it is destroyed.
+ * Thread-safe, different models are loaded in parallel and concurrent loads of one model wait for the first.
+ */
+class X3DAssets
+{
+public:
+
+	/** the instance of the process */
+	static X3DAssets& instance();
+
+	/**
+	 * Returns the scene of a model, loading it if no other component uses it.
+	 * @param path file name of the model
+	 * @param bCache read and write the binary cache file of the model
+	 * @param cacheDir directory of the cache files, empty to store them next to the model
+	 * @param bStream parse with the streaming reader instead of the DOM
+	 * @return the shared scene, an empty scene if the model could not be read
+	 */
+	boost::shared_ptr< const X3DScene > load( const std::string& path, bool bCache, const std::string& cacheDir, bool bStream );
+
+protected:
+
+	X3DAssets()
+	{}
+
+	/** absolute path without links, the given path if it cannot be resolved */
+	static std::string canonicalPath( const std::string& path );
+
+	struct Entry
+	{
+		Entry()
+			: size( 0 )
+			, time( 0 )
+			, hash( 0 )
+			, bHashed( false )
+			, bLoading( false )
+		{}
+
+		boost::weak_ptr< const X3DScene > pScene;
+
+		/** size and modification time of the file when it was loaded */
+		boost::uint64_t size;
+		boost::int64_t time;
+
+		/** content hash, only computed once a file of the same size is loaded */
+		boost::uint64_t hash;
+		bool bHashed;
+
+		/** the model is being loaded by a thread that does not hold the mutex */
+		bool bLoading;
+	};
+
+	/** returns a loaded scene of another path with the same content, or 0 */
+	boost::shared_ptr< const X3DScene > findCopy( const std::string& canonical, X3DCache::SourceKey& key, bool& bHashed );
+
+	/** by canonical path */
+	std::map< std::string, Entry > m_entries;
+
+	/** protects the entries, but is not held while a file is hashed or loaded */
+	boost::mutex m_mutex;
+
+	/** signalled when a load has finished */
+	boost::condition m_loaded;
+};
+
+
+/**
+ * @ingroup driver_components
+ * GL resources of the shared scenes in one context, counted by the components that draw them.
+ *
+ * The first component that draws a scene creates its resources, the last one that is cleaned up
+ * deletes them, so a model shown by several components of a window is uploaded once.
+ * One instance exists per VirtualCamera, all methods must be called on its render thread.
+ */
+class X3DContextAssets
+{
+public:
+
+	typedef boost::shared_ptr< X3DScene::Resources > ResourcesPtr;
+
+	/** returns the resources of a scene and counts one more user */
+	ResourcesPtr acquire( const boost::shared_ptr< const X3DScene >& pScene );
+
+	/** counts one user less, the buffers are deleted when none is left */
+	void release( const X3DScene* pScene, const GLExtensions& ext );
+
+protected:
+
+	struct Entry
+	{
+		/** keeps the arrays alive that the buffers are filled from */
+		boost::shared_ptr< const X3DScene > pScene;
+		ResourcesPtr pResources;
+		unsigned users;
+	};
+
+	std::map< const X3DScene*, Entry > m_entries;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -0,0 +1,465 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Binary cache files of compiled X3D scenes.
+ */
+
+#include "X3DCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.X3DCache" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+namespace {
+
+/** increase when the layout of the file or the output of the X3D compiler changes */
+const boost::uint32_t g_cacheVersion = 2;
+
+const char g_cacheMagic[ 8 ] = { 'U', 'T', 'X', '3', 'D', 'C', '\r', '\n' };
+
+/** written as is, so files from machines with a different byte order are detected */
+const boost::uint32_t g_byteOrder = 0x01020304;
+
+/** 
+ * Start of a cache file. The sections follow at the given offsets, 8-byte aligned:
+ * vertices, indices, items, textures and a table of the strings of items and textures.
+ */
+struct CacheHeader
+{
+	char magic[ 8 ];
+	boost::uint32_t byteOrder;
+	boost::uint32_t version;
+
+	boost::uint64_t sourceSize;
+	boost::int64_t sourceTime;
+	boost::uint64_t sourceHash;
+
+	boost::uint32_t stride;
+	boost::uint32_t vertexCount;
+	boost::uint32_t indexCount;
+	boost::uint32_t itemCount;
+	boost::uint32_t textureCount;
+	boost::uint32_t bBackground;
+	float background[ 4 ];
+
+	boost::uint64_t vertexOffset;
+	boost::uint64_t indexOffset;
+	boost::uint64_t itemOffset;
+	boost::uint64_t textureOffset;
+	boost::uint64_t stringOffset;
+	boost::uint64_t stringSize;
+};
+
+struct CacheItem
+{
+	double transform[ 16 ];
+	float color[ 4 ];
+	boost::int32_t type;
+	boost::int32_t bColor;
+	boost::int32_t texture;
+	boost::uint32_t first;
+	boost::uint32_t count;
+	boost::uint32_t textOffset;
+	boost::uint32_t textLength;
+	boost::uint32_t lodFirst[ X3DScene::lodLevels - 1 ];
+	boost::uint32_t lodCount[ X3DScene::lodLevels - 1 ];
+	float lodError[ X3DScene::lodLevels - 1 ];
+};
+
+struct CacheTexture
+{
+	boost::uint32_t urlOffset;
+	boost::uint32_t urlLength;
+	boost::uint32_t bRepeatS;
+	boost::uint32_t bRepeatT;
+};
+
+/** rounds up to the alignment of the sections */
+boost::uint64_t align( boost::uint64_t offset )
+{ return ( offset + 7 ) & ~boost::uint64_t( 7 ); }
+
+/** appends a string to the string table and returns its offset */
+boost::uint32_t addString( std::string& table, const std::string& s )
+{
+	boost::uint32_t offset = table.size();
+	table += s;
+	return offset;
+}
+
+/** writes a section at its offset, padding the file up to it */
+void writeSection( std::ofstream& file, boost::uint64_t offset, const void* data, boost::uint64_t size )
+{
+	static const char padding[ 8 ] = { 0 };
+	boost::uint64_t position = file.tellp();
+	if ( offset > position )
+		file.write( padding, std::streamsize( offset - position ) );
+	if ( size )
+		file.write( static_cast< const char* >( data ), std::streamsize( size ) );
+}
+
+/** replaces a file by a completely written temporary one */
+bool replaceFile( const std::string& temporary, const std::string& path )
+{
+	// rename() does not replace existing files on Windows
+	std::remove( path.c_str() );
+	if ( std::rename( temporary.c_str(), path.c_str() ) != 0 )
+	{
+		LOG4CPP_WARN( logger, "Could not rename " << temporary << " to " << path );
+		std::remove( temporary.c_str() );
+		return false;
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+
+X3DCache::X3DCache( const std::string& directory )
+	: m_directory( directory )
+{
+}
+
+
+std::string X3DCache::cachePath( const std::string& model ) const
+{
+	if ( m_directory.empty() )
+		return model + ".cache";
+
+	// models with the same name in different directories must not share a file
+	std::string::size_type slash = model.find_last_of( "/\\" );
+	std::string name = slash == std::string::npos ? model : model.substr( slash + 1 );
+
+	boost::uint64_t hash = 14695981039346656037ULL;
+	for ( std::string::const_iterator it = model.begin(); it != model.end(); it++ )
+		hash = ( hash ^ (unsigned char)*it ) * 1099511628211ULL;
+
+	std::ostringstream path;
+	path << m_directory;
+	char last = m_directory[ m_directory.size() - 1 ];
+	if ( last != '/' && last != '\\' )
+		path << '/';
+	path << name << '.' << std::hex << hash << ".cache";
+	return path.str();
+}
+
+
+bool X3DCache::hashFile( const std::string& file, boost::uint64_t& hash )
+{
+	std::ifstream in( file.c_str(), std::ios::in | std::ios::binary );
+	if ( !in )
+		return false;
+
+	hash = 14695981039346656037ULL;
+	std::vector< char > buffer( 1 << 20 );
+	while ( in )
+	{
+		in.read( &buffer[ 0 ], buffer.size() );
+		std::streamsize n = in.gcount();
+		for ( std::streamsize i = 0; i < n; i++ )
+			hash = ( hash ^ (unsigned char)buffer[ i ] ) * 1099511628211ULL;
+	}
+	return true;
+}
+
+
+bool X3DCache::sourceKey( const std::string& model, SourceKey& key, bool bHash )
+{
+	struct stat status;
+	if ( stat( model.c_str(), &status ) != 0 )
+		return false;
+
+	key.size = boost::uint64_t( status.st_size );
+	key.time = boost::int64_t( status.st_mtime );
+	key.hash = 0;
+	return !bHash || hashFile( model, key.hash );
+}
+
+
+bool X3DCache::load( const std::string& model, X3DScene& scene )
+{
+	SourceKey key;
+	if ( !sourceKey( model, key, false ) )
+		return false;
+
+	std::string path( cachePath( model ) );
+	boost::shared_ptr< boost::interprocess::mapped_region > pRegion;
+	try
+	{
+		boost::interprocess::file_mapping mapping( path.c_str(), boost::interprocess::read_only );
+		pRegion.reset( new boost::interprocess::mapped_region( mapping, boost::interprocess::read_only ) );
+	}
+	catch ( const boost::interprocess::interprocess_exception& )
+	{
+		LOG4CPP_DEBUG( logger, "No cache " << path << " for " << model );
+		return false;
+	}
+
+	const char* pData = static_cast< const char* >( pRegion->get_address() );
+	boost::uint64_t size = pRegion->get_size();
+	const CacheHeader* pHeader = reinterpret_cast< const CacheHeader* >( pData );
+	if ( size < sizeof( CacheHeader ) || memcmp( pHeader->magic, g_cacheMagic, sizeof( g_cacheMagic ) ) != 0 || 
+		pHeader->byteOrder != g_byteOrder || pHeader->version != g_cacheVersion || pHeader->stride != scene.m_mesh.stride() )
+	{
+		LOG4CPP_INFO( logger, "Ignoring cache " << path << " of an incompatible format" );
+		return false;
+	}
+
+	// all sections must be inside the file
+	if ( pHeader->vertexOffset + boost::uint64_t( pHeader->vertexCount ) * pHeader->stride * sizeof( float ) > size ||
+		pHeader->indexOffset + boost::uint64_t( pHeader->indexCount ) * sizeof( GLuint ) > size ||
+		pHeader->itemOffset + boost::uint64_t( pHeader->itemCount ) * sizeof( CacheItem ) > size ||
+		pHeader->textureOffset + boost::uint64_t( pHeader->textureCount ) * sizeof( CacheTexture ) > size ||
+		pHeader->stringOffset + pHeader->stringSize > size )
+	{
+		LOG4CPP_WARN( logger, "Ignoring truncated cache " << path );
+		return false;
+	}
+
+	// a model that was only touched or copied is recognized by its content
+	bool bTouched = false;
+	if ( pHeader->sourceSize != key.size || pHeader->sourceTime != key.time )
+	{
+		if ( pHeader->sourceSize != key.size || !sourceKey( model, key, true ) || pHeader->sourceHash != key.hash )
+		{
+			LOG4CPP_INFO( logger, "Cache " << path << " is out of date" );
+			return false;
+		}
+		bTouched = true;
+	}
+
+	// indices are passed to GL unchecked, one outside the vertices would read beyond the mapped file
+	const GLuint* pIndices = reinterpret_cast< const GLuint* >( pData + pHeader->indexOffset );
+	for ( boost::uint32_t i = 0; i < pHeader->indexCount; i++ )
+		if ( pIndices[ i ] >= pHeader->vertexCount )
+		{
+			LOG4CPP_WARN( logger, "Ignoring corrupt cache " << path << ", index " << pIndices[ i ] << " is out of range" );
+			return false;
+		}
+
+	const char* pStrings = pData + pHeader->stringOffset;
+	std::vector< X3DScene::Texture > textures( pHeader->textureCount );
+	const CacheTexture* pTextures = reinterpret_cast< const CacheTexture* >( pData + pHeader->textureOffset );
+	for ( unsigned i = 0; i < textures.size(); i++ )
+	{
+		if ( boost::uint64_t( pTextures[ i ].urlOffset ) + pTextures[ i ].urlLength > pHeader->stringSize )
+			return false;
+		textures[ i ].url.assign( pStrings + pTextures[ i ].urlOffset, pTextures[ i ].urlLength );
+		textures[ i ].bRepeatS = pTextures[ i ].bRepeatS != 0;
+		textures[ i ].bRepeatT = pTextures[ i ].bRepeatT != 0;
+	}
+
+	std::vector< X3DScene::Item > items( pHeader->itemCount );
+	const CacheItem* pItems = reinterpret_cast< const CacheItem* >( pData + pHeader->itemOffset );
+	for ( unsigned i = 0; i < items.size(); i++ )
+	{
+		const CacheItem& cached( pItems[ i ] );
+		if ( boost::uint64_t( cached.textOffset ) + cached.textLength > pHeader->stringSize ||
+			boost::uint64_t( cached.first ) + cached.count > pHeader->indexCount || cached.texture >= int( textures.size() ) )
+			return false;
+
+		X3DScene::Item& item( items[ i ] );
+		item.type = cached.type == X3DScene::Item::typeText ? X3DScene::Item::typeText : X3DScene::Item::typeMesh;
+		memcpy( item.transform, cached.transform, sizeof( item.transform ) );
+		item.bColor = cached.bColor != 0;
+		memcpy( item.color, cached.color, sizeof( item.color ) );
+		item.texture = cached.texture;
+		item.first = cached.first;
+		item.count = cached.count;
+		for ( unsigned j = 0; j < X3DScene::lodLevels - 1; j++ )
+		{
+			if ( boost::uint64_t( cached.lodFirst[ j ] ) + cached.lodCount[ j ] > pHeader->indexCount )
+				return false;
+			item.lodFirst[ j ] = cached.lodFirst[ j ];
+			item.lodCount[ j ] = cached.lodCount[ j ];
+			item.lodError[ j ] = cached.lodError[ j ];
+		}
+		item.text.assign( pStrings + cached.textOffset, cached.textLength );
+	}
+
+	// the mesh is used straight from the mapped file
+	scene.m_mesh.assign( reinterpret_cast< const float* >( pData + pHeader->vertexOffset ), pHeader->vertexCount,
+		reinterpret_cast< const GLuint* >( pData + pHeader->indexOffset ), pHeader->indexCount );
+	scene.m_pStorage = pRegion;
+	scene.m_items.swap( items );
+	scene.m_textures.swap( textures );
+	scene.m_bBackground = pHeader->bBackground != 0;
+	memcpy( scene.m_background, pHeader->background, sizeof( scene.m_background ) );
+	scene.finish();
+
+	LOG4CPP_INFO( logger, "Loaded " << model << " from cache " << path << ": " << scene.m_items.size() << " draw items, " << 
+		pHeader->vertexCount << " vertices, " << pHeader->indexCount / 3 << " triangles" );
+
+	// otherwise the model is hashed again on every load
+	if ( bTouched )
+		updateSource( path, pData, size, key );
+	return true;
+}
+
+
+bool X3DCache::updateSource( const std::string& path, const char* pData, boost::uint64_t size, const SourceKey& key )
+{
+	CacheHeader header;
+	memcpy( &header, pData, sizeof( header ) );
+	header.sourceSize = key.size;
+	header.sourceTime = key.time;
+
+	// the scene keeps using the mapping of the old file, which stays valid when it is replaced
+	std::string temporary( path + ".tmp" );
+	{
+		std::ofstream file( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		writeSection( file, 0, &header, sizeof( header ) );
+		writeSection( file, sizeof( header ), pData + sizeof( header ), size - sizeof( header ) );
+		if ( !file )
+		{
+			LOG4CPP_WARN( logger, "Could not write cache " << temporary );
+			file.close();
+			std::remove( temporary.c_str() );
+			return false;
+		}
+	}
+
+	if ( !replaceFile( temporary, path ) )
+		return false;
+
+	LOG4CPP_DEBUG( logger, "Updated the source time in cache " << path );
+	return true;
+}
+
+
+bool X3DCache::store( const std::string& model, const X3DScene& scene )
+{
+	CacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+
+	SourceKey key;
+	if ( !sourceKey( model, key, true ) )
+		return false;
+
+	std::string strings;
+	std::vector< CacheTexture > textures( scene.m_textures.size() );
+	for ( unsigned i = 0; i < textures.size(); i++ )
+	{
+		textures[ i ].urlOffset = addString( strings, scene.m_textures[ i ].url );
+		textures[ i ].urlLength = scene.m_textures[ i ].url.size();
+		textures[ i ].bRepeatS = scene.m_textures[ i ].bRepeatS;
+		textures[ i ].bRepeatT = scene.m_textures[ i ].bRepeatT;
+	}
+
+	std::vector< CacheItem > items( scene.m_items.size() );
+	for ( unsigned i = 0; i < items.size(); i++ )
+	{
+		const X3DScene::Item& item( scene.m_items[ i ] );
+		CacheItem& cached( items[ i ] );
+		memset( &cached, 0, sizeof( cached ) );
+		memcpy( cached.transform, item.transform, sizeof( cached.transform ) );
+		memcpy( cached.color, item.color, sizeof( cached.color ) );
+		cached.type = item.type;
+		cached.bColor = item.bColor;
+		cached.texture = item.texture;
+		cached.first = item.first;
+		cached.count = item.count;
+		for ( unsigned j = 0; j < X3DScene::lodLevels - 1; j++ )
+		{
+			cached.lodFirst[ j ] = item.lodFirst[ j ];
+			cached.lodCount[ j ] = item.lodCount[ j ];
+			cached.lodError[ j ] = item.lodError[ j ];
+		}
+		cached.textOffset = addString( strings, item.text );
+		cached.textLength = item.text.size();
+	}
+
+	const GLGeometry& mesh( scene.m_mesh );
+	memcpy( header.magic, g_cacheMagic, sizeof( g_cacheMagic ) );
+	header.byteOrder = g_byteOrder;
+	header.version = g_cacheVersion;
+	header.sourceSize = key.size;
+	header.sourceTime = key.time;
+	header.sourceHash = key.hash;
+	header.stride = mesh.stride();
+	header.vertexCount = mesh.vertexCount();
+	header.indexCount = mesh.indexCount();
+	header.itemCount = items.size();
+	header.textureCount = textures.size();
+	header.bBackground = scene.m_bBackground;
+	memcpy( header.background, scene.m_background, sizeof( scene.m_background ) );
+
+	header.vertexOffset = align( sizeof( header ) );
+	header.indexOffset = align( header.vertexOffset + boost::uint64_t( header.vertexCount ) * header.stride * sizeof( float ) );
+	header.itemOffset = align( header.indexOffset + boost::uint64_t( header.indexCount ) * sizeof( GLuint ) );
+	header.textureOffset = align( header.itemOffset + items.size() * sizeof( CacheItem ) );
+	header.stringOffset = align( header.textureOffset + textures.size() * sizeof( CacheTexture ) );
+	header.stringSize = strings.size();
+
+	// write a temporary file first, so a crash never leaves a truncated cache behind
+	std::string path( cachePath( model ) );
+	std::string temporary( path + ".tmp" );
+	{
+		std::ofstream file( temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+		if ( !file )
+		{
+			LOG4CPP_WARN( logger, "Could not write cache " << temporary );
+			return false;
+		}
+
+		writeSection( file, 0, &header, sizeof( header ) );
+		writeSection( file, header.vertexOffset, mesh.vertexData(), boost::uint64_t( header.vertexCount ) * header.stride * sizeof( float ) );
+		writeSection( file, header.indexOffset, mesh.indexData(), boost::uint64_t( header.indexCount ) * sizeof( GLuint ) );
+		writeSection( file, header.itemOffset, items.empty() ? 0 : &items[ 0 ], items.size() * sizeof( CacheItem ) );
+		writeSection( file, header.textureOffset, textures.empty() ? 0 : &textures[ 0 ], textures.size() * sizeof( CacheTexture ) );
+		writeSection( file, header.stringOffset, strings.data(), strings.size() );
+
+		if ( !file )
+		{
+			LOG4CPP_WARN( logger, "Could not write cache " << temporary );
+			file.close();
+			std::remove( temporary.c_str() );
+			return false;
+		}
+	}
+
+	if ( !replaceFile( temporary, path ) )
+		return false;
+
+	LOG4CPP_INFO( logger, "Wrote cache " << path << " for " << model );
+	return true;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,104 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Binary cache files of compiled X3D scenes.
+ */
+
+#ifndef __X3DCache_h_INCLUDED__
+#define __X3DCache_h_INCLUDED__
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include "X3DScene.h"
+
+namespace Ubitrack { namespace Drivers {
+
+
+/**
+ * @ingroup driver_components
+ * Stores compiled X3D scenes in binary files that are memory-mapped on later runs.
+ *
+ * A cache file holds the interleaved vertices, the indices, the draw items and the
+ * texture table of an X3DScene. It is valid as long as the model has the same size and
+ * modification time, or the same content hash if only the time has changed. The mesh
+ * is uploaded straight from the mapped file, so loading a cached model costs little more
+ * than reading it from disk. Files are written in the byte order of the machine and are
+ * rejected on a mismatch or a different format version.
+ */
+class X3DCache
+{
+public:
+
+	/** @param directory where cache files are stored, empty to store them next to the models */
+	X3DCache( const std::string& directory );
+
+	/**
+	 * Loads the scene of a model from its cache file.
+	 * @return false if there is no valid cache, the scene is unchanged then
+	 */
+	bool load( const std::string& model, X3DScene& scene );
+
+	/**
+	 * Writes the cache file of a model, replacing an existing one.
+	 * @return false if the file could not be written
+	 */
+	bool store( const std::string& model, const X3DScene& scene );
+
+	/** name of the cache file of a model */
+	std::string cachePath( const std::string& model ) const;
+
+	/** identifies the content of a model file */
+	struct SourceKey
+	{
+		boost::uint64_t size;
+		boost::int64_t time;
+		boost::uint64_t hash;
+	};
+
+	/**
+	 * Reads size and modification time of a file.
+	 * @param bHash also compute the content hash, which reads the whole file
+	 */
+	static bool sourceKey( const std::string& model, SourceKey& key, bool bHash );
+
+	/** 64-bit FNV-1a hash of the file content */
+	static bool hashFile( const std::string& file, boost::uint64_t& hash );
+
+protected:
+
+	/** rewrites a valid cache file with the modification time of a model that was touched but not changed */
+	bool updateSource( const std::string& path, const char* pData, boost::uint64_t size, const SourceKey& key );
+
+	std::string m_directory;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -29,6 +29,9 @@ X3DObject::X3DObject( const std::string& name, boost::shared_ptr< Graph::UTQLSub
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: TrackedObject( name, subgraph, componentKey, pModule )
 	, m_occlusionOnly( false )
+	, m_bInstanceable( false )
+	, m_lodTolerance( 1.0 )
+	, m_level( 0 )
 {
 	// load object path
 	Graph::UTQLSubgraph::NodePtr objectNode = subgraph->getNode( "Object" );
@@ -42,31 +45,83 @@ X3DObject::X3DObject( const std::string& name, boost::shared_ptr< Graph::UTQLSub
 	if ( objectNode->hasAttribute( "occlusionOnly" ) && objectNode->getAttribute( "occlusionOnly" ).getText() == "true" )
 		m_occlusionOnly = true;
 		
-	// load x3d
-	m_doc = boost::shared_ptr< TiXmlDocument >( new TiXmlDocument( path ) );
-	m_x3d = boost::shared_ptr< X3DRender >( new X3DRender() );
-	m_doc->LoadFile();
+	// compiled scenes are cached next to the model unless another directory is given
+	bool bCache = !objectNode->hasAttribute( "virtualObjectCache" ) || objectNode->getAttribute( "virtualObjectCache" ).getText() != "false";
+	std::string cacheDir;
+	if ( objectNode->hasAttribute( "virtualObjectCacheDir" ) )
+		cacheDir = objectNode->getAttribute( "virtualObjectCacheDir" ).getText();
+
+	objectNode->getAttributeData( "virtualObjectLodTolerance", m_lodTolerance );
+
+	// the DOM reader is kept for comparison and for files the streaming reader does not understand
+	bool bStream = !objectNode->hasAttribute( "virtualObjectParser" ) || objectNode->getAttribute( "virtualObjectParser" ).getText() != "dom";
+	m_pScene = X3DAssets::instance().load( path, bCache, cacheDir, bStream );
+
+	// text is drawn with GLUT, which cannot be instanced and is not initialized for headless cameras
+	m_bInstanceable = !m_pScene->empty() && m_pScene->isInstanceable();
+	if ( pModule->isHeadless() && !m_pScene->isInstanceable() )
+		UBITRACK_THROW( "X3D Text nodes in " + path + " cannot be drawn by a headless virtual camera" );
+}
+
+void X3DObject::draw( Measurement::Timestamp& t, int parity )
+{
+	Math::Pose pose;
+	if ( !currentPose( t, pose ) || !isInView( pose ) )
+		return;
+
+	// the detail level follows the size of the bounding sphere on the screen
+	if ( m_pScene->levels() > 1 && m_pScene->isBounded() )
+		m_level = m_pScene->level( m_pModule->frustum().pixelsPerUnit( pose, m_pScene->bounds() ), m_lodTolerance, m_level );
+
+	if ( !queuesInstances() )
+	{
+		drawAt( t, parity, pose );
+		return;
+	}
+
+	if ( !m_pResources )
+		m_pResources = m_pModule->x3dAssets().acquire( m_pScene );
+	m_pModule->instances().add( m_pModule->frustum().modelView(), *m_pScene, *m_pResources, m_occlusionOnly, pose, m_level );
+}
+
+
+const BoundingBox* X3DObject::bounds()
+{
+	return m_pScene->isBounded() ? &m_pScene->bounds() : 0;
 }
 
+
+bool X3DObject::queuesInstances()
+{
+	return m_bInstanceable && m_pModule->instances().isEnabled();
+}
+
+
 /** render the object, if up-to-date tracking information is available */
 void X3DObject::draw3DContent( Measurement::Timestamp& t, int parity )
 {
-	// Remember old blend mode
-	GLboolean blendMode[4];
-	
+	GLStateCache& state = m_pModule->glState();
+	state.push();
+
 	LOG4CPP_DEBUG( logger, "X3DObject::draw3DContent() for timestamp " << t );
 	// render only into z-buffer?
 	if ( m_occlusionOnly ) 
-	{
-		glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
-		glGetBooleanv(GL_COLOR_WRITEMASK, blendMode);
-	}
+		state.colorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
 
-	m_doc->Accept( m_x3d.get() );
+	if ( !m_pResources )
+		m_pResources = m_pModule->x3dAssets().acquire( m_pScene );
+	m_pScene->draw( state, m_pModule->glExtensions(), m_pModule->textures(), *m_pResources, m_level );
 
-	// Reset old blend mode
-	if ( m_occlusionOnly ) 
-		glColorMask( blendMode[0], blendMode[1], blendMode[2], blendMode[3] );
+	// Reset old color mask and the texture state of the scene
+	state.pop();
+}
+
+
+void X3DObject::glCleanup()
+{
+	if ( m_pResources )
+		m_pModule->x3dAssets().release( m_pScene.get(), m_pModule->glExtensions() );
+	m_pResources.reset();
 }
 
 } } // namespace Ubitrack::Drivers
@@ -25,7 +25,7 @@
 #define __X3DObject_h_INCLUDED__
 
 #include "TrackedObject.h"
-#include "X3DRender.h"
+#include "X3DAssets.h"
 
 namespace Ubitrack { namespace Drivers {
 
@@ -50,17 +50,40 @@ public:
 	X3DObject( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 		const VirtualObjectKey& componentKey, VirtualCamera* pModule );
 
+	/** chooses the detail level, then queues the pose for instanced drawing or draws the object like other tracked objects */
+	virtual void draw( Measurement::Timestamp& t, int parity );
+
 	/** render the object, if up-to-date tracking information is available */
 	virtual void draw3DContent( Measurement::Timestamp& t, int parity );
 
+	/** bounding box of the scene, 0 for scenes with text or a background */
+	virtual const BoundingBox* bounds();
+
+	/** true if the module draws the object together with the others showing the same model */
+	virtual bool queuesInstances();
+
+	/** releases the buffers and textures of the scene */
+	virtual void glCleanup();
+
 protected:
 
 	// render only into z-buffer for occlusion objects?
 	bool m_occlusionOnly;
 
-	// X3D parsing/rendering
-	boost::shared_ptr< TiXmlDocument > m_doc;
-	boost::shared_ptr< X3DRender     > m_x3d;
+	// the scene can be drawn by the InstanceRenderer of the module
+	bool m_bInstanceable;
+
+	// allowed error of a simplified level in pixels, 0 to always draw the full model
+	double m_lodTolerance;
+
+	// detail level of the last frame, changed by X3DScene::level() with hysteresis
+	unsigned m_level;
+
+	// the compiled X3D file, shared with all components showing the same model
+	boost::shared_ptr< const X3DScene > m_pScene;
+
+	// buffers and textures of the scene in the context of the module, 0 until first drawn
+	X3DContextAssets::ResourcesPtr m_pResources;
 };
 
 
@@ -0,0 +1,587 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Streaming reader for X3D files and fast parsing of number lists.
+ */
+
+#include "X3DReader.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace Ubitrack { namespace Drivers {
+
+namespace {
+
+/** lists shorter than this are parsed by the calling thread only */
+const std::size_t g_chunkSize = 256 * 1024;
+
+inline bool isDigit( char c )
+{ return c >= '0' && c <= '9'; }
+
+/** separators of X3D number lists */
+inline bool isSeparator( char c )
+{ return c == ' ' || c == ',' || c == '\n' || c == '\r' || c == '\t'; }
+
+inline bool isSpace( char c )
+{ return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+inline const char* skipSeparators( const char* p, const char* end )
+{
+	while ( p != end && isSeparator( *p ) )
+		p++;
+	return p;
+}
+
+/**
+ * Parses a decimal floating point number that ends at a separator or the end of the input.
+ * The digits are collected in an integer, so the result is exact for up to 15 significant
+ * digits and exponents up to 22, which covers about all numbers written by modeling tools.
+ * @return the end of the number, 0 if it is invalid
+ */
+const char* parseValue( const char* p, const char* end, double& value )
+{
+	static const double powers[ 23 ] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	bool bNegative = false;
+	if ( p != end && ( *p == '-' || *p == '+' ) )
+		bNegative = *p++ == '-';
+
+	boost::uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool bDigits = false;
+
+	// further digits beyond the precision of the mantissa only change the exponent
+	for ( ; p != end && isDigit( *p ); p++ )
+	{
+		bDigits = true;
+		if ( digits < 19 )
+		{
+			mantissa = mantissa * 10 + ( *p - '0' );
+			if ( mantissa )
+				digits++;
+		}
+		else
+			exponent++;
+	}
+
+	if ( p != end && *p == '.' )
+		for ( p++; p != end && isDigit( *p ); p++ )
+		{
+			bDigits = true;
+			if ( digits < 19 )
+			{
+				mantissa = mantissa * 10 + ( *p - '0' );
+				if ( mantissa )
+					digits++;
+				exponent--;
+			}
+		}
+
+	if ( !bDigits )
+		return 0;
+
+	if ( p != end && ( *p == 'e' || *p == 'E' ) )
+	{
+		p++;
+		bool bNegativeExponent = false;
+		if ( p != end && ( *p == '-' || *p == '+' ) )
+			bNegativeExponent = *p++ == '-';
+		if ( p == end || !isDigit( *p ) )
+			return 0;
+
+		int e = 0;
+		for ( ; p != end && isDigit( *p ); p++ )
+			if ( e < 10000 )
+				e = e * 10 + ( *p - '0' );
+		exponent += bNegativeExponent ? -e : e;
+	}
+
+	if ( p != end && !isSeparator( *p ) )
+		return 0;
+
+	double result = double( mantissa );
+	if ( exponent != 0 && mantissa != 0 )
+	{
+		if ( mantissa < ( boost::uint64_t( 1 ) << 53 ) && exponent >= -22 && exponent <= 22 )
+			result = exponent < 0 ? result / powers[ -exponent ] : result * powers[ exponent ];
+		else
+			result *= pow( 10.0, exponent );
+	}
+
+	value = bNegative ? -result : result;
+	return p;
+}
+
+const char* parseValue( const char* p, const char* end, float& value )
+{
+	double d;
+	p = parseValue( p, end, d );
+	value = float( d );
+	return p;
+}
+
+const char* parseValue( const char* p, const char* end, int& value )
+{
+	bool bNegative = false;
+	if ( p != end && ( *p == '-' || *p == '+' ) )
+		bNegative = *p++ == '-';
+	if ( p == end || !isDigit( *p ) )
+		return 0;
+
+	boost::int64_t result = 0;
+	for ( ; p != end && isDigit( *p ); p++ )
+		if ( result <= 0x7fffffff )
+			result = result * 10 + ( *p - '0' );
+	if ( p != end && !isSeparator( *p ) )
+		return 0;
+
+	if ( result > 0x7fffffff )
+		result = 0x7fffffff;
+	value = int( bNegative ? -result : result );
+	return p;
+}
+
+/** parses one chunk of a list, run by a worker thread for long lists */
+template< class Type > void parseChunk( const char* p, const char* end, std::vector< Type >* pValues, bool* pValid )
+{
+	// a number takes at least two characters with its separator
+	pValues->reserve( pValues->size() + ( end - p ) / 2 );
+	*pValid = true;
+
+	Type value;
+	for ( p = skipSeparators( p, end ); p != end; p = skipSeparators( p, end ) )
+	{
+		p = parseValue( p, end, value );
+		if ( !p )
+		{
+			*pValid = false;
+			return;
+		}
+		pValues->push_back( value );
+	}
+}
+
+template< class Type > bool parseList( const char* begin, const char* end, std::vector< Type >& values )
+{
+	std::size_t chunks = ( end - begin ) / g_chunkSize;
+	std::size_t threads = boost::thread::hardware_concurrency();
+	if ( chunks > threads )
+		chunks = threads;
+	if ( chunks < 2 )
+	{
+		bool bValid;
+		parseChunk( begin, end, &values, &bValid );
+		return bValid;
+	}
+
+	// split at separators, so no number is cut in two
+	std::vector< const char* > bounds( 1, begin );
+	for ( std::size_t i = 1; i < chunks; i++ )
+	{
+		const char* p = begin + ( end - begin ) * i / chunks;
+		if ( p < bounds.back() )
+			p = bounds.back();
+		while ( p != end && !isSeparator( *p ) )
+			p++;
+		bounds.push_back( p );
+	}
+	bounds.push_back( end );
+
+	std::vector< std::vector< Type > > results( chunks );
+	std::vector< char > valid( chunks );
+	boost::thread_group workers;
+	for ( std::size_t i = 1; i < chunks; i++ )
+		workers.create_thread( boost::bind( &parseChunk< Type >, bounds[ i ], bounds[ i + 1 ], &results[ i ], 
+			reinterpret_cast< bool* >( &valid[ i ] ) ) );
+	parseChunk( bounds[ 0 ], bounds[ 1 ], &results[ 0 ], reinterpret_cast< bool* >( &valid[ 0 ] ) );
+	workers.join_all();
+
+	// the chunks after an invalid number are dropped, like a sequential parser would stop there
+	std::size_t size = values.size();
+	for ( std::size_t i = 0; i < chunks; i++ )
+		size += results[ i ].size();
+	values.reserve( size );
+	for ( std::size_t i = 0; i < chunks; i++ )
+	{
+		values.insert( values.end(), results[ i ].begin(), results[ i ].end() );
+		if ( !valid[ i ] )
+			return false;
+	}
+	return true;
+}
+
+/** compares a string that is not null-terminated */
+inline bool equals( const char* begin, const char* end, const char* s )
+{
+	std::size_t length = strlen( s );
+	return std::size_t( end - begin ) == length && memcmp( begin, s, length ) == 0;
+}
+
+/** finds a string in [p, end), returns end if it does not occur */
+const char* find( const char* p, const char* end, const char* s )
+{
+	std::size_t length = strlen( s );
+	while ( std::size_t( end - p ) >= length )
+	{
+		const char* q = static_cast< const char* >( memchr( p, s[ 0 ], end - p - length + 1 ) );
+		if ( !q )
+			break;
+		if ( memcmp( q, s, length ) == 0 )
+			return q;
+		p = q + 1;
+	}
+	return end;
+}
+
+/** returns the position after the next occurrence of s, 0 if it does not occur */
+const char* skipPast( const char* p, const char* end, const char* s )
+{
+	const char* q = find( p, end, s );
+	return q == end ? 0 : q + strlen( s );
+}
+
+inline bool startsWith( const char* p, const char* end, const char* s )
+{
+	std::size_t length = strlen( s );
+	return std::size_t( end - p ) >= length && memcmp( p, s, length ) == 0;
+}
+
+inline bool isNameEnd( char c )
+{ return isSpace( c ) || c == '/' || c == '>' || c == '='; }
+
+/** appends a character as UTF-8 */
+void appendUtf8( std::string& s, unsigned long c )
+{
+	if ( c < 0x80 )
+		s += char( c );
+	else if ( c < 0x800 )
+	{
+		s += char( 0xc0 | ( c >> 6 ) );
+		s += char( 0x80 | ( c & 0x3f ) );
+	}
+	else if ( c < 0x10000 )
+	{
+		s += char( 0xe0 | ( c >> 12 ) );
+		s += char( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+		s += char( 0x80 | ( c & 0x3f ) );
+	}
+	else
+	{
+		s += char( 0xf0 | ( c >> 18 ) );
+		s += char( 0x80 | ( ( c >> 12 ) & 0x3f ) );
+		s += char( 0x80 | ( ( c >> 6 ) & 0x3f ) );
+		s += char( 0x80 | ( c & 0x3f ) );
+	}
+}
+
+} // anonymous namespace
+
+
+unsigned parseNumbers( const char* begin, const char* end, double* values, unsigned n )
+{
+	unsigned count = 0;
+	for ( const char* p = skipSeparators( begin, end ); p != end && count < n; p = skipSeparators( p, end ) )
+	{
+		p = parseValue( p, end, values[ count ] );
+		if ( !p )
+			break;
+		count++;
+	}
+	return count;
+}
+
+
+bool parseNumberList( const char* begin, const char* end, std::vector< float >& values )
+{ return parseList( begin, end, values ); }
+
+
+bool parseNumberList( const char* begin, const char* end, std::vector< int >& values )
+{ return parseList( begin, end, values ); }
+
+
+bool X3DAttribute::is( const char* s ) const
+{ return equals( name, nameEnd, s ); }
+
+
+std::string X3DAttribute::string() const
+{
+	if ( !bEscaped )
+		return std::string( value, valueEnd );
+
+	std::string result;
+	result.reserve( valueEnd - value );
+	for ( const char* p = value; p != valueEnd; p++ )
+	{
+		const char* q;
+		if ( *p != '&' || ( q = static_cast< const char* >( memchr( p, ';', valueEnd - p ) ) ) == 0 )
+		{
+			result += *p;
+			continue;
+		}
+
+		if ( equals( p + 1, q, "lt" ) )
+			result += '<';
+		else if ( equals( p + 1, q, "gt" ) )
+			result += '>';
+		else if ( equals( p + 1, q, "amp" ) )
+			result += '&';
+		else if ( equals( p + 1, q, "quot" ) )
+			result += '"';
+		else if ( equals( p + 1, q, "apos" ) )
+			result += '\'';
+		else if ( q - p > 2 && p[ 1 ] == '#' )
+		{
+			bool bHex = p[ 2 ] == 'x' || p[ 2 ] == 'X';
+			appendUtf8( result, strtoul( std::string( p + ( bHex ? 3 : 2 ), q ).c_str(), 0, bHex ? 16 : 10 ) );
+		}
+		else
+		{
+			// unknown entities are kept
+			result.append( p, q + 1 );
+		}
+		p = q;
+	}
+	return result;
+}
+
+
+unsigned X3DAttribute::numbers( double* values, unsigned n ) const
+{ return parseNumbers( value, valueEnd, values, n ); }
+
+
+bool X3DElement::is( const char* s ) const
+{ return equals( name, nameEnd, s ); }
+
+
+X3DReader::X3DReader()
+	: m_begin( 0 )
+	, m_end( 0 )
+{
+}
+
+
+bool X3DReader::open( const std::string& file )
+{
+	m_pRegion.reset();
+	m_begin = m_end = 0;
+	try
+	{
+		boost::interprocess::file_mapping mapping( file.c_str(), boost::interprocess::read_only );
+		boost::shared_ptr< boost::interprocess::mapped_region > pRegion( 
+			new boost::interprocess::mapped_region( mapping, boost::interprocess::read_only ) );
+		m_begin = static_cast< const char* >( pRegion->get_address() );
+		m_end = m_begin + pRegion->get_size();
+		m_pRegion = pRegion;
+	}
+	catch ( const boost::interprocess::interprocess_exception& e )
+	{
+		m_error = e.what();
+		return false;
+	}
+
+	// UTF-8 byte order mark
+	if ( startsWith( m_begin, m_end, "\xef\xbb\xbf" ) )
+		m_begin += 3;
+	return true;
+}
+
+
+bool X3DReader::parse( Handler& handler )
+{
+	if ( !m_pRegion )
+		return fail( m_begin, "no file" );
+	return parse( handler, m_begin, 0, false );
+}
+
+
+bool X3DReader::parseElement( Handler& handler, const void* id, const void* parent )
+{
+	const char* p = static_cast< const char* >( id );
+	if ( p < m_begin || p >= m_end || *p != '<' )
+		return fail( m_begin, "invalid element" );
+	return parse( handler, p, parent, true );
+}
+
+
+bool X3DReader::parse( Handler& handler, const char* p, const void* parent, bool bSingle )
+{
+	// open elements, without attributes
+	std::vector< X3DElement > stack;
+	X3DElement element;
+
+	while ( true )
+	{
+		// character data is skipped
+		p = static_cast< const char* >( memchr( p, '<', m_end - p ) );
+		if ( !p )
+			break;
+
+		const char* start = p;
+		if ( startsWith( p, m_end, "<?" ) )
+		{
+			if ( !( p = skipPast( p, m_end, "?>" ) ) )
+				return fail( start, "unterminated processing instruction" );
+		}
+		else if ( startsWith( p, m_end, "<!--" ) )
+		{
+			if ( !( p = skipPast( p, m_end, "-->" ) ) )
+				return fail( start, "unterminated comment" );
+		}
+		else if ( startsWith( p, m_end, "<![CDATA[" ) )
+		{
+			if ( !( p = skipPast( p, m_end, "]]>" ) ) )
+				return fail( start, "unterminated CDATA section" );
+		}
+		else if ( startsWith( p, m_end, "<!" ) )
+		{
+			// document type declaration, possibly with an internal subset
+			const char* subset = static_cast< const char* >( memchr( p, '[', m_end - p ) );
+			const char* close = static_cast< const char* >( memchr( p, '>', m_end - p ) );
+			if ( subset && close && subset < close )
+				p = find( subset, m_end, "]" );
+			p = static_cast< const char* >( memchr( p, '>', m_end - p ) );
+			if ( !p )
+				return fail( start, "unterminated declaration" );
+			p++;
+		}
+		else if ( startsWith( p, m_end, "</" ) )
+		{
+			const char* name = p + 2;
+			for ( p = name; p != m_end && !isNameEnd( *p ); p++ );
+			if ( stack.empty() || p - name != stack.back().nameEnd - stack.back().name || memcmp( name, stack.back().name, p - name ) != 0 )
+				return fail( start, "mismatched end tag" );
+			p = static_cast< const char* >( memchr( p, '>', m_end - p ) );
+			if ( !p )
+				return fail( start, "unterminated end tag" );
+			p++;
+
+			handler.endElement( stack.back() );
+			stack.pop_back();
+			if ( bSingle && stack.empty() )
+				return true;
+		}
+		else
+		{
+			element.id = p;
+			element.parent = stack.empty() ? parent : stack.back().id;
+			element.name = ++p;
+			for ( ; p != m_end && !isNameEnd( *p ); p++ );
+			element.nameEnd = p;
+			if ( element.name == element.nameEnd )
+				return fail( start, "missing element name" );
+
+			// attributes
+			element.attributes.clear();
+			bool bEmpty = false;
+			while ( true )
+			{
+				while ( p != m_end && isSpace( *p ) )
+					p++;
+				if ( p == m_end )
+					return fail( start, "unterminated start tag" );
+				if ( *p == '>' )
+					break;
+				if ( *p == '/' )
+				{
+					if ( ++p == m_end || *p != '>' )
+						return fail( start, "invalid empty element" );
+					bEmpty = true;
+					break;
+				}
+
+				X3DAttribute attribute;
+				attribute.bEscaped = true;
+				attribute.name = p;
+				for ( ; p != m_end && !isNameEnd( *p ); p++ );
+				attribute.nameEnd = p;
+				while ( p != m_end && isSpace( *p ) )
+					p++;
+				if ( p == m_end || *p != '=' || attribute.name == attribute.nameEnd )
+					return fail( p, "invalid attribute" );
+				for ( p++; p != m_end && isSpace( *p ); p++ );
+				if ( p == m_end || ( *p != '"' && *p != '\'' ) )
+					return fail( p, "unquoted attribute value" );
+
+				attribute.value = p + 1;
+				p = static_cast< const char* >( memchr( attribute.value, *p, m_end - attribute.value ) );
+				if ( !p )
+					return fail( attribute.value, "unterminated attribute value" );
+				attribute.valueEnd = p++;
+				element.attributes.push_back( attribute );
+			}
+			p++;
+
+			handler.startElement( element );
+
+			X3DElement open;
+			open.id = element.id;
+			open.parent = element.parent;
+			open.name = element.name;
+			open.nameEnd = element.nameEnd;
+			if ( bEmpty )
+			{
+				handler.endElement( open );
+				if ( bSingle && stack.empty() )
+					return true;
+			}
+			else
+				stack.push_back( open );
+		}
+	}
+
+	if ( !stack.empty() )
+		return fail( m_end, "unexpected end of file" );
+	if ( bSingle )
+		return fail( m_end, "element not found" );
+	return true;
+}
+
+
+bool X3DReader::fail( const char* p, const char* message )
+{
+	std::ostringstream error;
+	error << message;
+	if ( m_begin && p >= m_begin && p <= m_end )
+		error << " in line " << std::count( m_begin, p, '\n' ) + 1;
+	m_error = error.str();
+	return false;
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,181 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Streaming reader for X3D files and fast parsing of number lists.
+ *
+ * The reader maps the file into memory and reports elements as they are
+ * found, without building a document tree. Attribute values point into the
+ * mapping, so the large number lists of IndexedFaceSet nodes are parsed
+ * in place and never copied into strings.
+ */
+
+#ifndef __X3DReader_h_INCLUDED__
+#define __X3DReader_h_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace Ubitrack { namespace Drivers {
+
+
+/** attribute of an X3D element, name and value are not null-terminated */
+struct X3DAttribute
+{
+	const char* name;
+	const char* nameEnd;
+	const char* value;
+	const char* valueEnd;
+
+	/** the value still contains entity references, as in a streamed file */
+	bool bEscaped;
+
+	/** compares the name */
+	bool is( const char* s ) const;
+
+	/** value with entity references resolved */
+	std::string string() const;
+
+	/** 
+	 * parses up to n numbers separated by whitespace or commas
+	 * @return number of values that have been found
+	 */
+	unsigned numbers( double* values, unsigned n ) const;
+};
+
+
+/** element reported by the X3DReader */
+struct X3DElement
+{
+	/** identifies the element, the same for every time it is read */
+	const void* id;
+
+	/** id of the enclosing element, 0 for the root element */
+	const void* parent;
+
+	const char* name;
+	const char* nameEnd;
+
+	std::vector< X3DAttribute > attributes;
+
+	/** compares the name */
+	bool is( const char* s ) const;
+};
+
+
+/**
+ * parses up to n numbers separated by whitespace or commas
+ * @return number of values that have been found before the end or an invalid number
+ */
+unsigned parseNumbers( const char* begin, const char* end, double* values, unsigned n );
+
+/**
+ * Appends all numbers of a list separated by whitespace or commas. Long lists are split
+ * into chunks that are parsed by several threads. Parsing stops at the first invalid number.
+ * Unlike std::istream, the result does not depend on the locale.
+ * @return false if an invalid number has been found
+ */
+bool parseNumberList( const char* begin, const char* end, std::vector< float >& values );
+
+/** like parseNumberList() for floats, for integer lists such as coordIndex */
+bool parseNumberList( const char* begin, const char* end, std::vector< int >& values );
+
+
+/**
+ * @ingroup driver_components
+ * SAX-style reader for X3D files in XML encoding.
+ *
+ * Understands the subset of XML that is found in X3D files: elements, attributes,
+ * comments, processing instructions, CDATA sections and document type declarations.
+ * Character data is skipped, as X3D keeps all data in attributes.
+ *
+ * Elements can be read again by their id as long as the reader exists, which is used 
+ * to resolve USE references without keeping a document tree.
+ */
+class X3DReader
+{
+public:
+
+	/** receives the elements in document order */
+	class Handler
+	{
+	public:
+		virtual ~Handler()
+		{}
+
+		/** the element and its attributes are only valid during the call */
+		virtual void startElement( const X3DElement& element ) = 0;
+
+		/** called when the element has been closed, the element has no attributes here */
+		virtual void endElement( const X3DElement& element ) = 0;
+	};
+
+	X3DReader();
+
+	/** maps a file into memory, returns false on errors */
+	bool open( const std::string& file );
+
+	/** reads the whole document, returns false if it is not well-formed */
+	bool parse( Handler& handler );
+
+	/** 
+	 * reads an element again, with all its children
+	 * @param id id of an element that has been reported before
+	 * @param parent the parent id to report for the element
+	 */
+	bool parseElement( Handler& handler, const void* id, const void* parent );
+
+	/** size of the file in bytes */
+	std::size_t size() const
+	{ return m_end - m_begin; }
+
+	/** description of the last error */
+	const std::string& error() const
+	{ return m_error; }
+
+protected:
+
+	/** reads from p until the end of the document, or the end of the first element if bSingle is set */
+	bool parse( Handler& handler, const char* p, const void* parent, bool bSingle );
+
+	/** sets the error message with the line number of p, returns false */
+	bool fail( const char* p, const char* message );
+
+	/** keeps the mapping alive */
+	boost::shared_ptr< void > m_pRegion;
+
+	const char* m_begin;
+	const char* m_end;
+
+	std::string m_error;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
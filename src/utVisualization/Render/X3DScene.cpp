@@ -0,0 +1,1243 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * Compiles X3D documents into flat lists of draw items.
+ */
+
+#include "X3DScene.h"
+#include "X3DReader.h"
+#include "MeshSimplifier.h"
+#include "tools.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <utMeasurement/Measurement.h>
+
+#include <log4cpp/Category.hh>
+
+static log4cpp::Category& logger( log4cpp::Category::getInstance( "Drivers.Render.X3DScene" ) );
+
+namespace Ubitrack { namespace Drivers {
+
+namespace {
+
+// M_PI is not part of ISO C/C++
+const double g_pi = 3.14159265358979323846;
+
+/** items with fewer triangles are always drawn at full detail */
+const unsigned g_lodMinTriangles = 2048;
+
+/** simplified levels of a range of the mesh, the errors in the coordinates of the range */
+struct MeshLevels
+{
+	unsigned first[ X3DScene::lodLevels - 1 ];
+	unsigned count[ X3DScene::lodLevels - 1 ];
+	double error[ X3DScene::lodLevels - 1 ];
+};
+
+/** largest scale of a column-major transformation, to convert distances into the parent frame */
+double transformScale( const double* m )
+{
+	double scale = 0.0;
+	for ( unsigned c = 0; c < 3; c++ )
+		scale = std::max( scale, sqrt( m[ 4 * c ] * m[ 4 * c ] + m[ 4 * c + 1 ] * m[ 4 * c + 1 ] + m[ 4 * c + 2 ] * m[ 4 * c + 2 ] ) );
+	return scale;
+}
+
+/** coarsest level whose error is within the tolerance at a scale, the errors grow with the level */
+unsigned coarsestLevel( const float* errors, unsigned levels, double pixelsPerUnit, double tolerance )
+{
+	unsigned level = 0;
+	while ( level + 1 < levels && errors[ level + 1 ] * pixelsPerUnit <= tolerance )
+		level++;
+	return level;
+}
+
+/** column-major 4x4 matrix as used by OpenGL */
+struct Matrix
+{
+	double m[ 16 ];
+
+	Matrix()
+	{
+		for ( int i = 0; i < 16; i++ )
+			m[ i ] = ( i % 5 ) == 0 ? 1.0 : 0.0;
+	}
+
+	/** this = this * b */
+	void multiply( const Matrix& b )
+	{
+		Matrix a( *this );
+		for ( int c = 0; c < 4; c++ )
+			for ( int r = 0; r < 4; r++ )
+				m[ 4 * c + r ] = a.m[ r ] * b.m[ 4 * c ] + a.m[ 4 + r ] * b.m[ 4 * c + 1 ] + 
+					a.m[ 8 + r ] * b.m[ 4 * c + 2 ] + a.m[ 12 + r ] * b.m[ 4 * c + 3 ];
+	}
+
+	/** like glTranslated() */
+	void translate( double x, double y, double z )
+	{
+		Matrix t;
+		t.m[ 12 ] = x; t.m[ 13 ] = y; t.m[ 14 ] = z;
+		multiply( t );
+	}
+
+	/** like glRotated(), with the angle in radians */
+	void rotate( double angle, double x, double y, double z )
+	{
+		double length = sqrt( x * x + y * y + z * z );
+		if ( length == 0.0 || angle == 0.0 )
+			return;
+		x /= length; y /= length; z /= length;
+
+		double c = cos( angle );
+		double s = sin( angle );
+		Matrix r;
+		r.m[ 0 ] = x * x * ( 1 - c ) + c;     r.m[ 4 ] = x * y * ( 1 - c ) - z * s; r.m[  8 ] = x * z * ( 1 - c ) + y * s;
+		r.m[ 1 ] = y * x * ( 1 - c ) + z * s; r.m[ 5 ] = y * y * ( 1 - c ) + c;     r.m[  9 ] = y * z * ( 1 - c ) - x * s;
+		r.m[ 2 ] = x * z * ( 1 - c ) - y * s; r.m[ 6 ] = y * z * ( 1 - c ) + x * s; r.m[ 10 ] = z * z * ( 1 - c ) + c;
+		multiply( r );
+	}
+
+	/** like glScaled() */
+	void scale( double x, double y, double z )
+	{
+		Matrix s;
+		s.m[ 0 ] = x; s.m[ 5 ] = y; s.m[ 10 ] = z;
+		multiply( s );
+	}
+};
+
+/** index range of a converted geometry node */
+struct Range
+{
+	unsigned first;
+	unsigned count;
+};
+
+int parseAttribute( const X3DAttribute& attrib, const char* name, bool* res )
+{
+	if ( !attrib.is( name ) ) return 0;
+	std::string tmp( attrib.string() );
+	if ( tmp == "0" || tmp == "FALSE" ) *res = false;
+	if ( tmp == "1" || tmp == "TRUE" ) *res = true;
+	return 1;
+}
+
+int parseAttribute( const X3DAttribute& attrib, const char* name, std::string* res )
+{
+	if ( !attrib.is( name ) ) return 0;
+	*res = attrib.string();
+	return 1;
+}
+
+/** parses up to four numbers of an attribute, values missing in the attribute are not changed */
+int parseAttribute( const X3DAttribute& attrib, const char* name, double* res0, double* res1 = 0, double* res2 = 0, double* res3 = 0 )
+{
+	if ( !attrib.is( name ) ) return 0;
+	double tmp[ 4 ];
+	unsigned count = attrib.numbers( tmp, 4 );
+	double* res[ 4 ] = { res0, res1, res2, res3 };
+	for ( unsigned i = 0; i < count && res[ i ]; i++ )
+		*res[ i ] = tmp[ i ];
+	return 1;
+}
+
+/** id, parent and name of an element of a TiXmlDocument */
+void describe( const TiXmlElement& element, X3DElement& result )
+{
+	result.id = &element;
+	result.parent = element.Parent();
+	result.name = element.Value();
+	result.nameEnd = result.name + strlen( result.name );
+}
+
+/** size of a file in bytes, 0 if unknown */
+unsigned long fileSize( const std::string& file )
+{
+	struct stat status;
+	return stat( file.c_str(), &status ) == 0 ? (unsigned long)( status.st_size ) : 0;
+}
+
+} // anonymous namespace
+
+
+/**
+ * Converts an X3D document into an X3DScene.
+ *
+ * It mirrors the GL state changes of the former X3DRender visitor: geometry is emitted when 
+ * its parent is left, with the matrix, color and texture that are current then.
+ *
+ * Elements are either visited in a TiXmlDocument or received from an X3DReader, 
+ * both are converted into X3DElements.
+ */
+class X3DCompiler
+	: public TiXmlVisitor
+	, public X3DReader::Handler
+{
+public:
+	/** @param pReader reader of a streamed file, 0 if a TiXmlDocument is visited */
+	X3DCompiler( X3DScene& scene, X3DReader* pReader = 0 )
+		: m_scene( scene )
+		, m_pReader( pReader )
+		, m_bColor( false )
+		, m_texture( -1 )
+		, m_bTexture( false )
+	{
+		m_frames.push_back( Frame() );
+		m_frames.back().pElement = 0;
+		for ( int i = 0; i < 4; i++ )
+			m_color[ i ] = 1.0f;
+	}
+
+	virtual bool VisitEnter( const TiXmlElement& element, const TiXmlAttribute* attrib );
+	virtual bool VisitExit( const TiXmlElement& element );
+
+	virtual void startElement( const X3DElement& element );
+	virtual void endElement( const X3DElement& element );
+
+protected:
+
+	/** geometry waiting for its parent to be left, or text if count is 0 */
+	struct Pending
+	{
+		Range range;
+		std::string text;
+	};
+
+	/** matrix pushed by a Transform or Shape */
+	struct Frame
+	{
+		const void* pElement;
+		Matrix matrix;
+	};
+
+	/** element named by DEF */
+	struct Definition
+	{
+		const void* id;
+		const void* parent;
+	};
+
+	/** adds the item for a pending geometry with the current state */
+	void emit( const Pending& pending );
+
+	/** start of the next range of the scene mesh, all geometry is indexed */
+	unsigned beginRange()
+	{ return m_scene.m_mesh.indexCount(); }
+
+	/** converts an IndexedFaceSet whose lists have been parsed */
+	void addFaceSet( const void* pElement );
+
+	/** normals of a face set, generated from its triangles if it has none */
+	std::vector< Vector >* getNormals( const void* pElement );
+
+	/** 
+	 * texture coordinates of a face set per vertex instead of per triangle corner. Vertices whose 
+	 * corners have different texture coordinates are duplicated, after getNormals().
+	 */
+	std::vector< TexVec >* getTexCoords( const void* pElement );
+
+	/** points a triangle corner to a vertex with the given texture coordinate */
+	void remapCorner( GLuint& vertex, const TexVec& texCoord, std::vector< Vector >& vertices, 
+		std::vector< Vector >& normals, std::vector< TexVec >& texCoords );
+
+	void addBox( double x, double y, double z );
+	void addSphere( double radius, unsigned slices, unsigned stacks );
+	void addCylinder( double base, double top, double height, unsigned slices, bool bTop );
+	void addDisk( double radius, double z, float normal, unsigned slices );
+
+	/** adds two triangles for a quad of consecutive vertices */
+	void addQuad( GLuint a );
+
+	X3DScene& m_scene;
+	X3DReader* m_pReader;
+
+	/** lists parsed from the attributes, by face set (indices) or by the parent of the list node */
+	std::map< const void*, std::vector< Triangle > > m_indices;
+	std::map< const void*, std::vector< Vector > > m_vertices;
+	std::map< const void*, std::vector< Vector > > m_normals;
+	std::map< const void*, std::vector< Triangle > > m_texIndices;
+	std::map< const void*, std::vector< TexVec > > m_texCoords;
+
+	std::vector< Frame > m_frames;
+	std::map< const void*, std::vector< Pending > > m_pending;
+
+	/** geometry nodes that have been converted, reused by USE */
+	std::map< const void*, Range > m_ranges;
+
+	std::map< std::string, Definition > m_definitions;
+
+	/** current color, as set by the last Material */
+	bool m_bColor;
+	float m_color[ 4 ];
+
+	/** last ImageTexture and whether texturing is enabled */
+	int m_texture;
+	bool m_bTexture;
+};
+
+
+bool X3DCompiler::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* attrib )
+{
+	X3DElement converted;
+	describe( element, converted );
+	for ( ; attrib; attrib = attrib->Next() )
+	{
+		// entities have already been resolved by TinyXML
+		X3DAttribute attribute;
+		attribute.name = attrib->Name();
+		attribute.nameEnd = attribute.name + strlen( attribute.name );
+		attribute.value = attrib->Value();
+		attribute.valueEnd = attribute.value + strlen( attribute.value );
+		attribute.bEscaped = false;
+		converted.attributes.push_back( attribute );
+	}
+
+	startElement( converted );
+	return true;
+}
+
+
+bool X3DCompiler::VisitExit( const TiXmlElement& element )
+{
+	X3DElement converted;
+	describe( element, converted );
+	endElement( converted );
+	return true;
+}
+
+
+void X3DCompiler::startElement( const X3DElement& element )
+{
+	std::string name( element.name, element.nameEnd );
+	const void* parent = element.parent;
+	const std::vector< X3DAttribute >& attributes( element.attributes );
+
+	// DEF/USE processing
+	for ( unsigned i = 0; i < attributes.size(); i++ )
+	{
+		if ( attributes[ i ].is( "DEF" ) && m_definitions.find( attributes[ i ].string() ) == m_definitions.end() )
+		{
+			Definition definition = { element.id, element.parent };
+			m_definitions[ attributes[ i ].string() ] = definition;
+		}
+
+		if ( attributes[ i ].is( "USE" ) )
+		{
+			std::map< std::string, Definition >::iterator it = m_definitions.find( attributes[ i ].string() );
+			if ( it == m_definitions.end() ) break;
+
+			// the element is read again from its original position
+			if ( m_pReader )
+				m_pReader->parseElement( *this, it->second.id, it->second.parent );
+			else
+				static_cast< const TiXmlElement* >( it->second.id )->Accept( this );
+			return;
+		}
+	}
+
+	if ( name == "Shape" )
+	{
+		m_bTexture = false;
+		m_frames.push_back( m_frames.back() );
+		m_frames.back().pElement = element.id;
+		return;
+	}
+
+	if ( name == "Transform" )
+	{
+		double rx,ry,rz,ra; rx = ry = rz = ra = 0.0;
+		double tx,ty,tz;    tx = ty = tz =      0.0;
+		double sx,sy,sz;    sx = sy = sz =      1.0;
+
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+		{
+			parseAttribute( attributes[ i ], "translation", &tx, &ty, &tz      );
+			parseAttribute( attributes[ i ], "rotation",    &rx, &ry, &rz, &ra );
+			parseAttribute( attributes[ i ], "scale",       &sx, &sy, &sz      );
+		}
+
+		m_frames.push_back( m_frames.back() );
+		m_frames.back().pElement = element.id;
+		m_frames.back().matrix.translate( tx, ty, tz );
+		m_frames.back().matrix.rotate( ra, rx, ry, rz );
+		m_frames.back().matrix.scale( sx, sy, sz );
+		return;
+	}
+
+	if ( name == "Background" )
+	{
+		double r,g,b; r = g = b = 0.0;
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+			parseAttribute( attributes[ i ], "skyColor", &r, &g, &b );
+		m_scene.m_bBackground = true;
+		m_scene.m_background[ 0 ] = float( r );
+		m_scene.m_background[ 1 ] = float( g );
+		m_scene.m_background[ 2 ] = float( b );
+		return;
+	}
+
+	if ( name == "Text" )
+	{
+		Pending pending;
+		pending.range.first = pending.range.count = 0;
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+			parseAttribute( attributes[ i ], "string", &pending.text );
+		m_pending[ parent ].push_back( pending );
+		return;
+	}
+
+	if ( name == "Material" )
+	{
+		double r,g,b,a; r = g = b = 1.0; a = 0.0;
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+		{
+			parseAttribute( attributes[ i ], "diffuseColor", &r, &g, &b );
+			parseAttribute( attributes[ i ], "transparency", &a         );
+		}
+		m_bColor = true;
+		m_color[ 0 ] = float( r );
+		m_color[ 1 ] = float( g );
+		m_color[ 2 ] = float( b );
+		m_color[ 3 ] = float( 1.0 - a );
+		return;
+	}
+
+	if ( name == "ImageTexture" )
+	{
+		X3DScene::Texture texture;
+		texture.bRepeatS = false;
+		texture.bRepeatT = false;
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+		{
+			parseAttribute( attributes[ i ], "repeatS", &texture.bRepeatS );
+			parseAttribute( attributes[ i ], "repeatT", &texture.bRepeatT );
+			parseAttribute( attributes[ i ], "url", &texture.url );
+		}
+
+		if ( texture.url.empty() ) return;
+
+		// textures are shared by url
+		m_texture = -1;
+		for ( unsigned i = 0; i < m_scene.m_textures.size() && m_texture < 0; i++ )
+			if ( m_scene.m_textures[ i ].url == texture.url )
+				m_texture = i;
+		if ( m_texture < 0 )
+		{
+			m_texture = m_scene.m_textures.size();
+			m_scene.m_textures.push_back( texture );
+		}
+		m_bTexture = true;
+		return;
+	}
+
+	if ( name == "Cylinder" || name == "Cone" )
+	{
+		// the primitives of GLU are along the z axis
+		double radius = 1.0;
+		double height = 2.0;
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+		{
+			parseAttribute( attributes[ i ], name == "Cone" ? "bottomRadius" : "radius", &radius );
+			parseAttribute( attributes[ i ], "height", &height );
+		}
+		m_frames.back().matrix.rotate( -0.5 * g_pi, 1, 0, 0 );
+		m_frames.back().matrix.translate( 0, 0, -height / 2 );
+
+		std::map< const void*, Range >::iterator it = m_ranges.find( element.id );
+		if ( it == m_ranges.end() )
+		{
+			Range range;
+			range.first = beginRange();
+			addCylinder( radius, name == "Cone" ? 0.0 : radius, height, 15, name == "Cylinder" );
+			range.count = beginRange() - range.first;
+			it = m_ranges.insert( std::make_pair( element.id, range ) ).first;
+		}
+
+		Pending pending;
+		pending.range = it->second;
+		m_pending[ parent ].push_back( pending );
+		return;
+	}
+
+	if ( name == "Sphere" || name == "Box" )
+	{
+		std::map< const void*, Range >::iterator it = m_ranges.find( element.id );
+		if ( it == m_ranges.end() )
+		{
+			Range range;
+			range.first = beginRange();
+			if ( name == "Sphere" )
+			{
+				double radius = 1.0;
+				for ( unsigned i = 0; i < attributes.size(); i++ )
+					parseAttribute( attributes[ i ], "radius", &radius );
+				addSphere( radius, 10, 10 );
+			}
+			else
+			{
+				double x,y,z; x = y = z = 2.0;
+				for ( unsigned i = 0; i < attributes.size(); i++ )
+					parseAttribute( attributes[ i ], "size", &x, &y, &z );
+				addBox( x, y, z );
+			}
+			range.count = beginRange() - range.first;
+			it = m_ranges.insert( std::make_pair( element.id, range ) ).first;
+		}
+
+		Pending pending;
+		pending.range = it->second;
+		m_pending[ parent ].push_back( pending );
+		return;
+	}
+
+	if ( name == "IndexedFaceSet" )
+	{
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+		{
+			if ( attributes[ i ].is( "coordIndex" ) )
+				parseList< Triangle >( element.id, attributes[ i ].value, attributes[ i ].valueEnd, m_indices );
+			if ( attributes[ i ].is( "texCoordIndex" ) )
+				parseList< Triangle >( element.id, attributes[ i ].value, attributes[ i ].valueEnd, m_texIndices );
+		}
+		return;
+	}
+
+	if ( name == "Coordinate" )
+	{
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+			if ( attributes[ i ].is( "point" ) )
+				parseList< Vector >( parent, attributes[ i ].value, attributes[ i ].valueEnd, m_vertices );
+		return;
+	}
+
+	if ( name == "TextureCoordinate" )
+	{
+		for ( unsigned i = 0; i < attributes.size(); i++ )
+			if ( attributes[ i ].is( "point" ) )
+				parseList< TexVec >( parent, attributes[ i ].value, attributes[ i ].valueEnd, m_texCoords );
+		return;
+	}
+}
+
+
+void X3DCompiler::endElement( const X3DElement& element )
+{
+	// face sets are converted when their coordinates have been read
+	if ( element.is( "IndexedFaceSet" ) )
+	{
+		std::map< const void*, Range >::iterator it = m_ranges.find( element.id );
+		if ( it == m_ranges.end() )
+		{
+			Range range;
+			range.first = beginRange();
+			addFaceSet( element.id );
+			range.count = beginRange() - range.first;
+			it = m_ranges.insert( std::make_pair( element.id, range ) ).first;
+		}
+
+		Pending pending;
+		pending.range = it->second;
+		m_pending[ element.parent ].push_back( pending );
+	}
+
+	// geometry is drawn in reverse order, as by the cleanup stack of the former X3DRender visitor
+	std::map< const void*, std::vector< Pending > >::iterator it = m_pending.find( element.id );
+	if ( it != m_pending.end() )
+	{
+		for ( std::vector< Pending >::reverse_iterator i = it->second.rbegin(); i != it->second.rend(); i++ )
+			emit( *i );
+		m_pending.erase( it );
+	}
+
+	if ( m_frames.back().pElement == element.id )
+		m_frames.pop_back();
+}
+
+
+void X3DCompiler::emit( const Pending& pending )
+{
+	if ( pending.text.empty() && pending.range.count == 0 )
+		return;
+
+	X3DScene::Item item;
+	item.type = pending.text.empty() ? X3DScene::Item::typeMesh : X3DScene::Item::typeText;
+	memcpy( item.transform, m_frames.back().matrix.m, sizeof( item.transform ) );
+	item.bColor = m_bColor;
+	memcpy( item.color, m_color, sizeof( item.color ) );
+	item.texture = m_bTexture ? m_texture : -1;
+	item.first = pending.range.first;
+	item.count = pending.range.count;
+	for ( unsigned i = 0; i < X3DScene::lodLevels - 1; i++ )
+	{
+		item.lodFirst[ i ] = item.lodCount[ i ] = 0;
+		item.lodError[ i ] = 0.0f;
+	}
+	item.text = pending.text;
+
+	// merge with the previous item if only the range differs
+	if ( !m_scene.m_items.empty() && item.type == X3DScene::Item::typeMesh )
+	{
+		X3DScene::Item& last = m_scene.m_items.back();
+		if ( last.type == X3DScene::Item::typeMesh && last.first + last.count == item.first && last.texture == item.texture &&
+			last.bColor == item.bColor && memcmp( last.color, item.color, sizeof( item.color ) ) == 0 &&
+			memcmp( last.transform, item.transform, sizeof( item.transform ) ) == 0 )
+		{
+			last.count += item.count;
+			return;
+		}
+	}
+
+	m_scene.m_items.push_back( item );
+}
+
+
+void X3DCompiler::addFaceSet( const void* pElement )
+{
+	std::vector< Triangle >* idx = getList< Triangle >( pElement, m_indices );
+	std::vector< Vector   >* vec = getList< Vector   >( pElement, m_vertices );
+	std::vector< Vector   >* nrm = getNormals( pElement );
+	std::vector< TexVec   >* tex = getTexCoords( pElement );
+	if ( !idx || !vec || vec->empty() )
+		return;
+
+	GLGeometry& mesh( m_scene.m_mesh );
+	GLuint base = mesh.vertexCount();
+
+	for ( unsigned i = 0; i < vec->size(); i++ )
+	{
+		if ( nrm && i < nrm->size() )
+			mesh.normal( (*nrm)[ i ].a, (*nrm)[ i ].b, (*nrm)[ i ].c );
+		if ( tex && i < tex->size() )
+			mesh.texCoord( (*tex)[ i ].a, (*tex)[ i ].b );
+		else
+			mesh.texCoord( 0, 0 );
+		mesh.vertex( (*vec)[ i ].a, (*vec)[ i ].b, (*vec)[ i ].c );
+	}
+
+	for ( std::vector< Triangle >::iterator it = idx->begin(); it != idx->end(); it++ )
+		if ( it->a < vec->size() && it->b < vec->size() && it->c < vec->size() )
+		{
+			mesh.index( base + it->a );
+			mesh.index( base + it->b );
+			mesh.index( base + it->c );
+		}
+}
+
+
+std::vector< Vector >* X3DCompiler::getNormals( const void* pElement )
+{
+	std::vector< Vector >* nrm = getList< Vector >( pElement, m_normals );
+	if ( nrm )
+		return nrm;
+
+	std::vector< Triangle >* idx = getList< Triangle >( pElement, m_indices );
+	std::vector< Vector >* vec = getList< Vector >( pElement, m_vertices );
+	if ( !idx || !vec )
+		return 0;
+
+	// each vertex gets the normal of the last triangle using it
+	nrm = &m_normals[ pElement ];
+	nrm->resize( vec->size() );
+	for ( std::vector< Triangle >::iterator it = idx->begin(); it != idx->end(); it++ )
+	{
+		if ( it->a >= vec->size() || it->b >= vec->size() || it->c >= vec->size() )
+			continue;
+
+		const Vector& v1 = (*vec)[ it->a ];
+		Vector n = ( (*vec)[ it->b ] - v1 ) & ( (*vec)[ it->c ] - v1 );
+		n.normalize();
+		(*nrm)[ it->a ] = n;
+		(*nrm)[ it->b ] = n;
+		(*nrm)[ it->c ] = n;
+	}
+	return nrm;
+}
+
+
+std::vector< TexVec >* X3DCompiler::getTexCoords( const void* pElement )
+{
+	std::vector< TexVec >* tex = getList< TexVec >( pElement, m_texCoords );
+	std::vector< Vector >* vec = getList< Vector >( pElement, m_vertices );
+	std::vector< Vector >* nrm = getList< Vector >( pElement, m_normals );
+	if ( tex && vec && tex->size() == vec->size() )
+		return tex;
+
+	std::vector< Triangle >* idx = getList< Triangle >( pElement, m_indices );
+	std::vector< Triangle >* txi = getList< Triangle >( pElement, m_texIndices );
+	if ( !tex || !vec || !nrm || !idx || !txi )
+		return 0;
+
+	// the coordinates are replaced by one per vertex
+	std::vector< TexVec > corners( *tex );
+	TexVec zero;
+	zero.set( 0.0, 0.0 );
+	tex->assign( vec->size(), zero );
+
+	for ( unsigned i = 0; i < idx->size() && i < txi->size(); i++ )
+	{
+		Triangle& vertex( (*idx)[ i ] );
+		const Triangle& texIndex( (*txi)[ i ] );
+		if ( vertex.a >= vec->size() || vertex.b >= vec->size() || vertex.c >= vec->size() || 
+			texIndex.a >= corners.size() || texIndex.b >= corners.size() || texIndex.c >= corners.size() )
+			continue;
+
+		remapCorner( vertex.a, corners[ texIndex.a ], *vec, *nrm, *tex );
+		remapCorner( vertex.b, corners[ texIndex.b ], *vec, *nrm, *tex );
+		remapCorner( vertex.c, corners[ texIndex.c ], *vec, *nrm, *tex );
+	}
+	return tex;
+}
+
+
+void X3DCompiler::remapCorner( GLuint& vertex, const TexVec& texCoord, std::vector< Vector >& vertices, 
+	std::vector< Vector >& normals, std::vector< TexVec >& texCoords )
+{
+	TexVec zero;
+	zero.set( 0.0, 0.0 );
+	if ( texCoords[ vertex ] == zero || texCoords[ vertex ] == texCoord )
+	{
+		texCoords[ vertex ] = texCoord;
+		return;
+	}
+
+	// the vertex already has another texture coordinate
+	vertices.push_back( Vector( vertices[ vertex ] ) );
+	normals.push_back( Vector( normals[ vertex ] ) );
+	texCoords.push_back( texCoord );
+	vertex = vertices.size() - 1;
+}
+
+
+void X3DCompiler::addQuad( GLuint a )
+{
+	GLGeometry& mesh( m_scene.m_mesh );
+	mesh.index( a );
+	mesh.index( a + 1 );
+	mesh.index( a + 2 );
+	mesh.index( a );
+	mesh.index( a + 2 );
+	mesh.index( a + 3 );
+}
+
+
+void X3DCompiler::addBox( double dx, double dy, double dz )
+{
+	// same faces and texture coordinates as the former glutTexturedBox()
+	static const float faces[ 6 ][ 4 ][ 5 ] = {
+		{ { 0, 1, -1,  1, -1 }, { 0, 0, -1,  1,  1 }, { 1, 0,  1,  1,  1 }, { 1, 1,  1,  1, -1 } },
+		{ { 1, 1, -1, -1, -1 }, { 1, 0, -1, -1,  1 }, { 0, 0,  1, -1,  1 }, { 0, 1,  1, -1, -1 } },
+		{ { 1, 1,  1, -1, -1 }, { 1, 0,  1, -1,  1 }, { 0, 0,  1,  1,  1 }, { 0, 1,  1,  1, -1 } },
+		{ { 0, 1, -1, -1, -1 }, { 0, 0, -1, -1,  1 }, { 1, 0, -1,  1,  1 }, { 1, 1, -1,  1, -1 } },
+		{ { 0, 1, -1, -1,  1 }, { 0, 0,  1, -1,  1 }, { 1, 0,  1,  1,  1 }, { 1, 1, -1,  1,  1 } },
+		{ { 1, 1, -1, -1, -1 }, { 1, 0,  1, -1, -1 }, { 0, 0,  1,  1, -1 }, { 0, 1, -1,  1, -1 } } };
+	static const float normals[ 6 ][ 3 ] = { { 0, 1, 0 }, { 0, -1, 0 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+	GLGeometry& mesh( m_scene.m_mesh );
+	float x = float( dx / 2 ), y = float( dy / 2 ), z = float( dz / 2 );
+	for ( unsigned f = 0; f < 6; f++ )
+	{
+		mesh.normal( normals[ f ][ 0 ], normals[ f ][ 1 ], normals[ f ][ 2 ] );
+		GLuint first = mesh.vertexCount();
+		for ( unsigned v = 0; v < 4; v++ )
+		{
+			const float* p = faces[ f ][ v ];
+			mesh.texCoord( p[ 0 ], p[ 1 ] );
+			mesh.vertex( p[ 2 ] * x, p[ 3 ] * y, p[ 4 ] * z );
+		}
+		addQuad( first );
+	}
+}
+
+
+void X3DCompiler::addSphere( double radius, unsigned slices, unsigned stacks )
+{
+	GLGeometry& mesh( m_scene.m_mesh );
+	GLuint first = mesh.vertexCount();
+	for ( unsigned i = 0; i <= stacks; i++ )
+	{
+		double phi = g_pi * i / stacks;
+		for ( unsigned j = 0; j <= slices; j++ )
+		{
+			double theta = 2 * g_pi * j / slices;
+			float x = float( sin( phi ) * sin( theta ) );
+			float y = float( sin( phi ) * cos( theta ) );
+			float z = float( cos( phi ) );
+			mesh.normal( x, y, z );
+			mesh.texCoord( float( j ) / slices, 1.0f - float( i ) / stacks );
+			mesh.vertex( float( radius ) * x, float( radius ) * y, float( radius ) * z );
+		}
+	}
+
+	for ( unsigned i = 0; i < stacks; i++ )
+		for ( unsigned j = 0; j < slices; j++ )
+		{
+			// counter-clockwise seen from outside
+			GLuint a = first + i * ( slices + 1 ) + j;
+			GLuint b = a + slices + 1;
+			mesh.index( a );
+			mesh.index( a + 1 );
+			mesh.index( b + 1 );
+			mesh.index( a );
+			mesh.index( b + 1 );
+			mesh.index( b );
+		}
+}
+
+
+void X3DCompiler::addCylinder( double base, double top, double height, unsigned slices, bool bTop )
+{
+	// side, like gluCylinder() with a single stack
+	GLGeometry& mesh( m_scene.m_mesh );
+	GLuint first = mesh.vertexCount();
+	double slope = ( base - top ) / height;
+	double length = sqrt( 1.0 + slope * slope );
+	for ( unsigned j = 0; j <= slices; j++ )
+	{
+		double theta = 2 * g_pi * j / slices;
+		float x = float( sin( theta ) );
+		float y = float( cos( theta ) );
+		mesh.normal( float( x / length ), float( y / length ), float( slope / length ) );
+		mesh.texCoord( float( j ) / slices, 0 );
+		mesh.vertex( float( base ) * x, float( base ) * y, 0 );
+		mesh.texCoord( float( j ) / slices, 1 );
+		mesh.vertex( float( top ) * x, float( top ) * y, float( height ) );
+	}
+
+	for ( unsigned j = 0; j < slices; j++ )
+	{
+		// the slices run clockwise around the z axis
+		GLuint a = first + 2 * j;
+		mesh.index( a );
+		mesh.index( a + 3 );
+		mesh.index( a + 2 );
+		mesh.index( a );
+		mesh.index( a + 1 );
+		mesh.index( a + 3 );
+	}
+
+	addDisk( base, 0, -1.0f, slices );
+	if ( bTop )
+		addDisk( top, height, 1.0f, slices );
+}
+
+
+void X3DCompiler::addDisk( double radius, double z, float normal, unsigned slices )
+{
+	// like gluDisk(), facing along the z axis in the direction of normal
+	GLGeometry& mesh( m_scene.m_mesh );
+	mesh.normal( 0, 0, normal );
+	mesh.texCoord( 0.5f, 0.5f );
+	GLuint center = mesh.vertex( 0, 0, float( z ) );
+	for ( unsigned j = 0; j <= slices; j++ )
+	{
+		double theta = 2 * g_pi * j / slices;
+		float x = float( sin( theta ) );
+		float y = float( cos( theta ) );
+		mesh.texCoord( 0.5f + 0.5f * x, 0.5f + 0.5f * y );
+		mesh.vertex( float( radius ) * x, float( radius ) * y, float( z ) );
+	}
+
+	for ( unsigned j = 0; j < slices; j++ )
+	{
+		mesh.index( center );
+		mesh.index( normal > 0 ? center + 2 + j : center + 1 + j );
+		mesh.index( normal > 0 ? center + 1 + j : center + 2 + j );
+	}
+}
+
+
+X3DScene::X3DScene()
+	: m_mesh( GL_TRIANGLES, GLGeometry::normals | GLGeometry::texCoords )
+	, m_bBackground( false )
+	, m_bBounded( false )
+	, m_levels( 1 )
+{
+	for ( unsigned i = 0; i < lodLevels; i++ )
+		m_levelError[ i ] = 0.0f;
+}
+
+
+void X3DScene::clear()
+{
+	m_mesh.clear();
+	m_pStorage.reset();
+	m_items.clear();
+	m_textures.clear();
+	m_bBackground = false;
+	m_bounds.clear();
+	m_bBounded = false;
+	m_levels = 1;
+}
+
+
+void X3DScene::generateLevels( const std::string& source )
+{
+	Measurement::Timestamp start = Measurement::now();
+	unsigned long triangles[ lodLevels ] = { 0 };
+	unsigned simplified = 0;
+
+	// geometry reused by USE is simplified once
+	std::map< std::pair< unsigned, unsigned >, MeshLevels > done;
+
+	for ( std::vector< Item >::iterator it = m_items.begin(); it != m_items.end(); it++ )
+	{
+		if ( it->type != Item::typeMesh || it->count / 3 < g_lodMinTriangles )
+			continue;
+
+		std::pair< unsigned, unsigned > range( it->first, it->count );
+		std::map< std::pair< unsigned, unsigned >, MeshLevels >::iterator found = done.find( range );
+		if ( found == done.end() )
+		{
+			MeshLevels levels;
+			memset( &levels, 0, sizeof( levels ) );
+
+			// each level continues from the previous one, until the simplification stalls
+			MeshSimplifier simplifier( m_mesh.vertexData(), m_mesh.stride(), m_mesh.indexData() + it->first, it->count );
+			unsigned previous = it->count / 3;
+			for ( unsigned level = 1; level < lodLevels; level++ )
+			{
+				const std::vector< GLuint >& indices = simplifier.simplify( previous / 4 );
+				if ( simplifier.triangles() > previous / 4 * 3 )
+					break;
+
+				levels.first[ level - 1 ] = m_mesh.indexCount();
+				levels.count[ level - 1 ] = indices.size();
+				levels.error[ level - 1 ] = simplifier.error();
+				for ( std::vector< GLuint >::const_iterator i = indices.begin(); i != indices.end(); i++ )
+					m_mesh.index( *i );
+				previous = simplifier.triangles();
+			}
+
+			found = done.insert( std::make_pair( range, levels ) ).first;
+			simplified++;
+		}
+
+		double scale = transformScale( it->transform );
+		for ( unsigned i = 0; i < lodLevels - 1; i++ )
+		{
+			it->lodFirst[ i ] = found->second.first[ i ];
+			it->lodCount[ i ] = found->second.count[ i ];
+			it->lodError[ i ] = float( found->second.error[ i ] * scale );
+		}
+	}
+
+	if ( !simplified )
+		return;
+
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+		for ( unsigned level = 0; level < lodLevels; level++ )
+		{
+			unsigned first, count;
+			itemRange( *it, level, first, count );
+			triangles[ level ] += count / 3;
+		}
+
+	LOG4CPP_INFO( logger, "Simplified " << simplified << " meshes of " << source << " in " << 
+		1e-6 * double( Measurement::now() - start ) << " ms, triangles per level: " << triangles[ 0 ] << ", " << 
+		triangles[ 1 ] << ", " << triangles[ 2 ] << ", " << triangles[ 3 ] );
+}
+
+
+unsigned X3DScene::level( double pixelsPerUnit, double tolerance, unsigned current ) const
+{
+	if ( m_levels <= 1 || tolerance <= 0.0 )
+		return 0;
+
+	unsigned finest = coarsestLevel( m_levelError, m_levels, pixelsPerUnit * 1.2, tolerance );
+	unsigned coarsest = coarsestLevel( m_levelError, m_levels, pixelsPerUnit / 1.2, tolerance );
+	return std::max( finest, std::min( coarsest, current ) );
+}
+
+
+void X3DScene::itemRange( const Item& item, unsigned level, unsigned& first, unsigned& count ) const
+{
+	first = item.first;
+	count = item.count;
+	for ( unsigned i = 1; i <= level && i < lodLevels; i++ )
+		if ( item.lodCount[ i - 1 ] )
+		{
+			first = item.lodFirst[ i - 1 ];
+			count = item.lodCount[ i - 1 ];
+		}
+}
+
+
+void X3DScene::finish()
+{
+	m_bounds.clear();
+	m_bBounded = !m_bBackground;
+
+	const float* pVertices = m_mesh.vertexData();
+	const GLuint* pIndices = m_mesh.indexData();
+	unsigned stride = m_mesh.stride();
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+	{
+		if ( it->type != Item::typeMesh )
+		{
+			m_bBounded = false;
+			continue;
+		}
+
+		// box of the item in its own coordinates, then transformed into the scene
+		BoundingBox item;
+		for ( unsigned i = it->first; i < it->first + it->count; i++ )
+		{
+			const float* v = pVertices + stride * ( pIndices ? pIndices[ i ] : i );
+			item.extend( v[ 0 ], v[ 1 ], v[ 2 ] );
+		}
+		m_bounds.extend( item, it->transform );
+	}
+
+	if ( m_bounds.empty() )
+		m_bBounded = false;
+
+	// a level exists if any item has it, items without it are drawn at their coarsest one
+	m_levels = 1;
+	for ( unsigned level = 0; level < lodLevels; level++ )
+		m_levelError[ level ] = 0.0f;
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+	{
+		if ( it->type != Item::typeMesh )
+			continue;
+
+		float error = 0.0f;
+		for ( unsigned level = 1; level < lodLevels; level++ )
+		{
+			if ( it->lodCount[ level - 1 ] )
+			{
+				error = it->lodError[ level - 1 ];
+				m_levels = std::max( m_levels, level + 1 );
+			}
+			m_levelError[ level ] = std::max( m_levelError[ level ], error );
+		}
+	}
+}
+
+
+void X3DScene::report( const std::string& source ) const
+{
+	LOG4CPP_INFO( logger, "Compiled " << source << ": " << m_items.size() << " draw items, " << 
+		m_mesh.vertexCount() << " vertices, " << m_mesh.indexCount() / 3 << " triangles, " << m_textures.size() << " textures" );
+}
+
+
+void X3DScene::compile( const TiXmlDocument& doc )
+{
+	clear();
+
+	X3DCompiler compiler( *this );
+	doc.Accept( &compiler );
+
+	generateLevels( doc.Value() );
+	finish();
+	report( doc.Value() );
+}
+
+
+bool X3DScene::load( const std::string& file, bool bStream )
+{
+	Measurement::Timestamp start = Measurement::now();
+	unsigned long size;
+
+	if ( bStream )
+	{
+		clear();
+
+		// the reader must live until all USE references have been resolved
+		X3DReader reader;
+		X3DCompiler compiler( *this, &reader );
+		if ( !reader.open( file ) || !reader.parse( compiler ) )
+		{
+			LOG4CPP_ERROR( logger, "Could not read X3D file " << file << ": " << reader.error() );
+			clear();
+			return false;
+		}
+		size = reader.size();
+		generateLevels( file );
+		finish();
+		report( file );
+	}
+	else
+	{
+		TiXmlDocument doc( file );
+		if ( !doc.LoadFile() )
+		{
+			LOG4CPP_ERROR( logger, "Could not load X3D file " << file << ": " << doc.ErrorDesc() );
+			clear();
+			return false;
+		}
+		compile( doc );
+		size = fileSize( file );
+	}
+
+	// throughput of parsing and compiling, to compare both readers
+	double seconds = 1e-9 * double( Measurement::now() - start );
+	LOG4CPP_INFO( logger, "Read " << file << " with the " << ( bStream ? "streaming" : "DOM" ) << " reader: " << 
+		size / 1048576.0 << " MB in " << seconds * 1e3 << " ms, " << ( seconds > 0 ? size / 1048576.0 / seconds : 0.0 ) << " MB/s" );
+	return true;
+}
+
+
+GLuint X3DScene::texture( GLStateCache& state, TextureManager& textures, Resources& resources, int index ) const
+{
+	TextureManager::Handle& handle( resources.m_textures[ index ] );
+	if ( !handle )
+		handle = textures.request( m_textures[ index ].url, m_textures[ index ].bRepeatS, m_textures[ index ].bRepeatT );
+	return textures.name( state, handle );
+}
+
+
+void X3DScene::itemState( GLStateCache& state, TextureManager& textures, Resources& resources, const Item& item ) const
+{
+	if ( item.bColor )
+		glColor4fv( item.color );
+
+	if ( item.texture >= 0 )
+	{
+		GLuint id = texture( state, textures, resources, item.texture );
+		state.enable( GL_TEXTURE_2D );
+		state.bindTexture2D( id );
+
+		// textures are lit by the material color
+		state.texEnvMode( GL_MODULATE );
+	}
+	else
+		state.disable( GL_TEXTURE_2D );
+}
+
+
+void X3DScene::draw( GLStateCache& state, const GLExtensions& ext, TextureManager& textures, Resources& resources, 
+	unsigned level ) const
+{
+	// the context's buffers are filled straight from the shared arrays
+	if ( resources.m_mesh.empty() && !m_mesh.empty() )
+		resources.m_mesh.assign( m_mesh.vertexData(), m_mesh.vertexCount(), m_mesh.indexData(), m_mesh.indexCount() );
+	resources.m_textures.resize( m_textures.size() );
+
+	if ( m_bBackground )
+		glClearColor( m_background[ 0 ], m_background[ 1 ], m_background[ 2 ], 1.0f );
+
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+	{
+		glPushMatrix();
+		glMultMatrixd( it->transform );
+
+		itemState( state, textures, resources, *it );
+
+		if ( it->type == Item::typeText )
+		{
+			glScaled( 0.01, 0.01, 0.01 );
+			state.lineWidth( 2.0f );
+			for ( const char* c = it->text.c_str(); *c; c++ )
+				glutStrokeCharacter( GLUT_STROKE_ROMAN, *c );
+		}
+		else
+		{
+			unsigned first, count;
+			itemRange( *it, level, first, count );
+			resources.m_mesh.draw( ext, first, count );
+		}
+
+		glPopMatrix();
+	}
+}
+
+
+void X3DScene::drawInstanced( GLStateCache& state, const GLExtensions& ext, TextureManager& textures, Resources& resources, 
+	unsigned instances, GLint transformLocation, GLint normalLocation, unsigned level ) const
+{
+	if ( resources.m_mesh.empty() && !m_mesh.empty() )
+		resources.m_mesh.assign( m_mesh.vertexData(), m_mesh.vertexCount(), m_mesh.indexData(), m_mesh.indexCount() );
+	resources.m_textures.resize( m_textures.size() );
+
+	if ( m_bBackground )
+		glClearColor( m_background[ 0 ], m_background[ 1 ], m_background[ 2 ], 1.0f );
+
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+	{
+		if ( it->type != Item::typeMesh )
+			continue;
+
+		// the normals of non-uniformly scaled items need the inverse transpose, whose columns are
+		// the cross products of the columns of the transformation divided by its determinant
+		const double* m = it->transform;
+		float transform[ 16 ];
+		for ( unsigned i = 0; i < 16; i++ )
+			transform[ i ] = float( m[ i ] );
+
+		double columns[ 3 ][ 3 ] = {
+			{ m[ 5 ] * m[ 10 ] - m[ 6 ] * m[ 9 ], m[ 6 ] * m[ 8 ] - m[ 4 ] * m[ 10 ], m[ 4 ] * m[ 9 ] - m[ 5 ] * m[ 8 ] },
+			{ m[ 9 ] * m[ 2 ] - m[ 10 ] * m[ 1 ], m[ 10 ] * m[ 0 ] - m[ 8 ] * m[ 2 ], m[ 8 ] * m[ 1 ] - m[ 9 ] * m[ 0 ] },
+			{ m[ 1 ] * m[ 6 ] - m[ 2 ] * m[ 5 ], m[ 2 ] * m[ 4 ] - m[ 0 ] * m[ 6 ], m[ 0 ] * m[ 5 ] - m[ 1 ] * m[ 4 ] } };
+		double determinant = m[ 0 ] * columns[ 0 ][ 0 ] + m[ 1 ] * columns[ 0 ][ 1 ] + m[ 2 ] * columns[ 0 ][ 2 ];
+		float normal[ 9 ];
+		for ( unsigned c = 0; c < 3; c++ )
+			for ( unsigned r = 0; r < 3; r++ )
+				normal[ 3 * c + r ] = float( determinant != 0.0 ? columns[ c ][ r ] / determinant : ( c == r ? 1.0 : 0.0 ) );
+
+		ext.uniformMatrix4fv( transformLocation, 1, GL_FALSE, transform );
+		ext.uniformMatrix3fv( normalLocation, 1, GL_FALSE, normal );
+		itemState( state, textures, resources, *it );
+		unsigned first, count;
+		itemRange( *it, level, first, count );
+		resources.m_mesh.drawInstanced( ext, first, count, instances );
+	}
+}
+
+
+bool X3DScene::isInstanceable() const
+{
+	for ( std::vector< Item >::const_iterator it = m_items.begin(); it != m_items.end(); it++ )
+		if ( it->type != Item::typeMesh )
+			return false;
+	return true;
+}
+
+
+X3DScene::Resources::Resources()
+	: m_mesh( GL_TRIANGLES, GLGeometry::normals | GLGeometry::texCoords )
+{
+}
+
+
+void X3DScene::Resources::release( const GLExtensions& ext )
+{
+	// the texture manager of the context owns the textures
+	m_textures.clear();
+	m_mesh.release( ext );
+	m_mesh.clear();
+}
+
+
+} } // namespace Ubitrack::Drivers
@@ -0,0 +1,255 @@
+/*
+ * Ubitrack - Library for Ubiquitous Tracking
+ * Copyright 2006, Technische Universitaet Muenchen, and individual
+ * contributors as indicated by the @authors tag. See the
+ * copyright.txt in the distribution for a full listing of individual
+ * contributors.
+ *
+ * This is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this software; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+ */
+
+
+/**
+ * @ingroup driver_components
+ * @file
+ * X3D scenes compiled into flat lists of draw items.
+ */
+
+#ifndef __X3DScene_h_INCLUDED__
+#define __X3DScene_h_INCLUDED__
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <tinyxml.h>
+
+#include "GLGeometry.h"
+#include "GLStateCache.h"
+#include "TextureManager.h"
+#include "Frustum.h"
+
+namespace Ubitrack { namespace Drivers {
+
+class X3DCompiler;
+class X3DCache;
+
+
+/**
+ * @ingroup driver_components
+ * X3D document compiled into one mesh and a list of draw items.
+ *
+ * load() streams the file through an X3DReader, compile() walks a parsed TiXmlDocument.
+ * Either way the document is traversed once. Transforms are baked into one matrix per item,
+ * materials into a color, and all geometry is converted into triangles of a single
+ * GLGeometry, so the document can be released afterwards. Consecutive shapes with the
+ * same state are merged into one item. Drawing is a loop over the items that changes
+ * GL state through the GLStateCache only.
+ *
+ * Supported are the nodes of the former X3DRender visitor: Transform, Shape, Material,
+ * ImageTexture, IndexedFaceSet, Box, Sphere, Cylinder, Cone, Text, Background and DEF/USE.
+ *
+ * Items with many triangles get coarser detail levels, simplified by a MeshSimplifier to a quarter
+ * of the triangles of the previous level. They index the same vertices, so they only add indices
+ * to the mesh and are stored in the mesh cache with it.
+ */
+class X3DScene
+{
+public:
+	/** number of detail levels including the full one */
+	enum { lodLevels = 4 };
+
+	X3DScene();
+
+	/** converts the document, does not need a GL context */
+	void compile( const TiXmlDocument& doc );
+
+	/**
+	 * reads and converts an X3D file, does not need a GL context
+	 * @param bStream stream the file instead of loading it into a TiXmlDocument first
+	 * @return false if the file could not be read, the scene is empty then
+	 */
+	bool load( const std::string& file, bool bStream = true );
+
+	/**
+	 * GL objects of a scene in one context: the buffers of its mesh, which are filled from the
+	 * arrays of the scene without copying them, and its textures. Used on the GL thread only.
+	 */
+	class Resources
+	{
+	public:
+		Resources();
+
+		/** deletes the buffers and drops the textures, they are created again by the next draw() */
+		void release( const GLExtensions& ext );
+
+	protected:
+		GLGeometry m_mesh;
+
+		/** by index of the scene's textures, empty until first drawn */
+		std::vector< TextureManager::Handle > m_textures;
+
+		friend class X3DScene;
+	};
+
+	/** 
+	 * draws all items, uploading the mesh into the resources of the context first if needed. GL thread only.
+	 * Textures are requested from the manager and drawn as white until they have been loaded.
+	 * The scene itself is not changed, so it can be shared by several components and contexts.
+	 */
+	void draw( GLStateCache& state, const GLExtensions& ext, TextureManager& textures, Resources& resources, 
+		unsigned level = 0 ) const;
+
+	/**
+	 * draws all items for several instances with one draw call per item. GL thread only.
+	 * The caller has bound a program that places the instances and reads the transformation of
+	 * the item relative to the instance from uniforms.
+	 * @param transformLocation location of the mat4 uniform of the item transformation
+	 * @param normalLocation location of the mat3 uniform of the inverse transpose of the transformation
+	 * @param level detail level, see level()
+	 */
+	void drawInstanced( GLStateCache& state, const GLExtensions& ext, TextureManager& textures, Resources& resources, 
+		unsigned instances, GLint transformLocation, GLint normalLocation, unsigned level = 0 ) const;
+
+	/** true if drawInstanced() can draw all items, which excludes text */
+	bool isInstanceable() const;
+
+	/** number of draw items */
+	unsigned size() const
+	{ return m_items.size(); }
+
+	bool empty() const
+	{ return m_items.empty(); }
+
+	/** 
+	 * false if the extent of the scene is unknown, i.e. for text, or if drawing has side effects beyond
+	 * the scene, i.e. for a Background. Such scenes must not be culled.
+	 */
+	bool isBounded() const
+	{ return m_bBounded; }
+
+	/** bounding box of all items in scene coordinates, valid if isBounded() */
+	const BoundingBox& bounds() const
+	{ return m_bounds; }
+
+	/** number of detail levels, 1 if no item has been simplified */
+	unsigned levels() const
+	{ return m_levels; }
+
+	/**
+	 * Detail level for drawing the scene at a given scale. The coarsest level whose error projects to
+	 * at most tolerance pixels is chosen, with a hysteresis: the current level is kept until the scale 
+	 * changes by 20% beyond the point at which a different level would be chosen, so objects near
+	 * that point do not flicker between levels.
+	 * @param pixelsPerUnit size of one scene unit on the screen at the object, see Frustum::pixelsPerUnit()
+	 * @param tolerance allowed error in pixels
+	 * @param current level of the previous frame
+	 */
+	unsigned level( double pixelsPerUnit, double tolerance, unsigned current ) const;
+
+protected:
+
+	/** texture of ImageTexture nodes with the same url */
+	struct Texture
+	{
+		std::string url;
+		bool bRepeatS;
+		bool bRepeatT;
+	};
+
+	/** one state change followed by a draw call */
+	struct Item
+	{
+		enum { typeMesh, typeText } type;
+
+		/** column-major model matrix relative to the scene */
+		double transform[ 16 ];
+
+		/** set color, or keep the current one if no Material has been seen yet */
+		bool bColor;
+		float color[ 4 ];
+
+		/** index into m_textures, -1 to draw without texture */
+		int texture;
+
+		/** index range in m_mesh */
+		unsigned first;
+		unsigned count;
+
+		/** index ranges of the simplified levels 1 to lodLevels - 1 in m_mesh, count 0 for missing levels */
+		unsigned lodFirst[ lodLevels - 1 ];
+		unsigned lodCount[ lodLevels - 1 ];
+
+		/** largest distance of a simplified level from the full one, in scene units */
+		float lodError[ lodLevels - 1 ];
+
+		/** string of text items */
+		std::string text;
+	};
+
+	/** removes all items, textures and geometry */
+	void clear();
+
+	/** simplifies items with many triangles into coarser levels, called after compiling */
+	void generateLevels( const std::string& source );
+
+	/** 
+	 * computes the bounding box from the vertices of the items and the errors of the levels of the scene, 
+	 * called after compiling or loading
+	 */
+	void finish();
+
+	/** index range of an item at a level, the coarsest existing one if the level is missing */
+	void itemRange( const Item& item, unsigned level, unsigned& first, unsigned& count ) const;
+
+	/** logs the size of the scene */
+	void report( const std::string& source ) const;
+
+	/** sets color and texture of an item */
+	void itemState( GLStateCache& state, TextureManager& textures, Resources& resources, const Item& item ) const;
+
+	/** returns the name of a texture, requesting the texture if necessary */
+	GLuint texture( GLStateCache& state, TextureManager& textures, Resources& resources, int index ) const;
+
+	GLGeometry m_mesh;
+
+	/** keeps the arrays of the mesh alive if they are not owned by it, e.g. a mapped cache file */
+	boost::shared_ptr< void > m_pStorage;
+
+	std::vector< Item > m_items;
+	std::vector< Texture > m_textures;
+
+	/** clear color set by a Background node */
+	bool m_bBackground;
+	float m_background[ 3 ];
+
+	BoundingBox m_bounds;
+	bool m_bBounded;
+
+	unsigned m_levels;
+
+	/** largest error of any item at each level, in scene units */
+	float m_levelError[ lodLevels ];
+
+	friend class X3DCompiler;
+	friend class X3DCache;
+};
+
+
+} } // namespace Ubitrack::Drivers
+
+#endif
@@ -23,20 +23,73 @@
 
 #include "ZBufferOutput.h"
 
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <utUtil/Exception.h>
+
 namespace Ubitrack { namespace Drivers {
 
+// converts window depth to the distance from the camera plane, using the
+// third and fourth rows of the projection matrix (P22, P23, P32, P33)
+static const char* g_linearDepthShader =
+	"uniform sampler2D depth;\n"
+	"uniform vec4 projection;\n"
+	"uniform float scale;\n"
+	"void main()\n"
+	"{\n"
+	"	float d = texture2D( depth, gl_TexCoord[0].st ).r;\n"
+	"	float z = 2.0 * d - 1.0;\n"
+	"	float dist = ( z * projection.w - projection.y ) / ( z * projection.z - projection.x );\n"
+	"	gl_FragColor = vec4( d < 1.0 ? dist * scale : 0.0 );\n"
+	"}\n";
+
+static unsigned readbackBuffers( boost::shared_ptr< Graph::UTQLSubgraph > subgraph )
+{
+	int n = 2;
+	subgraph->m_DataflowAttributes.getAttributeData( "readbackBuffers", n );
+	return n < 1 ? 1 : n;
+}
+
+
 ZBufferOutput::ZBufferOutput( const std::string& name, boost::shared_ptr< Graph::UTQLSubgraph > subgraph, 
 	const VirtualObjectKey& componentKey, VirtualCamera* pModule )
 	: VirtualObject( name, subgraph, componentKey, pModule )
+	, m_depthFormat( depthRaw8U )
 	, m_port( "Output", *this )
 	, m_width(0)
 	, m_height(0)
+	, m_bLinearDepthFailed( false )
+	, m_linearWidth( 0 )
+	, m_linearHeight( 0 )
+	, m_depthTexture( 0 )
+	, m_linearTexture( 0 )
+	, m_framebuffer( 0 )
+	, m_program( 0 )
+	, m_readback( readbackBuffers( subgraph ) )
 {
+	std::string format = subgraph->m_DataflowAttributes.getAttributeString( "depthFormat" );
+	if ( format == "32F" )
+		m_depthFormat = depthLinear32F;
+	else if ( format == "16U" )
+		m_depthFormat = depthLinear16U;
+	else if ( !format.empty() && format != "8U" )
+		UBITRACK_THROW( "Unsupported depth format " + format );
 }
 
 /** render the object */
-void ZBufferOutput::draw( Measurement::Timestamp&, int parity )
+void ZBufferOutput::draw( Measurement::Timestamp& t, int parity )
 {
+	if ( m_depthFormat != depthRaw8U )
+	{
+		if ( parity ) return;
+
+		const GLdouble* projection = m_pModule->frustum().projection();
+		if ( !drawLinearDepth( projection, t ) )
+			readLinearDepth( projection, t );
+		return;
+	}
+
 	unsigned char* data;
 	if ((m_width != m_pModule->m_width) || (m_height != m_pModule->m_height))
 	{
@@ -61,5 +114,217 @@ void ZBufferOutput::draw( Measurement::Timestamp&, int parity )
 	m_port.send( Measurement::ImageMeasurement( Measurement::now(), m_zBuffer ) );
 }
 
+
+
+bool ZBufferOutput::initLinearDepth( const GLExtensions& ext, int width, int height )
+{
+	if ( m_bLinearDepthFailed )
+		return false;
+	if ( m_framebuffer && width == m_linearWidth && height == m_linearHeight )
+		return true;
+
+	glCleanup();
+	if ( !ext.hasFramebufferObject() || !ext.hasShaders() || !ext.hasTextureFloat() )
+	{
+		LOG4CPP_NOTICE( logger, "ZBufferOutput: no framebuffer objects, shaders or float textures, linearizing depth on the CPU" );
+		m_bLinearDepthFailed = true;
+		return false;
+	}
+
+	if ( !m_program )
+	{
+		std::string log;
+		m_program = ext.compileProgram( 0, g_linearDepthShader, log );
+		if ( !m_program )
+		{
+			LOG4CPP_ERROR( logger, "ZBufferOutput: could not compile depth shader: " << log );
+			m_bLinearDepthFailed = true;
+			return false;
+		}
+	}
+
+	glPushAttrib( GL_TEXTURE_BIT );
+
+	// copy of the depth buffer
+	glGenTextures( 1, &m_depthTexture );
+	glBindTexture( GL_TEXTURE_2D, m_depthTexture );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0 );
+
+	// linear depth, single channel if possible
+	GLint internalFormat = ext.hasTextureRG() ? GL_R32F : GL_RGBA32F;
+	glGenTextures( 1, &m_linearTexture );
+	glBindTexture( GL_TEXTURE_2D, m_linearTexture );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexImage2D( GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RED, GL_FLOAT, 0 );
+
+	glPopAttrib();
+
+	GLuint previous = m_pModule->framebuffer();
+	ext.genFramebuffers( 1, &m_framebuffer );
+	ext.bindFramebuffer( GL_FRAMEBUFFER, m_framebuffer );
+	ext.framebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_linearTexture, 0 );
+	bool bComplete = ext.checkFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+	ext.bindFramebuffer( GL_FRAMEBUFFER, previous );
+
+	if ( !bComplete )
+	{
+		LOG4CPP_NOTICE( logger, "ZBufferOutput: float framebuffer not supported, linearizing depth on the CPU" );
+		glCleanup();
+		m_bLinearDepthFailed = true;
+		return false;
+	}
+
+	m_linearWidth = width;
+	m_linearHeight = height;
+	return true;
+}
+
+
+bool ZBufferOutput::drawLinearDepth( const GLdouble* projection, Measurement::Timestamp t )
+{
+	const GLExtensions& ext = m_pModule->glExtensions();
+	int width = m_pModule->m_width;
+	int height = m_pModule->m_height;
+	if ( !initLinearDepth( ext, width, height ) )
+		return false;
+
+	glPushAttrib( GL_ALL_ATTRIB_BITS );
+	glMatrixMode( GL_PROJECTION );
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho( 0, 1, 0, 1, -1, 1 );
+	glMatrixMode( GL_MODELVIEW );
+	glPushMatrix();
+	glLoadIdentity();
+
+	// copy the depth buffer of the current read framebuffer
+	glBindTexture( GL_TEXTURE_2D, m_depthTexture );
+	glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height );
+
+	GLuint previous = m_pModule->framebuffer();
+	ext.bindFramebuffer( GL_FRAMEBUFFER, m_framebuffer );
+	glDrawBuffer( GL_COLOR_ATTACHMENT0 );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+	glViewport( 0, 0, width, height );
+	glDisable( GL_DEPTH_TEST );
+	glDisable( GL_LIGHTING );
+	glDisable( GL_BLEND );
+	glEnable( GL_TEXTURE_2D );
+
+	// millimeters are scaled so that the normalized unsigned short conversion of glReadPixels yields them
+	ext.useProgram( m_program );
+	ext.uniform1i( ext.getUniformLocation( m_program, "depth" ), 0 );
+	ext.uniform4f( ext.getUniformLocation( m_program, "projection" ), 
+		GLfloat( projection[ 10 ] ), GLfloat( projection[ 14 ] ), GLfloat( projection[ 11 ] ), GLfloat( projection[ 15 ] ) );
+	ext.uniform1f( ext.getUniformLocation( m_program, "scale" ), m_depthFormat == depthLinear16U ? 1000.0f / 65535.0f : 1.0f );
+
+	glBegin( GL_QUADS );
+	glTexCoord2f( 0, 0 ); glVertex2f( 0, 0 );
+	glTexCoord2f( 1, 0 ); glVertex2f( 1, 0 );
+	glTexCoord2f( 1, 1 ); glVertex2f( 1, 1 );
+	glTexCoord2f( 0, 1 ); glVertex2f( 0, 1 );
+	glEnd();
+
+	ext.useProgram( 0 );
+
+	// read back asynchronously if possible
+	GLenum type = m_depthFormat == depthLinear32F ? GL_FLOAT : GL_UNSIGNED_SHORT;
+	unsigned pixelSize = m_depthFormat == depthLinear32F ? 4 : 2;
+	bool bAsync = m_readback.read( ext, width, height, GL_RED, type, pixelSize, t );
+	std::vector< unsigned char > pixels;
+	if ( !bAsync )
+	{
+		pixels.resize( width * height * pixelSize );
+		glReadPixels( 0, 0, width, height, GL_RED, type, &pixels[ 0 ] );
+	}
+
+	ext.bindFramebuffer( GL_FRAMEBUFFER, previous );
+	glMatrixMode( GL_MODELVIEW );
+	glPopMatrix();
+	glMatrixMode( GL_PROJECTION );
+	glPopMatrix();
+	glPopAttrib();
+
+	if ( bAsync )
+		sendReadback();
+	else
+		sendImage( &pixels[ 0 ], width, height, t );
+	return true;
+}
+
+
+void ZBufferOutput::readLinearDepth( const GLdouble* projection, Measurement::Timestamp t )
+{
+	int width = m_pModule->m_width;
+	int height = m_pModule->m_height;
+	std::vector< float > depth( width * height );
+	glReadPixels( 0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, &depth[ 0 ] );
+
+	double p22 = projection[ 10 ], p23 = projection[ 14 ], p32 = projection[ 11 ], p33 = projection[ 15 ];
+	std::vector< unsigned short > millimeters( m_depthFormat == depthLinear16U ? width * height : 0 );
+	for ( int i = 0; i < width * height; i++ )
+	{
+		double z = 2.0 * depth[ i ] - 1.0;
+		double dist = depth[ i ] < 1.0f ? ( z * p33 - p23 ) / ( z * p32 - p22 ) : 0.0;
+		if ( m_depthFormat == depthLinear16U )
+			millimeters[ i ] = (unsigned short)std::min( 65535.0, std::max( 0.0, dist * 1000.0 + 0.5 ) );
+		else
+			depth[ i ] = float( dist );
+	}
+
+	if ( m_depthFormat == depthLinear16U )
+		sendImage( &millimeters[ 0 ], width, height, t );
+	else
+		sendImage( &depth[ 0 ], width, height, t );
+}
+
+
+void ZBufferOutput::sendReadback()
+{
+	const GLExtensions& ext = m_pModule->glExtensions();
+	Measurement::Timestamp time;
+	const void* pData = m_readback.map( ext, time );
+	if ( !pData )
+		return;
+
+	sendImage( pData, m_readback.width(), m_readback.height(), time );
+	m_readback.unmap( ext );
+}
+
+
+void ZBufferOutput::sendImage( const void* pData, int width, int height, Measurement::Timestamp t )
+{
+	int pixelSize = m_depthFormat == depthLinear32F ? 4 : 2;
+	boost::shared_ptr< Vision::Image > pImage( new Vision::Image( width, height, 1, 
+		m_depthFormat == depthLinear32F ? IPL_DEPTH_32F : IPL_DEPTH_16U ) );
+	pImage->origin = 1;
+	for ( int y = 0; y < height; y++ )
+		memcpy( pImage->imageData + y * pImage->widthStep, static_cast< const char* >( pData ) + y * width * pixelSize, width * pixelSize );
+
+	m_port.send( Measurement::ImageMeasurement( t, pImage ) );
+}
+
+
+void ZBufferOutput::glCleanup()
+{
+	const GLExtensions& ext = m_pModule->glExtensions();
+	m_readback.clear( ext );
+	if ( m_framebuffer )
+		ext.deleteFramebuffers( 1, &m_framebuffer );
+	if ( m_depthTexture )
+		glDeleteTextures( 1, &m_depthTexture );
+	if ( m_linearTexture )
+		glDeleteTextures( 1, &m_linearTexture );
+	if ( m_program )
+		ext.deleteProgram( m_program );
+	m_framebuffer = m_depthTexture = m_linearTexture = m_program = 0;
+	m_linearWidth = m_linearHeight = 0;
+}
+
 } } // namespace Ubitrack::Drivers
 
@@ -25,6 +25,7 @@
 #define _ZBUFFEROUTPUT_H_
 
 #include "RenderModule.h"
+#include "PixelReadback.h"
 #include <utVision/Image.h>
 
 namespace Ubitrack { namespace Drivers {
@@ -34,6 +35,13 @@ namespace Ubitrack { namespace Drivers {
  * @ingroup driver_components
  * Component for Z-Buffer output.
  * Provides a push-out port for the grey-level image.
+ *
+ * By default, the raw z buffer is sent as 8 bit image. With depthFormat
+ * "32F" or "16U", the linear distance from the camera plane is sent in
+ * meters (float) or millimeters (unsigned short), 0 where nothing was drawn.
+ * The conversion uses the projection matrix active when the component is
+ * drawn and runs in a shader if possible. The result is read back through a
+ * ring of readbackBuffers pixel buffer objects.
  */
 class ZBufferOutput
 	: public VirtualObject
@@ -53,12 +61,42 @@ public:
 	/** render the object */
 	virtual void draw( Measurement::Timestamp&, int parity );
 
+	/** deletes the linearization resources */
+	virtual void glCleanup();
+
 protected:
 
+	/** computes linear depth on the GPU and reads it back, false if this is not supported */
+	bool drawLinearDepth( const GLdouble* projection, Measurement::Timestamp t );
+
+	/** creates the framebuffer and shader for the linearization, false if not supported */
+	bool initLinearDepth( const GLExtensions& ext, int width, int height );
+
+	/** computes linear depth on the CPU, reads synchronously */
+	void readLinearDepth( const GLdouble* projection, Measurement::Timestamp t );
+
+	/** sends the oldest frame of the readback ring, if any */
+	void sendReadback();
+
+	/** copies tightly packed rows into a new image and sends it */
+	void sendImage( const void* pData, int width, int height, Measurement::Timestamp t );
+
+	enum DepthFormat { depthRaw8U, depthLinear32F, depthLinear16U } m_depthFormat;
+
 	PushSupplier< Ubitrack::Measurement::ImageMeasurement > m_port;
 	boost::shared_ptr< Vision::Image > m_zBuffer;
 
 	int m_width, m_height;
+
+	/** linearization resources */
+	bool m_bLinearDepthFailed;
+	int m_linearWidth, m_linearHeight;
+	GLuint m_depthTexture;
+	GLuint m_linearTexture;
+	GLuint m_framebuffer;
+	GLuint m_program;
+
+	PixelReadback m_readback;
 };
 
 